@@ -0,0 +1,127 @@
+#ifndef BRICK_MAP_SDF_H
+#define BRICK_MAP_SDF_H
+
+#include <array>
+#include <limits>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#include "utils/Mesh.h"
+#include "utils/UsefullSerializations.h"
+#include "SdfFunction.h"
+
+#include <cereal/types/vector.hpp>
+
+namespace sdflib
+{
+/**
+ * @brief Sparse grid of distances split in bricks of 8x8x8 samples.
+ *        The bricks are only allocated near the surface, or where the coarse grid error is too high.
+ *        The rest of the area uses a coarse grid storing the distances at the bricks corners.
+ *        Neighbour bricks share their border samples, so a query only needs one index lookup
+ *        and the samples of one brick.
+ **/
+class BrickMapSdf : public SdfFunction
+{
+public:
+    // Number of samples per axis of a brick
+    static constexpr uint32_t BRICK_SIZE = 8;
+    // Number of cells per axis covered by a brick
+    static constexpr uint32_t BRICK_CELLS = BRICK_SIZE - 1;
+    static constexpr uint32_t BRICK_NUM_SAMPLES = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    static constexpr uint32_t EMPTY_BRICK = std::numeric_limits<uint32_t>::max();
+
+    BrickMapSdf() {}
+    /**
+     * @param mesh The input mesh.
+     * @param box The area that the structure must cover.
+     * @param cellSize The distance between the samples of the bricks.
+     * @param narrowBand The bricks containing distances lower than this value are allocated.
+     * @param maxCoarseError If it is finite, the bricks where the coarse grid has a greater error are also allocated.
+     * @param numThreads The maximum number of threads to use during the structure construction.
+     **/
+    BrickMapSdf(const Mesh& mesh, BoundingBox box, float cellSize, float narrowBand,
+                float maxCoarseError = INFINITY, uint32_t numThreads = 1);
+    /**
+     * @brief Samples an existing structure.
+     * @param sdf The structure to sample.
+     * @param box The area that the structure must cover.
+     * @param cellSize The distance between the samples of the bricks.
+     * @param narrowBand The bricks containing distances lower than this value are allocated.
+     * @param maxCoarseError If it is finite, the bricks where the coarse grid has a greater error are also allocated.
+     * @param numThreads The maximum number of threads to use during the structure construction.
+     **/
+    BrickMapSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float narrowBand,
+                float maxCoarseError = INFINITY, uint32_t numThreads = 1);
+
+    float getDistance(glm::vec3 sample) const override;
+    float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+    SdfFormat getFormat() const override { return SdfFormat::BRICK_MAP; }
+
+    /**
+     * @return False if the octree used to sample the mesh could not be built
+     **/
+    bool isValid() const override { return !mBrickIndex.empty(); }
+
+    float getMinCellSize() const override { return mCellSize; }
+
+    const BoundingBox& getGridBoundingBox() const { return mBox; }
+    BoundingBox getSampleArea() const override { return mBox; }
+    float getGridCellSize() const { return mCellSize; }
+    float getNarrowBand() const { return mNarrowBand; }
+    glm::ivec3 getNumBricksPerAxis() const { return mNumBricks; }
+
+    /**
+     * @return The number of allocated bricks
+     **/
+    uint32_t getNumAllocatedBricks() const { return static_cast<uint32_t>(mBricks.size() / BRICK_NUM_SAMPLES); }
+
+    template<class Archive>
+    void save(Archive & archive) const
+    {
+        archive(mBox, mCellSize, mNarrowBand, mNumBricks, mBrickIndex, mBricks, mCoarseGrid);
+    }
+
+    template<class Archive>
+    void load(Archive & archive)
+    {
+        archive(mBox, mCellSize, mNarrowBand, mNumBricks, mBrickIndex, mBricks, mCoarseGrid);
+        mBrickSize = mCellSize * static_cast<float>(BRICK_CELLS);
+
+        float total = mBrickIndex.size() * sizeof(uint32_t) + mBricks.size() * sizeof(float) + mCoarseGrid.size() * sizeof(float);
+        SPDLOG_INFO("Brick Map Sdf Total: {}MB, {} of {} bricks allocated",
+                    total/1048576.0f, getNumAllocatedBricks(), mBrickIndex.size());
+    }
+
+private:
+    BoundingBox mBox;
+    float mCellSize = 0.0f;
+    float mBrickSize = 0.0f;
+    float mNarrowBand = 0.0f;
+
+    glm::ivec3 mNumBricks = glm::ivec3(0);
+    // Index of the brick of each grid position or EMPTY_BRICK
+    std::vector<uint32_t> mBrickIndex;
+    // Samples of the allocated bricks
+    std::vector<float> mBricks;
+    // Distances at the corners of all the bricks
+    std::vector<float> mCoarseGrid;
+
+    void initFromSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float narrowBand,
+                     float maxCoarseError, uint32_t numThreads);
+
+    inline uint32_t getCoarseIndex(glm::ivec3 pos) const
+    {
+        return pos.z * (mNumBricks.x + 1) * (mNumBricks.y + 1) + pos.y * (mNumBricks.x + 1) + pos.x;
+    }
+
+    /**
+     * @brief Gets the 8 values surrounding the sample in the brick or in the coarse grid
+     * @param outValues The values ordered like the octree children
+     * @param outFracPart The sample position inside the cell
+     **/
+    void getCellValues(glm::vec3 sample, std::array<float, 8>& outValues, glm::vec3& outFracPart) const;
+};
+}
+
+#endif
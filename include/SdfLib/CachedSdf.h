@@ -0,0 +1,101 @@
+#ifndef CACHED_SDF_H
+#define CACHED_SDF_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "SdfFunction.h"
+
+namespace sdflib
+{
+/**
+ * @brief Decorator that memoizes the queries of another structure.
+ *        The samples are snapped to a grid of a given quantum and the results are stored
+ *        in a lock-free set-associative cache, so it is useful for pipelines querying
+ *        the same positions repeatedly against a static structure.
+ *        The misses are evaluated at the queried sample. The hits are extrapolated from the
+ *        snapped sample with the cached gradient, so their error only depends on the field
+ *        curvature inside a quantum. The quantum should be smaller than the cells of the decorated structure.
+ **/
+class CachedSdf : public SdfFunction
+{
+public:
+    /**
+     * @param sdf The structure to query on cache misses.
+     * @param quantum The size of the grid used to quantize the samples.
+     *                A warning is shown if it is larger than the smallest cell of the decorated structure.
+     * @param numEntries The minimum number of entries of the cache.
+     *                   It is rounded up to a power of two number of sets and limited to 2^24 sets.
+     **/
+    CachedSdf(std::shared_ptr<SdfFunction> sdf, float quantum, uint32_t numEntries = 1 << 20);
+
+    float getDistance(glm::vec3 sample) const override;
+    float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+    BoundingBox getSampleArea() const override { return mSdf->getSampleArea(); }
+
+    /**
+     * @return The decorated structure
+     **/
+    const std::shared_ptr<SdfFunction>& getSdf() const { return mSdf; }
+
+    /**
+     * @brief Removes all the cache entries.
+     *        It should not be called while there are queries running.
+     **/
+    void clear();
+
+    uint64_t getNumHits() const;
+    uint64_t getNumMisses() const;
+    /**
+     * @return The ratio of queries answered by the cache
+     **/
+    float getHitRate() const;
+    void resetHitRate();
+
+private:
+    static constexpr uint32_t NUM_WAYS = 4;
+    static constexpr uint32_t BITS_PER_AXIS = 21;
+    static constexpr uint64_t EMPTY_KEY = ~0ull;
+    static constexpr uint32_t NUM_COUNTER_SLOTS = 64;
+    // 2GB of entries
+    static constexpr uint64_t MAX_NUM_SETS = 1 << 24;
+
+    // Entry protected by a sequence lock, odd sequences mean that it is being written
+    struct Entry
+    {
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint64_t> key{EMPTY_KEY};
+        std::atomic<float> distance{0.0f};
+        std::array<std::atomic<float>, 3> gradient{};
+    };
+
+    struct alignas(64) Set
+    {
+        std::array<Entry, NUM_WAYS> ways;
+    };
+
+    struct alignas(64) CounterSlot
+    {
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+    };
+
+    std::shared_ptr<SdfFunction> mSdf;
+    glm::vec3 mOrigin;
+    float mQuantum;
+    float mInvQuantum;
+    uint32_t mSetsMask;
+    std::unique_ptr<Set[]> mSets;
+
+    mutable std::array<CounterSlot, NUM_COUNTER_SLOTS> mCounters;
+
+    bool getKey(glm::vec3 sample, uint64_t& outKey, glm::vec3& outSnappedSample) const;
+    bool find(uint64_t key, float& outDistance, glm::vec3& outGradient) const;
+    void insert(uint64_t key, float distance, glm::vec3 gradient) const;
+    CounterSlot& getCounterSlot() const;
+};
+}
+
+#endif
@@ -2,10 +2,14 @@
 #define EXACT_OCTREE_SDF_H
 
 #include <array>
+#include <limits>
 
 #include "utils/Mesh.h"
 #include "utils/TriangleUtils.h"
 #include "utils/UsefullSerializations.h"
+#include "utils/FarFieldProxy.h"
+#include "utils/QueryStats.h"
+#include "utils/HugePageAllocator.h"
 #include "SdfFunction.h"
 
 namespace sdflib
@@ -68,6 +72,15 @@ public:
                             ((isLeaf) ? IS_LEAF_MASK : 0);
         }
 
+        /**
+         * @param maxIndex The maximum index that can be stored in the node field
+         * @return If an array of blockSize elements starting at index can be addressed by the nodes
+         **/
+        static inline bool fitsIndex(uint64_t index, uint64_t blockSize, uint64_t maxIndex)
+        {
+            return index + blockSize <= maxIndex + 1;
+        }
+
         template <class Archive>
         void serialize( Archive & ar )
         {
@@ -76,6 +89,23 @@ public:
         }
     };
 
+    /**
+     * @brief Offsets added to the indices stored in the nodes of a start grid subtree.
+     *        They are only used when the arrays cannot be addressed with the nodes indices.
+     **/
+    struct SubtreeOffsets
+    {
+        uint64_t nodes = 0;
+        uint64_t trianglesSets = 0;
+        uint64_t trianglesMasks = 0;
+
+        template <class Archive>
+        void serialize( Archive & ar )
+        {
+            ar(nodes, trianglesSets, trianglesMasks);
+        }
+    };
+
     // Constructors
     ExactOctreeSdf() {}
     /**
@@ -87,10 +117,11 @@ public:
      *                            All the leaves before the maximum depth must have less than 
      *                            this minimum influencing them.
      * @param numThreads The maximum number of threads to use during the structure construction.
+     * @param compactTriangles If true, the triangles are stored using the compact encoding.
      **/
     ExactOctreeSdf(const Mesh& mesh, BoundingBox box, uint32_t maxDepth,
                    uint32_t startDepth=1, uint32_t minTrianglesPerNode = 128,
-                   uint32_t numThreads=1);
+                   uint32_t numThreads=1, bool compactTriangles=false);
 
     /**
      * @return The size of the start grid containing all 
@@ -104,6 +135,21 @@ public:
     const BoundingBox& getGridBoundingBox() const { return mBox; }
     BoundingBox getSampleArea() const override { return mBox; }
 
+    /**
+     * @return The coarse mesh hull used to bound the distance outside the octree box.
+     **/
+    const FarFieldProxy& getFarFieldProxy() const { return mFarFieldProxy; }
+
+    /**
+     * @brief Enables or disables the recording of the query counters.
+     **/
+    void setQueryStatsEnabled(bool enabled) { mQueryStats.setEnabled(enabled); }
+    /**
+     * @return The query counters added up over all the threads
+     **/
+    QueryStats getQueryStats() const { return mQueryStats.getStats(); }
+    void resetQueryStats() { mQueryStats.reset(); }
+
     /**
      * @return Returns the maximum number of triangles influencing a leaf
      **/
@@ -122,45 +168,173 @@ public:
     /**
      * @return The array containing all the octree structure
      **/
-    const std::vector<OctreeNode>& getOctreeData() const { return mOctreeData; }
+    const LargeArray<OctreeNode>& getOctreeData() const { return mOctreeData; }
 
     /**
-     * @return The array of triangles properties used to compute distances to triangles
+     * @return The memory used by the octree nodes in bytes
      **/
-    const std::vector<TriangleUtils::TriangleData>& getTrianglesData() { return mTrianglesData; }
+    size_t getOctreeNodesMemory() const 
+    { 
+        return mOctreeData.size() * sizeof(OctreeNode) + 
+               mCompactNodes.size() * sizeof(uint32_t) + mCompactFarValues.size() * sizeof(uint64_t); 
+    }
+
+    /**
+     * @brief Replaces the nodes by the compact encoding, which uses 32 bits per node.
+     *        The children are addressed by a 30-bit offset from its parent or by a far pointer, 
+     *        and the leaves store only its triangles index.
+     *        After it, the array returned by getOctreeData is empty.
+     *        The nodes are not compacted if the triangles indices, with the offsets of their subtree, 
+     *        do not fit in 32 bits.
+     **/
+    void compactOctreeNodes();
+
+    /**
+     * @return If the structure uses the compact encoding for the nodes
+     **/
+    bool hasCompactNodes() const { return mUseCompactNodes; }
+
+    /**
+     * @return If the identical triangle sets and masks are shared by several nodes
+     **/
+    bool hasDeduplicatedTriangles() const { return mOriginalNumTriangles > 0; }
+
+    /**
+     * @return If the indices of each start grid subtree are relative to its own offsets
+     **/
+    bool hasSegmentedIndices() const { return !mSubtreeOffsets.empty(); }
+
+    /**
+     * @return If the triangle sets and masks indices are also relative to the subtree offsets.
+     *         It only happens when the deduplicated triangle arrays could not be addressed by the nodes,
+     *         otherwise only the nodes indices are segmented.
+     **/
+    bool hasSegmentedTriangleIndices() const;
+
+    /**
+     * @return The offsets of the indices of the start grid cell subtree
+     **/
+    SubtreeOffsets getSubtreeOffsets(uint32_t startCellIndex) const 
+    { 
+        return (mSubtreeOffsets.empty()) ? SubtreeOffsets() : mSubtreeOffsets[startCellIndex]; 
+    }
+
+    /**
+     * @return The array of triangles properties used to compute distances to triangles.
+     *         It is empty if the structure uses the compact encoding.
+     **/
+    const LargeArray<TriangleUtils::TriangleData>& getTrianglesData() { return mTrianglesData; }
+
+    /**
+     * @return The array of triangles using the compact encoding
+     **/
+    const LargeArray<TriangleUtils::CompactTriangleData>& getCompactTrianglesData() { return mCompactTrianglesData; }
+
+    /**
+     * @return If the structure uses the compact encoding for the triangles
+     **/
+    bool hasCompactTrianglesData() const { return mUseCompactTriangles; }
+
+    /**
+     * @brief Replaces the triangles properties by the compact encoding.
+     *        It halves the memory of the triangles, but part of the triangle space 
+     *        has to be rebuilt in each distance evaluation.
+     **/
+    void compactTrianglesData();
+
+    /**
+     * @return The memory used by the triangles properties in bytes
+     **/
+    size_t getTrianglesDataMemory() const 
+    { 
+        return mTrianglesData.size() * sizeof(TriangleUtils::TriangleData) + 
+               mCompactTrianglesData.size() * sizeof(TriangleUtils::CompactTriangleData); 
+    }
 
     float getDistance(glm::vec3 sample) const override;
     float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+    /**
+     * @brief Computes the distances of a batch of samples.
+     *        The samples are grouped by leaf, so the triangles of each leaf are decoded only once
+     *        and evaluated against tiles of samples.
+     **/
+    void getDistances(const glm::vec3* samples, float* outDistances, size_t numSamples) const override;
     SdfFormat getFormat() const override { return SdfFormat::EXACT_OCTREE; }
+    MemoryUsage getMemoryUsage() const override;
+    /**
+     * @return False if the octree has not been built because its arrays cannot be addressed with the nodes indices
+     **/
+    bool isValid() const override { return !mOctreeData.empty() || mUseCompactNodes; }
+
+    float getMinCellSize() const override { return mBox.getSize().x / static_cast<float>(1u << mMaxDepth); }
 
 
     // Load and save function for storing the structure on disk
+    // The version 0 is the layout before the far-field proxy, the compact encodings, 
+    // the triangle sets deduplication and the segmented indices were added
     template<class Archive>
-    void save(Archive & archive) const
+    void save(Archive & archive, std::uint32_t const version) const
     { 
         archive(mBox, mStartGridSize, mStartDepth, mMinTrianglesInLeafs, mMaxTrianglesInLeafs, mMaxTrianglesEncodedInLeafs, mBitEncodingStartDepth, mBitsPerIndex, mMaxDepth, mOctreeData, mTrianglesSets, mTrianglesMasks, mTrianglesData);
+        if(version >= 1)
+        {
+            archive(mFarFieldProxy);
+            archive(mUseCompactTriangles, mCompactTrianglesData);
+            archive(mOriginalTrianglesSetsSize, mOriginalTrianglesMasksSize, mOriginalNumTriangles);
+            archive(mSubtreeOffsets);
+            archive(mUseCompactNodes, mCompactNodes, mCompactFarValues);
+        }
     }
 
     template<class Archive>
-    void load(Archive & archive)
+    void load(Archive & archive, std::uint32_t const version)
     {
         archive(mBox, mStartGridSize, mStartDepth, mMinTrianglesInLeafs, mMaxTrianglesInLeafs, mMaxTrianglesEncodedInLeafs, mBitEncodingStartDepth, mBitsPerIndex, mMaxDepth, mOctreeData, mTrianglesSets, mTrianglesMasks, mTrianglesData);
+
+        if(version >= 1)
+        {
+            archive(mFarFieldProxy);
+            archive(mUseCompactTriangles, mCompactTrianglesData);
+            archive(mOriginalTrianglesSetsSize, mOriginalTrianglesMasksSize, mOriginalNumTriangles);
+            archive(mSubtreeOffsets);
+            archive(mUseCompactNodes, mCompactNodes, mCompactFarValues);
+        }
+        else
+        {
+            mFarFieldProxy = FarFieldProxy();
+            mUseCompactTriangles = false;
+            mCompactTrianglesData.clear();
+            mOriginalTrianglesSetsSize = 0;
+            mOriginalTrianglesMasksSize = 0;
+            mOriginalNumTriangles = 0;
+            mSubtreeOffsets.clear();
+            mUseCompactNodes = false;
+            mCompactNodes.clear();
+            mCompactFarValues.clear();
+        }
         
         mStartGridCellSize = mBox.getSize().x / static_cast<float>(mStartGridSize);
         mStartGridXY = mStartGridSize * mStartGridSize;
-
-        mTrianglesCache[0].resize(mMaxTrianglesEncodedInLeafs);
-        mTrianglesCache[1].resize(mMaxTrianglesEncodedInLeafs);
         
         // Print structure size
-        SPDLOG_INFO("Octree Data: {}", mOctreeData.size() * sizeof(OctreeNode));
+        SPDLOG_INFO("Octree Data: {}{}", getOctreeNodesMemory(), (mUseCompactNodes) ? " (compact)" : "");
         SPDLOG_INFO("Triangle Sets: {}", mTrianglesSets.size() * sizeof(uint32_t));
         SPDLOG_INFO("Triangle Masks: {}", mTrianglesMasks.size());
-        SPDLOG_INFO("Triangle Data: {}", mTrianglesData.size() * sizeof(TriangleUtils::TriangleData));
+        SPDLOG_INFO("Triangle Data: {}{}", getTrianglesDataMemory(), (mUseCompactTriangles) ? " (compact)" : "");
+
+        if(mOriginalNumTriangles > 0)
+        {
+            const size_t numTriangles = mTrianglesData.size() + mCompactTrianglesData.size();
+            SPDLOG_INFO("Deduplication savings: Triangle Sets {}, Triangle Masks {}, Triangle Data {} ({} unreferenced triangles)",
+                        (mOriginalTrianglesSetsSize - mTrianglesSets.size()) * sizeof(uint32_t),
+                        mOriginalTrianglesMasksSize - mTrianglesMasks.size(),
+                        (mOriginalNumTriangles - numTriangles) * getTrianglesDataMemory() / glm::max(numTriangles, size_t(1)),
+                        mOriginalNumTriangles - numTriangles);
+        }
 
-        float total = mOctreeData.size() * sizeof(OctreeNode) + mTrianglesSets.size() * sizeof(uint32_t) + mTrianglesMasks.size() + mTrianglesData.size() * sizeof(TriangleUtils::TriangleData);
+        float total = getOctreeNodesMemory() + mTrianglesSets.size() * sizeof(uint32_t) + mTrianglesMasks.size() + getTrianglesDataMemory();
         SPDLOG_INFO("Total: {}MB", total/1048576.0f);
-        total = mOctreeData.size() * sizeof(OctreeNode) + mTrianglesSets.size() * sizeof(uint32_t) + mTrianglesMasks.size();
+        total = getOctreeNodesMemory() + mTrianglesSets.size() * sizeof(uint32_t) + mTrianglesMasks.size();
         SPDLOG_INFO("Octree: {}MB", total/1048576.0f);
     }
 
@@ -174,8 +348,68 @@ private:
     // Octree bounding box
     BoundingBox mBox;
 
-    // Array used to decode the bit encoding during the structure queries
-    mutable std::array<std::vector<uint32_t>, 2> mTrianglesCache;
+    // Compact nodes encoding
+    // Inner nodes: the offset from the node to its children or the index of a far pointer
+    // Leaves: the triangles index or the index of a far value
+    static constexpr uint32_t COMPACT_LEAF_MASK = 1u << 31;
+    static constexpr uint32_t COMPACT_FAR_MASK = 1u << 30;
+    static constexpr uint32_t COMPACT_VALUE_MASK = COMPACT_FAR_MASK - 1;
+
+    // Returns if all the indices of the arrays, global or relative to its start grid subtree, can be stored in the nodes
+    bool hasAddressableIndices() const;
+
+    // Node traversals used by the queries for each nodes encoding
+    struct WideNodesCursor;
+    struct CompactNodesCursor;
+
+    template<typename NodesCursor>
+    float queryDistance(glm::vec3 sample) const;
+    template<typename NodesCursor>
+    float queryDistance(glm::vec3 sample, glm::vec3& outGradient) const;
+    template<typename NodesCursor>
+    void countNodesPerDepth(NodesCursor cursor, uint32_t depth, MemoryUsage& usage) const;
+    // Traversal decoding the triangles of the leaf containing the sample, used by all the triangle queries
+    template<typename NodesCursor>
+    const uint32_t* queryLeafTriangles(glm::vec3 sample, uint32_t& outNumTriangles,
+                                       uint32_t& outDepth, uint32_t& outMaskBitsDecoded) const;
+
+    // Decodes the bit encoded triangles of a set, only the ones selected by the mask if it is not null.
+    // Returns the number of triangles written.
+    uint32_t decodeTrianglesSet(const uint32_t* trianglesSet, uint32_t numTriangles, 
+                                const uint8_t* mask, uint32_t* outTriangles) const;
+    // Returns INVALID_TRIANGLE if there are no triangles
+    uint32_t findNearestTriangle(glm::vec3 sample, const uint32_t* triangles, uint32_t numTriangles) const;
+
+    // Returns the arrays used to decode the bit encoding during the structure queries.
+    // They are owned by the calling thread, so the queries can run concurrently.
+    std::array<std::vector<uint32_t>, 2>& getTrianglesCache() const;
+
+    // Nodes reached by a sample, enough to decode the triangles of its leaf without traversing the octree again
+    struct LeafPath
+    {
+        uint64_t leafPosition; // Position in the octree array of the leaf
+        const uint32_t* trianglesSet; // Set of the deepest node storing one
+        uint64_t masksStart; // Index of the first mask below the set in the masks array
+        uint32_t numMasks;
+        uint32_t depth;
+    };
+
+    // Traversal to the leaf containing the sample. The masks of the nodes below the set are appended to outMasks.
+    // Returns false if the sample is outside the octree.
+    template<typename NodesCursor>
+    bool queryLeafPath(glm::vec3 sample, LeafPath& outPath, std::vector<const uint8_t*>& outMasks) const;
+    bool getLeafPath(glm::vec3 sample, LeafPath& outPath, std::vector<const uint8_t*>& outMasks) const;
+
+    // Decodes the triangles of the leaf reached by the path, masks points to its first mask.
+    // The returned array is valid until the next query of the calling thread.
+    const uint32_t* decodeLeafTriangles(const LeafPath& path, const uint8_t* const* masks,
+                                        uint32_t& outNumTriangles, uint32_t& outMaskBitsDecoded) const;
+
+    // Index used as the nearest triangle of the leaves without triangles
+    static constexpr uint32_t INVALID_TRIANGLE = std::numeric_limits<uint32_t>::max();
+    // Distance returned in the leaves without triangles. It is the size of the leaf, a finite step
+    // that keeps the sphere tracers from jumping past the geometry.
+    float getEmptyLeafDistance(uint32_t depth) const;
 
     // Structure properties
     uint32_t mMinTrianglesInLeafs;
@@ -193,16 +427,57 @@ private:
     uint32_t mStartDepth = 0;
     float mStartGridCellSize = 0.0f;
 
-    // Structure arrays
-    std::vector<OctreeNode> mOctreeData; // List of nodes
-    std::vector<uint32_t> mTrianglesSets; // List storing sets of triangles
+    // Structure arrays, allocated following the current LargeArrayPolicy
+    LargeArray<OctreeNode> mOctreeData; // List of nodes
+    LargeArray<uint32_t> mTrianglesSets; // List storing sets of triangles
                                           // The first element of each set is the size of the set
                                           // Each triangle is stored using only a specific number of bits (mBitsPerIndex attribute)
-    std::vector<uint8_t> mTrianglesMasks; // List storing sets of triangles bit encoded
-    std::vector<TriangleUtils::TriangleData> mTrianglesData; // Triangle properties
+    LargeArray<uint8_t> mTrianglesMasks; // List storing sets of triangles bit encoded
+    LargeArray<TriangleUtils::TriangleData> mTrianglesData; // Triangle properties
+    LargeArray<TriangleUtils::CompactTriangleData> mCompactTrianglesData; // Triangle properties if the compact encoding is used
+    bool mUseCompactTriangles = false;
+
+    LargeArray<uint32_t> mCompactNodes; // List of nodes if the compact encoding is used
+    std::vector<uint64_t> mCompactFarValues; // Children positions and triangles indices that do not fit in the compact nodes
+    bool mUseCompactNodes = false;
+
+    // Offsets of the indices of each start grid subtree.
+    // It is only used when the arrays cannot be addressed with the nodes indices, otherwise it is empty.
+    std::vector<SubtreeOffsets> mSubtreeOffsets;
+
+    // Sizes of the triangles arrays before the deduplication, only used to report the savings
+    uint64_t mOriginalTrianglesSetsSize = 0;
+    uint64_t mOriginalTrianglesMasksSize = 0;
+    uint32_t mOriginalNumTriangles = 0;
+
+    // Distance functions to the triangles stored with any of the two encodings
+    inline float getSqDistToTriangle(glm::vec3 sample, uint32_t tIndex) const
+    {
+        return (mUseCompactTriangles) ? TriangleUtils::getSqDistPointAndTriangle(sample, mCompactTrianglesData[tIndex])
+                                      : TriangleUtils::getSqDistPointAndTriangle(sample, mTrianglesData[tIndex]);
+    }
+
+    inline float getSignedDistToTriangle(glm::vec3 sample, uint32_t tIndex) const
+    {
+        return (mUseCompactTriangles) ? TriangleUtils::getSignedDistPointAndTriangle(sample, mCompactTrianglesData[tIndex])
+                                      : TriangleUtils::getSignedDistPointAndTriangle(sample, mTrianglesData[tIndex]);
+    }
+
+    inline float getSignedDistToTriangle(glm::vec3 sample, uint32_t tIndex, glm::vec3& outGradient) const
+    {
+        return (mUseCompactTriangles) ? TriangleUtils::getSignedDistPointAndTriangle(sample, mCompactTrianglesData[tIndex], outGradient)
+                                      : TriangleUtils::getSignedDistPointAndTriangle(sample, mTrianglesData[tIndex], outGradient);
+    }
+
+    // Coarse hull of the mesh for the queries outside the octree box
+    FarFieldProxy mFarFieldProxy;
+
+    // Optional counters of the work done by the queries
+    QueryStatsCounter mQueryStats;
 
     template<typename TrianglesInfluenceStrategy>
-    void initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t maxDepth,
+    void initOctree(const Mesh& mesh, const std::vector<TriangleUtils::TriangleData>& trianglesData, 
+                    uint32_t startDepth, uint32_t maxDepth,
                     uint32_t minTrianglesPerNode, uint32_t numThreads = 1);
 
     std::vector<uint32_t> evalNode(uint32_t nodeIndex, uint32_t depth, 
@@ -211,7 +486,13 @@ private:
                                     std::vector<uint32_t>& differentTriangles);
 
     void calculateStatistics();
+
+    // Shares the identical triangle sets and masks, stores in mTrianglesData only the triangles 
+    // referenced by the leaves and reduces the bits per index to the remaining triangles
+    void compactTrianglesStorage(const std::vector<TriangleUtils::TriangleData>& trianglesData);
 };
 }
 
+CEREAL_CLASS_VERSION(sdflib::ExactOctreeSdf, 1);
+
 #endif
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include "utils/Mesh.h"
 #include "utils/TriangleUtils.h"
 #include "utils/UsefullSerializations.h"
+#include "utils/FarFieldProxy.h"
+#include "utils/QueryStats.h"
+#include "utils/HugePageAllocator.h"
 
 #include "SdfFunction.h"
 
@@ -70,7 +73,7 @@ public:
             childrenIndex |= MARK_MASK;
         }
 
-        inline bool isMarked()
+        inline bool isMarked() const
         {
             return childrenIndex & MARK_MASK;
         }
@@ -86,6 +89,15 @@ public:
                             ((isLeaf) ? IS_LEAF_MASK : 0);
         }
 
+        /**
+         * @return If an array of blockSize elements starting at index can be addressed by the nodes.
+         *         The last index is reserved for the empty leaves, so it is never part of the array.
+         **/
+        static inline bool fitsIndex(uint64_t index, uint64_t blockSize = 1)
+        {
+            return index + blockSize <= static_cast<uint64_t>(CHILDREN_INDEX_MASK);
+        }
+
         template <class Archive>
         void serialize( Archive & ar )
         {
@@ -154,6 +166,11 @@ public:
      **/
     float getOctreeMinBorderValue() const { return mMinBorderValue; }
 
+    /**
+     * @return The coarse mesh hull used to bound the distance outside the octree box.
+     **/
+    const FarFieldProxy& getFarFieldProxy() const { return mFarFieldProxy; }
+
     /**
      * @return The size of the start grid containing all 
      *          the nodes of the start depth stored sequentially 
@@ -174,15 +191,45 @@ public:
     /**
      * @return The array containing all the octree structure
      **/
-    const std::vector<OctreeNode>& getOctreeData() const { return mOctreeData; }
+    const LargeArray<OctreeNode>& getOctreeData() const { return mOctreeData; }
 
     /**
      * @return The array containing all the octree structure
      **/
-    std::vector<OctreeNode>& getOctreeData() { return mOctreeData; }
+    LargeArray<OctreeNode>& getOctreeData() { return mOctreeData; }
 
     bool hasSdfOnlyAtSurface() const { return mSdfOnlyAySurface; }
 
+    /**
+     * @return False if the octree has not been built because its array cannot be addressed with the nodes indices
+     **/
+    bool isValid() const override { return !mOctreeData.empty(); }
+
+    float getMinCellSize() const override { return mBox.getSize().x / static_cast<float>(1u << mMaxDepth); }
+
+    /**
+     * @return If the indices of each start grid subtree are relative to its own offset
+     **/
+    bool hasSegmentedIndices() const { return !mStartCellOffsets.empty(); }
+
+    /**
+     * @return The position of the octree array where the indices of the start grid cell subtree begin
+     **/
+    uint64_t getStartCellOffset(uint32_t startCellIndex) const 
+    { 
+        return (mStartCellOffsets.empty()) ? 0 : mStartCellOffsets[startCellIndex]; 
+    }
+
+    /**
+     * @brief Enables or disables the recording of the query counters.
+     **/
+    void setQueryStatsEnabled(bool enabled) { mQueryStats.setEnabled(enabled); }
+    /**
+     * @return The query counters added up over all the threads
+     **/
+    QueryStats getQueryStats() const { return mQueryStats.getStats(); }
+    void resetQueryStats() { mQueryStats.reset(); }
+
     /**
      * @brief Computes the area covered by the leaves at different depths, 
      *          supposing that the hole octree has area 1.
@@ -193,6 +240,7 @@ public:
         depthsDensity.resize(mMaxDepth + 1);
         std::vector<uint32_t> nodesPerDepth(depthsDensity.size(), 0);
         uint32_t numLeaves = 0;
+        uint64_t offset = 0;
         std::function<void(OctreeNode&, uint32_t)> vistNode;
         vistNode = [&](OctreeNode& node, uint32_t depth)
         {
@@ -201,7 +249,7 @@ public:
             {
                 for(uint32_t i = 0; i < 8; i++)
                 {
-                    vistNode(mOctreeData[node.getChildrenIndex() + i], depth+1);
+                    vistNode(mOctreeData[offset + node.getChildrenIndex() + i], depth+1);
                 }
             }
             else
@@ -220,6 +268,7 @@ public:
                 for(uint32_t i=0; i < mStartGridSize; i++)
                 {
                     const uint32_t nodeStartIndex = k * mStartGridSize * mStartGridSize + j * mStartGridSize + i;
+                    offset = getStartCellOffset(nodeStartIndex);
                     vistNode(mOctreeData[nodeStartIndex], startDepth);
                 }
             }
@@ -233,6 +282,31 @@ public:
         }
     }
 protected:
+    /**
+     * @brief Encodes the octree array in one independent chunk per start grid cell.
+     *        Each chunk stores its subtree in depth-first order, so the children indices are
+     *        predicted by the decoder and only the indices of the shared arrays are stored, as deltas.
+     *        The coefficients are split in byte planes and all the streams are entropy coded.
+     *        The padding of the array is not stored.
+     * @param numCoefficients Number of array elements used by the coefficients of a leaf.
+     * @return False if the octree has segmented indices or if the decoded array could not be addressed by the nodes.
+     *         The subtrees shared between start cells are expanded, so the decoded array can be larger than the octree.
+     **/
+    bool encodeOctreeChunks(uint32_t numCoefficients, std::vector<std::vector<uint8_t>>& outChunks) const;
+
+    /**
+     * @brief Rebuilds the octree array from the chunks, decoding them in parallel.
+     *        The start grid must be already loaded.
+     * @return False if a chunk is corrupted
+     **/
+    bool decodeOctreeChunks(uint32_t numCoefficients, const std::vector<std::vector<uint8_t>>& chunks);
+
+    /**
+     * @return If all the indices of the octree array, global or relative to its start grid subtree, 
+     *         can be stored in the nodes
+     **/
+    bool hasAddressableIndices() const;
+
     // Octree bounding box
     BoundingBox mBox;
 
@@ -240,6 +314,8 @@ protected:
     float mValueRange;
     // Stores the minimum distance in the border of the octree box
     float mMinBorderValue;
+    // Stores a coarse hull of the mesh for the queries outside the octree box
+    FarFieldProxy mFarFieldProxy;
     
     // Octree start grid
     int mStartGridSize = 0;
@@ -249,7 +325,13 @@ protected:
     uint32_t mMaxDepth;
     bool mSdfOnlyAySurface;
     // Array storing the octree nodes and the arrays of coefficients
-    std::vector<OctreeNode> mOctreeData;
+    LargeArray<OctreeNode> mOctreeData;
+    // Offset added to the indices of each start grid subtree.
+    // It is only used when the octree array cannot be addressed with the nodes indices, otherwise it is empty.
+    std::vector<uint64_t> mStartCellOffsets;
+
+    // Optional counters of the work done by the queries
+    QueryStatsCounter mQueryStats;
 };
 }
 
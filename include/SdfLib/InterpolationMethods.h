@@ -41,6 +41,12 @@ struct NoneInterpolation
         return glm::vec3(0.0f);
     }
 
+    inline static float interpolateValueAndGradient(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, glm::vec3& outGradient)
+    {
+        outGradient = glm::vec3(0.0f);
+        return 0.0f;
+    }
+
     inline static void interpolateVertexValues(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, float nodeSize, std::array<float, VALUES_PER_VERTEX>& outValues)
     {}
 
@@ -141,6 +147,31 @@ struct TriLinearInterpolation
         return glm::vec3(gx, gy, gz);
     }
 
+    /**
+     * @brief Computes the value and the gradient sharing the interpolations along each axis.
+     * @return The interpolated value
+     **/
+    inline static float interpolateValueAndGradient(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, glm::vec3& outGradient)
+    {
+        // Interpolations and differences along the x axis
+        const float d00 = values[0] + (values[1] - values[0]) * fracPart.x;
+        const float d01 = values[2] + (values[3] - values[2]) * fracPart.x;
+        const float d10 = values[4] + (values[5] - values[4]) * fracPart.x;
+        const float d11 = values[6] + (values[7] - values[6]) * fracPart.x;
+
+        const float e0 = (values[1] - values[0]) * (1.0f - fracPart.y) + (values[3] - values[2]) * fracPart.y;
+        const float e1 = (values[5] - values[4]) * (1.0f - fracPart.y) + (values[7] - values[6]) * fracPart.y;
+
+        const float d0 = d00 * (1.0f - fracPart.y) + d01 * fracPart.y;
+        const float d1 = d10 * (1.0f - fracPart.y) + d11 * fracPart.y;
+
+        outGradient.x = e0 * (1.0f - fracPart.z) + e1 * fracPart.z;
+        outGradient.y = (d01 - d00) * (1.0f - fracPart.z) + (d11 - d10) * fracPart.z;
+        outGradient.z = d1 - d0;
+
+        return d0 * (1.0f - fracPart.z) + d1 * fracPart.z;
+    }
+
     inline static void interpolateVertexValues(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, float nodeSize, std::array<float, VALUES_PER_VERTEX>& outValues)
     {
         outValues[0] = interpolateValue(values, fracPart);
@@ -160,6 +191,202 @@ struct TriLinearInterpolation
     }
 };
 
+/**
+ * Tri-quadratic polynomial stored in Bernstein form, the coefficient of the position (i, j, k) is stored at k * 9 + j * 3 + i.
+ * It is fitted to the values and gradients of the node vertices. The values at the middle of the edges, 
+ * the faces and the node are estimated with the cubic Hermite interpolation along the diagonals crossing them.
+ **/
+struct TriQuadraticInterpolation
+{
+    static constexpr uint32_t VALUES_PER_VERTEX = 4;
+    static constexpr uint32_t EXTRA_VALUES = 0;
+    static constexpr uint32_t NUM_COEFFICIENTS = 27;
+
+    inline static void calculatePointValues(glm::vec3 point,
+                                      uint32_t nearestTriangleIndex,
+                                      const Mesh& mesh,
+                                      const std::vector<TriangleUtils::TriangleData>& trianglesData, 
+                                      std::array<float, VALUES_PER_VERTEX>& outValues)
+    {
+        const std::vector<uint32_t>& indices = mesh.getIndices();
+        const std::vector<glm::vec3>& vertices = mesh.getVertices();
+        glm::vec3 gradient;
+        outValues[0] = TriangleUtils::getSignedDistPointAndTriangle(point, trianglesData[nearestTriangleIndex], 
+                                                                    vertices[indices[3 * nearestTriangleIndex]],
+                                                                    vertices[indices[3 * nearestTriangleIndex + 1]],
+                                                                    vertices[indices[3 * nearestTriangleIndex + 2]],
+                                                                    gradient);
+
+        outValues[1] = gradient.x; outValues[2] = gradient.y; outValues[3] = gradient.z;
+    }
+
+    inline static void calculateCoefficients(const std::array<std::array<float, VALUES_PER_VERTEX>, 8>& inValues,
+                                             float nodeSize,
+                                             const std::vector<uint32_t>& triangles,
+                                             const Mesh& mesh,
+                                             const std::vector<TriangleUtils::TriangleData>& trianglesData,
+                                             std::array<float, NUM_COEFFICIENTS>& outCoeff) 
+    {
+        // Derivative from the vertex a to the vertex b along the segment joining them
+        auto getDerivative = [&](uint32_t a, uint32_t b, uint32_t vertex)
+        {
+            float derivative = 0.0f;
+            for(uint32_t axis=0; axis < 3; axis++)
+            {
+                const float dir = static_cast<float>((b >> axis) & 1) - static_cast<float>((a >> axis) & 1);
+                derivative += dir * inValues[vertex][1 + axis];
+            }
+            return nodeSize * derivative;
+        };
+
+        // Values at the 3x3x3 grid of the node
+        for(uint32_t k=0; k < 3; k++)
+        {
+            for(uint32_t j=0; j < 3; j++)
+            {
+                for(uint32_t i=0; i < 3; i++)
+                {
+                    const uint32_t pos[3] = {i, j, k};
+                    uint32_t middleMask = 0;
+                    uint32_t baseVertex = 0;
+                    for(uint32_t axis=0; axis < 3; axis++)
+                    {
+                        if(pos[axis] == 1) middleMask |= 1 << axis;
+                        else if(pos[axis] == 2) baseVertex |= 1 << axis;
+                    }
+
+                    float value = 0.0f;
+                    uint32_t numDiagonals = 0;
+                    for(uint32_t a=0; a < 8; a++)
+                    {
+                        // Each diagonal is visited once, from the vertex with the lowest middle axis set to zero
+                        if((a & ~middleMask) != baseVertex || (a & (middleMask & (~middleMask + 1))) != 0) continue;
+                        const uint32_t b = a ^ middleMask;
+                        value += 0.5f * (inValues[a][0] + inValues[b][0]) + 
+                                 0.125f * (getDerivative(a, b, a) - getDerivative(a, b, b));
+                        numDiagonals++;
+                    }
+                    outCoeff[9 * k + 3 * j + i] = (middleMask == 0) ? inValues[baseVertex][0]
+                                                                    : value / static_cast<float>(numDiagonals);
+                }
+            }
+        }
+
+        // Convert the values to the Bernstein coefficients one axis at a time
+        constexpr uint32_t axisStride[3] = {1, 3, 9};
+        for(uint32_t axis=0; axis < 3; axis++)
+        {
+            const uint32_t stride = axisStride[axis];
+            for(uint32_t c=0; c < NUM_COEFFICIENTS; c++)
+            {
+                if((c / stride) % 3 != 1) continue;
+                outCoeff[c] = 2.0f * outCoeff[c] - 0.5f * (outCoeff[c - stride] + outCoeff[c + stride]);
+            }
+        }
+    }
+
+    inline static float interpolateValue(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart) 
+    {
+        const glm::vec3 invFracPart = 1.0f - fracPart;
+        const glm::vec3 b0 = invFracPart * invFracPart;
+        const glm::vec3 b1 = 2.0f * fracPart * invFracPart;
+        const glm::vec3 b2 = fracPart * fracPart;
+
+        float result = 0.0f;
+        for(uint32_t k=0; k < 3; k++)
+        {
+            float zValue = 0.0f;
+            for(uint32_t j=0; j < 3; j++)
+            {
+                const float* row = &values[9 * k + 3 * j];
+                const float rowValue = row[0] * b0.x + row[1] * b1.x + row[2] * b2.x;
+                zValue += rowValue * ((j == 0) ? b0.y : (j == 1) ? b1.y : b2.y);
+            }
+            result += zValue * ((k == 0) ? b0.z : (k == 1) ? b1.z : b2.z);
+        }
+
+        return result;
+    }
+
+    inline static glm::vec3 interpolateGradient(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart) 
+    {
+        const glm::vec3 invFracPart = 1.0f - fracPart;
+        const glm::vec3 b[3] = { invFracPart * invFracPart, 2.0f * fracPart * invFracPart, fracPart * fracPart };
+        const glm::vec3 db[3] = { -2.0f * invFracPart, 2.0f * (invFracPart - fracPart), 2.0f * fracPart };
+
+        glm::vec3 gradient(0.0f);
+        for(uint32_t k=0; k < 3; k++)
+        {
+            for(uint32_t j=0; j < 3; j++)
+            {
+                for(uint32_t i=0; i < 3; i++)
+                {
+                    const float c = values[9 * k + 3 * j + i];
+                    gradient.x += c * db[i].x * b[j].y * b[k].z;
+                    gradient.y += c * b[i].x * db[j].y * b[k].z;
+                    gradient.z += c * b[i].x * b[j].y * db[k].z;
+                }
+            }
+        }
+
+        return gradient;
+    }
+
+    /**
+     * @brief Computes the value and the gradient sharing the Bernstein bases of each axis.
+     * @return The interpolated value
+     **/
+    inline static float interpolateValueAndGradient(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, glm::vec3& outGradient)
+    {
+        const glm::vec3 invFracPart = 1.0f - fracPart;
+        const glm::vec3 b[3] = { invFracPart * invFracPart, 2.0f * fracPart * invFracPart, fracPart * fracPart };
+        const glm::vec3 db[3] = { -2.0f * invFracPart, 2.0f * (invFracPart - fracPart), 2.0f * fracPart };
+
+        float result = 0.0f;
+        outGradient = glm::vec3(0.0f);
+        for(uint32_t k=0; k < 3; k++)
+        {
+            float zValue = 0.0f;
+            float zGradX = 0.0f;
+            float zGradY = 0.0f;
+            for(uint32_t j=0; j < 3; j++)
+            {
+                const float* row = &values[9 * k + 3 * j];
+                const float rowValue = row[0] * b[0].x + row[1] * b[1].x + row[2] * b[2].x;
+                const float rowGrad = row[0] * db[0].x + row[1] * db[1].x + row[2] * db[2].x;
+                zValue += rowValue * b[j].y;
+                zGradX += rowGrad * b[j].y;
+                zGradY += rowValue * db[j].y;
+            }
+            result += zValue * b[k].z;
+            outGradient += glm::vec3(zGradX * b[k].z, zGradY * b[k].z, zValue * db[k].z);
+        }
+
+        return result;
+    }
+
+    inline static void interpolateVertexValues(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, float nodeSize, std::array<float, VALUES_PER_VERTEX>& outValues)
+    {
+        outValues[0] = interpolateValue(values, fracPart);
+        const glm::vec3 gradient = interpolateGradient(values, fracPart) / nodeSize;
+        outValues[1] = gradient.x; outValues[2] = gradient.y; outValues[3] = gradient.z;
+    }
+
+    inline static bool isIsosurfaceInside(const std::array<float, NUM_COEFFICIENTS>& values)
+    {
+        // The polynomial is inside the convex hull of its Bernstein coefficients
+        float min = INFINITY;
+        float max = -INFINITY;
+        for(uint32_t i=0; i < NUM_COEFFICIENTS; i++)
+        {
+            min = glm::min(min, values[i]);
+            max = glm::max(max, values[i]);
+        }
+
+        return min < 1e-5 && max > -1e-5;
+    }
+};
+
 // struct TriCubicInterpolation
 // {
 //     static constexpr uint32_t VALUES_PER_VERTEX = 4;
@@ -472,6 +699,50 @@ struct TriCubicInterpolation
                         + 3 * values[48] * fracPart[2] * fracPart[2] + 3 * values[49] * fracPart[0] * fracPart[2] * fracPart[2] + 3 * values[50] * fracPart[0] * fracPart[0] * fracPart[2] * fracPart[2] + 3 * values[51] * fracPart[0] * fracPart[0] * fracPart[0] * fracPart[2] * fracPart[2] + 3 * values[52] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[53] * fracPart[0] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[54] * fracPart[0] * fracPart[0] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[55] * fracPart[0] * fracPart[0] * fracPart[0] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[56] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[57] * fracPart[0] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[58] * fracPart[0] * fracPart[0] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[59] * fracPart[0] * fracPart[0] * fracPart[0] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[60] * fracPart[1] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[61] * fracPart[0] * fracPart[1] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[62] * fracPart[0] * fracPart[0] * fracPart[1] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2] + 3 * values[63] * fracPart[0] * fracPart[0] * fracPart[0] * fracPart[1] * fracPart[1] * fracPart[1] * fracPart[2] * fracPart[2]);
     }
 
+    /**
+     * @brief Computes the value and the gradient sharing the powers of each axis.
+     *        The polynomial is evaluated row by row, so each coefficient is read once.
+     * @return The interpolated value
+     **/
+    inline static float interpolateValueAndGradient(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, glm::vec3& outGradient)
+    {
+        const glm::vec3 p1 = fracPart;
+        const glm::vec3 p2 = fracPart * fracPart;
+        const glm::vec3 p3 = p2 * fracPart;
+        const glm::vec3 dp2 = 2.0f * fracPart;
+        const glm::vec3 dp3 = 3.0f * p2;
+
+        float result = 0.0f;
+        outGradient = glm::vec3(0.0f);
+        for(uint32_t k=0; k < 4; k++)
+        {
+            float zValue = 0.0f;
+            float zGradX = 0.0f;
+            float zGradY = 0.0f;
+            float yPow = 1.0f;
+            float yPowDerivative = 0.0f;
+            for(uint32_t j=0; j < 4; j++)
+            {
+                const float* row = &values[16 * k + 4 * j];
+                const float rowValue = row[0] + row[1] * p1.x + row[2] * p2.x + row[3] * p3.x;
+                const float rowGrad = row[1] + row[2] * dp2.x + row[3] * dp3.x;
+                zValue += rowValue * yPow;
+                zGradX += rowGrad * yPow;
+                zGradY += rowValue * yPowDerivative;
+
+                yPowDerivative = static_cast<float>(j + 1) * yPow;
+                yPow *= p1.y;
+            }
+
+            const float zPow = (k == 0) ? 1.0f : (k == 1) ? p1.z : (k == 2) ? p2.z : p3.z;
+            const float zPowDerivative = (k == 0) ? 0.0f : (k == 1) ? 1.0f : (k == 2) ? dp2.z : dp3.z;
+            result += zValue * zPow;
+            outGradient += glm::vec3(zGradX * zPow, zGradY * zPow, zValue * zPowDerivative);
+        }
+
+        return result;
+    }
+
     inline static void interpolateVertexValues(const std::array<float, NUM_COEFFICIENTS>& values, glm::vec3 fracPart, float nodeSize, std::array<float, VALUES_PER_VERTEX>& outValues)
     {
         outValues[0] = 0.0f
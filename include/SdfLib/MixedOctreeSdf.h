@@ -0,0 +1,83 @@
+#ifndef MIXED_OCTREE_SDF_H
+#define MIXED_OCTREE_SDF_H
+
+#include <memory>
+#include <spdlog/spdlog.h>
+
+#include "SdfLib/InterpolationMethods.h"
+#include "OctreeSdf.h"
+
+#include <cereal/types/vector.hpp>
+
+namespace sdflib
+{
+/**
+ * @brief Octree whose leaves use trilinear or tricubic interpolation.
+ *        The order of each leaf is stored in the mark bit of its node, a marked leaf is tricubic.
+ *        The structure is built merging a trilinear and a tricubic octree generated with the same error threshold.
+ *        Each region takes the subtree of the octree that needs less bytes, so the result keeps
+ *        the error of both octrees and it is never bigger than any of them.
+ **/
+class MixedOctreeSdf : public IOctreeSdf
+{
+public:
+    MixedOctreeSdf() {}
+
+    /**
+     * @brief Merges a trilinear and a tricubic octree.
+     *        It returns nullptr if the octrees do not cover the same area with the same start grid,
+     *        if they only store the isosurface or if they have segmented indices.
+     *        The subtrees shared by compressed octrees are expanded.
+     * @param linearOctree The octree with trilinear interpolation.
+     * @param cubicOctree The octree with tricubic interpolation.
+     **/
+    static std::unique_ptr<MixedOctreeSdf> fromOctrees(const TOctreeSdf<TriLinearInterpolation>& linearOctree,
+                                                       const TOctreeSdf<TriCubicInterpolation>& cubicOctree);
+
+    float getDistance(glm::vec3 sample) const override;
+    float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+    SdfFormat getFormat() const override { return SdfFormat::MIXED_OCTREE; }
+
+    /**
+     * @brief The octree array is split into the nodes and the coefficients of each interpolation order.
+     **/
+    MemoryUsage getMemoryUsage() const override;
+
+    /**
+     * @return The number of leaves using trilinear interpolation
+     **/
+    uint32_t getNumLinearLeaves() const { return mNumLinearLeaves; }
+
+    /**
+     * @return The number of leaves using tricubic interpolation
+     **/
+    uint32_t getNumCubicLeaves() const { return mNumCubicLeaves; }
+
+    // Load and save function for storing the structure on disk
+    template<class Archive>
+    void save(Archive & archive) const
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mFarFieldProxy);
+        archive(mNumLinearLeaves, mNumCubicLeaves, mOctreeData);
+    }
+
+    template<class Archive>
+    void load(Archive & archive)
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mFarFieldProxy);
+        archive(mNumLinearLeaves, mNumCubicLeaves, mOctreeData);
+
+        mStartGridCellSize = mBox.getSize().x / static_cast<float>(mStartGridSize);
+        mStartGridXY = mStartGridSize * mStartGridSize;
+
+        float total = mOctreeData.size() * sizeof(OctreeNode);
+        SPDLOG_INFO("Mixed Octree Sdf Total: {}MB", total/1048576.0f);
+    }
+
+private:
+    uint32_t mNumLinearLeaves = 0;
+    uint32_t mNumCubicLeaves = 0;
+};
+}
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef MORTON_OCTREE_SDF_H
+#define MORTON_OCTREE_SDF_H
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <limits>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+
+#include "SdfLib/InterpolationMethods.h"
+#include "utils/FarFieldProxy.h"
+#include "utils/QueryStats.h"
+#include "OctreeSdf.h"
+
+#include <cereal/types/vector.hpp>
+
+namespace sdflib
+{
+/**
+ * @brief Linear octree storing only the leaves, sorted by the Morton code of their minimum corner.
+ *        The leaves cover all the octree area, so the leaf containing a sample is the last one
+ *        with a code lower or equal than the sample code.
+ *        A directory indexed by the first levels of the code bounds the binary search,
+ *        avoiding the dependent loads of the pointer-based traversal.
+ **/
+template <typename InterpolationMethod=TriLinearInterpolation>
+class TMortonOctreeSdf : public SdfFunction
+{
+public:
+    // Maximum depth that fits in the 64 bits codes
+    static constexpr uint32_t MAX_SUPPORTED_DEPTH = 21;
+
+    TMortonOctreeSdf() {}
+
+    /**
+     * @brief Converts an octree to the linear representation.
+     *        It returns nullptr if the octree is deeper than MAX_SUPPORTED_DEPTH.
+     * @param octree The octree to convert.
+     **/
+    static std::unique_ptr<TMortonOctreeSdf> fromOctree(const TOctreeSdf<InterpolationMethod>& octree);
+
+    float getDistance(glm::vec3 sample) const override;
+    float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+    BoundingBox getSampleArea() const override { return mBox; }
+    SdfFunction::SdfFormat getFormat() const override { return SdfFunction::SdfFormat::NONE; }
+    float getMinCellSize() const override { return mBox.getSize().x / static_cast<float>(1u << mMaxDepth); }
+
+    /**
+     * @return The octree bounding box
+     **/
+    const BoundingBox& getGridBoundingBox() const { return mBox; }
+
+    /**
+     * @return The octree maximum depth
+     **/
+    uint32_t getOctreeMaxDepth() const { return mMaxDepth; }
+
+    /**
+     * @return The number of leaves of the octree
+     **/
+    uint32_t getNumLeaves() const { return static_cast<uint32_t>(mLeafKeys.size()); }
+
+    /**
+     * @return The maximum number of leaves that a query has to search
+     **/
+    uint32_t getMaxLeavesPerDirectoryCell() const { return mMaxLeavesPerCell; }
+
+    /**
+     * @brief Enables or disables the recording of the query counters.
+     **/
+    void setQueryStatsEnabled(bool enabled) { mQueryStats.setEnabled(enabled); }
+    /**
+     * @return The query counters added up over all the threads
+     **/
+    QueryStats getQueryStats() const { return mQueryStats.getStats(); }
+    void resetQueryStats() { mQueryStats.reset(); }
+
+    // Load and save function for storing the structure on disk
+    template<class Archive>
+    void save(Archive & archive) const
+    {
+        archive(mBox, mMaxDepth, mMinBorderValue, mFarFieldProxy, mDirectoryDepth);
+        archive(mLeafKeys, mLeafDepths, mCoefficients, mDirectory);
+    }
+
+    template<class Archive>
+    void load(Archive & archive)
+    {
+        archive(mBox, mMaxDepth, mMinBorderValue, mFarFieldProxy, mDirectoryDepth);
+        archive(mLeafKeys, mLeafDepths, mCoefficients, mDirectory);
+
+        computeDirectoryStats();
+
+        float total = mLeafKeys.size() * sizeof(uint64_t) + mLeafDepths.size() * sizeof(uint8_t) +
+                      mCoefficients.size() * sizeof(float) + mDirectory.size() * sizeof(uint32_t);
+        SPDLOG_INFO("Morton Octree Sdf Total: {}MB", total/1048576.0f);
+    }
+
+private:
+    // The leaf has been removed because it did not contain the isosurface
+    static constexpr uint8_t EMPTY_LEAF_MASK = 1 << 7;
+    static constexpr uint8_t DEPTH_MASK = ~EMPTY_LEAF_MASK;
+    static constexpr uint32_t MAX_DIRECTORY_DEPTH = 7;
+
+    BoundingBox mBox;
+    uint32_t mMaxDepth = 0;
+    float mMinBorderValue = 0.0f;
+    FarFieldProxy mFarFieldProxy;
+
+    // Morton code of the minimum corner of each leaf at the maximum depth resolution
+    std::vector<uint64_t> mLeafKeys;
+    // Depth of each leaf and the empty leaf flag
+    std::vector<uint8_t> mLeafDepths;
+    // Coefficients of the leaves stored in the same order than the keys
+    std::vector<float> mCoefficients;
+
+    // Index of the leaf containing the first point of each directory cell
+    uint32_t mDirectoryDepth = 0;
+    std::vector<uint32_t> mDirectory;
+
+    // Not serialized
+    float mInvCellSize = 0.0f;
+    uint32_t mMaxLeavesPerCell = 0;
+
+    // Optional counters of the work done by the queries
+    QueryStatsCounter mQueryStats;
+
+    static inline uint64_t spreadBits(uint64_t v)
+    {
+        v &= 0x1fffff;
+        v = (v | (v << 32)) & 0x1f00000000ffffull;
+        v = (v | (v << 16)) & 0x1f0000ff0000ffull;
+        v = (v | (v << 8)) & 0x100f00f00f00f00full;
+        v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+        v = (v | (v << 2)) & 0x1249249249249249ull;
+        return v;
+    }
+
+    static inline uint64_t getMortonCode(glm::uvec3 pos)
+    {
+        return spreadBits(pos.x) | (spreadBits(pos.y) << 1) | (spreadBits(pos.z) << 2);
+    }
+
+    /**
+     * @return The index of the leaf containing the sample or false if it is outside the octree
+     **/
+    bool findLeaf(glm::vec3 sample, uint32_t& outLeafIndex, uint32_t& outSearchSteps) const;
+    void computeDirectoryStats();
+};
+
+template<>
+inline SdfFunction::SdfFormat TMortonOctreeSdf<TriLinearInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRILINEAR_MORTON_OCTREE;
+}
+
+template<>
+inline SdfFunction::SdfFormat TMortonOctreeSdf<TriCubicInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRICUBIC_MORTON_OCTREE;
+}
+
+typedef TMortonOctreeSdf<> MortonOctreeSdf;
+
+// --- Public method definition --- //
+template<typename InterpolationMethod>
+std::unique_ptr<TMortonOctreeSdf<InterpolationMethod>> TMortonOctreeSdf<InterpolationMethod>::fromOctree(const TOctreeSdf<InterpolationMethod>& octree)
+{
+    typedef IOctreeSdf::OctreeNode OctreeNode;
+    if(octree.getOctreeMaxDepth() > MAX_SUPPORTED_DEPTH)
+    {
+        SPDLOG_ERROR("The octree depth {} is greater than the maximum depth supported by the Morton codes {}",
+                     octree.getOctreeMaxDepth(), MAX_SUPPORTED_DEPTH);
+        return std::unique_ptr<TMortonOctreeSdf>();
+    }
+
+    if(octree.hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The Morton conversion is not supported by octrees with segmented indices");
+        return std::unique_ptr<TMortonOctreeSdf>();
+    }
+
+    std::unique_ptr<TMortonOctreeSdf> obj(new TMortonOctreeSdf());
+    obj->mBox = octree.getGridBoundingBox();
+    obj->mMaxDepth = octree.getOctreeMaxDepth();
+    obj->mMinBorderValue = octree.getOctreeMinBorderValue();
+    obj->mFarFieldProxy = octree.getFarFieldProxy();
+
+    const LargeArray<OctreeNode>& octreeData = octree.getOctreeData();
+    const uint32_t startGridSize = octree.getStartGridSize().x;
+    const uint32_t startDepth = glm::findMSB(startGridSize);
+
+    struct LeafInfo
+    {
+        uint64_t key;
+        uint32_t depth;
+        uint32_t coefficientsIndex;
+    };
+    std::vector<LeafInfo> leaves;
+
+    std::function<void(uint32_t, glm::uvec3, uint32_t)> vistNode;
+    vistNode = [&](uint32_t nodeIndex, glm::uvec3 pos, uint32_t depth)
+    {
+        const OctreeNode& node = octreeData[nodeIndex];
+        if(!node.isLeaf())
+        {
+            for(uint32_t i=0; i < 8; i++)
+            {
+                const glm::uvec3 childPos = 2u * pos + glm::uvec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+                vistNode(node.getChildrenIndex() + i, childPos, depth + 1);
+            }
+        }
+        else
+        {
+            leaves.push_back({ getMortonCode(pos << (obj->mMaxDepth - depth)), depth, node.getChildrenIndex() });
+        }
+    };
+
+    for(uint32_t k=0; k < startGridSize; k++)
+    {
+        for(uint32_t j=0; j < startGridSize; j++)
+        {
+            for(uint32_t i=0; i < startGridSize; i++)
+            {
+                vistNode(k * startGridSize * startGridSize + j * startGridSize + i, glm::uvec3(i, j, k), startDepth);
+            }
+        }
+    }
+
+    std::sort(leaves.begin(), leaves.end(), [](const LeafInfo& a, const LeafInfo& b) { return a.key < b.key; });
+
+    obj->mLeafKeys.resize(leaves.size());
+    obj->mLeafDepths.resize(leaves.size());
+    obj->mCoefficients.resize(leaves.size() * InterpolationMethod::NUM_COEFFICIENTS, 0.0f);
+    for(uint32_t l=0; l < leaves.size(); l++)
+    {
+        obj->mLeafKeys[l] = leaves[l].key;
+        obj->mLeafDepths[l] = static_cast<uint8_t>(leaves[l].depth);
+        if(leaves[l].coefficientsIndex >= octreeData.size())
+        {
+            obj->mLeafDepths[l] |= EMPTY_LEAF_MASK;
+        }
+        else
+        {
+            for(uint32_t c=0; c < InterpolationMethod::NUM_COEFFICIENTS; c++)
+            {
+                obj->mCoefficients[l * InterpolationMethod::NUM_COEFFICIENTS + c] = octreeData[leaves[l].coefficientsIndex + c].value;
+            }
+        }
+    }
+
+    // Use around one directory cell for every eight leaves
+    obj->mDirectoryDepth = 0;
+    while(obj->mDirectoryDepth < glm::min(obj->mMaxDepth, MAX_DIRECTORY_DEPTH) &&
+          (1ull << (3 * (obj->mDirectoryDepth + 1))) <= leaves.size() / 8)
+    {
+        obj->mDirectoryDepth++;
+    }
+
+    const uint32_t numCells = 1 << (3 * obj->mDirectoryDepth);
+    const uint32_t cellShift = 3 * (obj->mMaxDepth - obj->mDirectoryDepth);
+    obj->mDirectory.resize(numCells);
+    for(uint32_t c=0; c < numCells; c++)
+    {
+        const uint64_t cellStartKey = static_cast<uint64_t>(c) << cellShift;
+        obj->mDirectory[c] = static_cast<uint32_t>(std::upper_bound(obj->mLeafKeys.begin(), obj->mLeafKeys.end(), cellStartKey) - obj->mLeafKeys.begin()) - 1;
+    }
+
+    obj->computeDirectoryStats();
+
+    SPDLOG_INFO("Morton octree with {} leaves, directory depth {}, maximum leaves per cell {}",
+                leaves.size(), obj->mDirectoryDepth, obj->mMaxLeavesPerCell);
+
+    return obj;
+}
+
+template<typename InterpolationMethod>
+void TMortonOctreeSdf<InterpolationMethod>::computeDirectoryStats()
+{
+    mInvCellSize = static_cast<float>(1 << mMaxDepth) / mBox.getSize().x;
+    mMaxLeavesPerCell = 0;
+    for(uint32_t c=0; c < mDirectory.size(); c++)
+    {
+        const uint32_t end = (c + 1 < mDirectory.size()) ? mDirectory[c + 1] : static_cast<uint32_t>(mLeafKeys.size()) - 1;
+        mMaxLeavesPerCell = glm::max(mMaxLeavesPerCell, end - mDirectory[c] + 1);
+    }
+}
+
+template<typename InterpolationMethod>
+inline bool TMortonOctreeSdf<InterpolationMethod>::findLeaf(glm::vec3 sample, uint32_t& outLeafIndex, uint32_t& outSearchSteps) const
+{
+    const glm::vec3 pos = glm::floor((sample - mBox.min) * mInvCellSize);
+    const float maxPos = static_cast<float>(1 << mMaxDepth);
+    if(pos.x < 0.0f || pos.y < 0.0f || pos.z < 0.0f ||
+       pos.x >= maxPos || pos.y >= maxPos || pos.z >= maxPos)
+    {
+        return false;
+    }
+
+    const uint64_t key = getMortonCode(glm::uvec3(pos));
+    const uint64_t cell = key >> (3 * (mMaxDepth - mDirectoryDepth));
+
+    // The leaf is between the leaves containing the start of this cell and the start of the next one
+    uint32_t first = mDirectory[cell];
+    uint32_t count = ((cell + 1 < mDirectory.size()) ? mDirectory[cell + 1] : static_cast<uint32_t>(mLeafKeys.size()) - 1) - first + 1;
+    outSearchSteps = 0;
+    while(count > 1)
+    {
+        const uint32_t half = count / 2;
+        first = (mLeafKeys[first + half] <= key) ? first + half : first;
+        count -= half;
+        outSearchSteps++;
+    }
+
+    outLeafIndex = first;
+    return true;
+}
+
+template<typename InterpolationMethod>
+float TMortonOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample) const
+{
+    uint32_t leafIndex;
+    uint32_t searchSteps;
+    if(!findLeaf(sample, leafIndex, searchSteps))
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        return glm::max(mBox.getDistance(sample) + mMinBorderValue, mFarFieldProxy.getDistance(sample));
+    }
+
+    const uint8_t depth = mLeafDepths[leafIndex];
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(searchSteps + 1, depth & DEPTH_MASK);
+
+    if(depth & EMPTY_LEAF_MASK) return 10.0;
+
+    const float leafSize = mBox.getSize().x / static_cast<float>(1 << (depth & DEPTH_MASK));
+    const glm::vec3 fracPart = glm::fract((sample - mBox.min) / leafSize);
+
+    auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&mCoefficients[leafIndex * InterpolationMethod::NUM_COEFFICIENTS]);
+    return InterpolationMethod::interpolateValue(values, fracPart);
+}
+
+template<typename InterpolationMethod>
+float TMortonOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    uint32_t leafIndex;
+    uint32_t searchSteps;
+    if(!findLeaf(sample, leafIndex, searchSteps))
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        const float boxDist = mBox.getDistance(sample, outGradient) + mMinBorderValue;
+        glm::vec3 proxyGradient;
+        const float proxyDist = mFarFieldProxy.getDistance(sample, proxyGradient);
+        if(proxyDist > boxDist)
+        {
+            outGradient = proxyGradient;
+            return proxyDist;
+        }
+        return boxDist;
+    }
+
+    const uint8_t depth = mLeafDepths[leafIndex];
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(searchSteps + 1, depth & DEPTH_MASK);
+
+    if(depth & EMPTY_LEAF_MASK)
+    {
+        outGradient = glm::vec3(0.0f);
+        return 10.0;
+    }
+
+    const float leafSize = mBox.getSize().x / static_cast<float>(1 << (depth & DEPTH_MASK));
+    const glm::vec3 fracPart = glm::fract((sample - mBox.min) / leafSize);
+
+    auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&mCoefficients[leafIndex * InterpolationMethod::NUM_COEFFICIENTS]);
+    const float distance = InterpolationMethod::interpolateValueAndGradient(values, fracPart, outGradient);
+    outGradient = glm::normalize(outGradient);
+    return distance;
+}
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <optional>
 
 #include "utils/Mesh.h"
+#include "utils/SharedBlocks.h"
 #include "utils/TriangleUtils.h"
 #include "utils/UsefullSerializations.h"
 
@@ -67,21 +68,65 @@ public:
     float getDistance(glm::vec3 sample) const override;
     float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
 
+    /**
+     * @brief Like getDistance, but the gradient is not normalized. It is the gradient of the interpolated field
+     *        in world units, so it saves the normalization when the callers do not need unit normals.
+     **/
+    float getDistanceAndUnnormalizedGradient(glm::vec3 sample, glm::vec3& outGradient) const;
+
+    // The index of the returned nodes is relative to the offset of its start grid cell
     OctreeNode getGridNode(glm::vec3 sample, glm::vec3& leafPos, float& leafSize) const;
     OctreeNode getLeaf(glm::vec3 sample, glm::vec3& leafPos, float& leafSize) const;
 	SdfFunction::SdfFormat getFormat() const override { return SdfFunction::SdfFormat::NONE; }
 
+    /**
+     * @brief The octree array is split into the nodes and the leaves coefficients.
+     *        The subtrees and coefficients shared by a compressed octree are counted once.
+     **/
+    MemoryUsage getMemoryUsage() const override;
+
+    /**
+     * @brief Reorders the octree array to improve the cache usage of the queries.
+     *        The children of the first levels below the start grid are packed together,
+     *        and the rest of the nodes are stored in depth-first order with the leaves
+     *        coefficients next to their nodes. Each coefficients block is aligned to
+     *        the cache line, or to its own size if it is smaller.
+     *        It can be called after the construction or after loading the structure from disk.
+     * @param hotLevels Number of levels below the start grid stored in breadth-first order
+     * @return If the octree has been reordered. The original array is kept if the octree has segmented indices
+     *         or if the padding of the coefficients makes the array too large to be addressed by the nodes.
+     **/
+    bool relayoutOctreeData(uint32_t hotLevels = 2);
+
+    /**
+     * @brief Shares the identical leaves coefficients and the identical subtrees,
+     *        converting the octree into a directed acyclic graph.
+     *        The queries traverse it as the original octree and the result is exactly the same.
+     *        The relayout can be applied after the compression to align the coefficients again.
+     * @return The number of nodes removed
+     **/
+    uint32_t compressOctreeData();
+
     // Load and save function for storing the structure on disk
+    // The version 0 is the layout before the far-field proxy and the segmented indices were added
     template<class Archive>
-    void save(Archive & archive) const
+    void save(Archive & archive, std::uint32_t const version) const
     { 
         archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mOctreeData);
+        if(version >= 1) archive(mFarFieldProxy, mStartCellOffsets);
     }
 
     template<class Archive>
-    void load(Archive & archive)
+    void load(Archive & archive, std::uint32_t const version)
     {
         archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mOctreeData);
+
+        if(version >= 1) archive(mFarFieldProxy, mStartCellOffsets);
+        else
+        {
+            mFarFieldProxy = FarFieldProxy();
+            mStartCellOffsets.clear();
+        }
         
         mStartGridCellSize = mBox.getSize().x / static_cast<float>(mStartGridSize);
         mStartGridXY = mStartGridSize * mStartGridSize;
@@ -90,7 +135,40 @@ public:
         SPDLOG_INFO("Octree Sdf Total: {}MB", total/1048576.0f);
     } 
 
+    // Load and save functions for the compressed format, the octree array is stored in one chunk per start grid cell.
+    // The chunks are encoded before saving them, so nothing is written if the octree cannot be compressed.
+    bool encodeCompressed(std::vector<std::vector<uint8_t>>& outChunks) const
+    {
+        return encodeOctreeChunks(InterpolationMethod::NUM_COEFFICIENTS, outChunks);
+    }
+
+    template<class Archive>
+    void saveCompressed(Archive & archive, const std::vector<std::vector<uint8_t>>& chunks) const
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mFarFieldProxy);
+        archive(chunks);
+    }
+
+    template<class Archive>
+    bool loadCompressed(Archive & archive)
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mFarFieldProxy);
+        std::vector<std::vector<uint8_t>> chunks;
+        archive(chunks);
+
+        mStartGridCellSize = mBox.getSize().x / static_cast<float>(mStartGridSize);
+        mStartGridXY = mStartGridSize * mStartGridSize;
+        if(!decodeOctreeChunks(InterpolationMethod::NUM_COEFFICIENTS, chunks)) return false;
+
+        float total = mOctreeData.size() * sizeof(OctreeNode);
+        SPDLOG_INFO("Octree Sdf Total: {}MB", total/1048576.0f);
+        return true;
+    }
+
 private:
+    template<bool NormalizeGradient>
+    float queryDistanceAndGradient(glm::vec3 sample, glm::vec3& outGradient) const;
+
     // Option to delay the node termination and recyle the distances already calculated
     static constexpr bool DELAY_NODE_TERMINATION = false;
 
@@ -115,6 +193,8 @@ private:
 
         mSdfOnlyAySurface = terminationRule == TerminationRule::ISOSURFACE; 
 
+        mFarFieldProxy = FarFieldProxy(mesh);
+
         switch(initAlgorithm)
         {
             case TOctreeSdf::InitAlgorithm::UNIFORM:
@@ -139,6 +219,17 @@ private:
             //     break;
         }
 
+        if(!hasAddressableIndices())
+        {
+            SPDLOG_ERROR("The octree array exceeds the maximum node index ({}), the octree has not been built", 
+                         OctreeNode::CHILDREN_INDEX_MASK);
+            mOctreeData.clear();
+            mStartCellOffsets.clear();
+            return;
+        }
+
+        // The isosurface reduction runs after the builders instead of inside them, because computeMinBorderValue
+        // needs the leaves it discards. It works in place, so the peak is the built octree plus the reduced array.
         computeMinBorderValue();
         if(terminationRule == TOctreeSdf::TerminationRule::ISOSURFACE)
         {
@@ -172,7 +263,8 @@ private:
 
     void computeMinBorderValue();
 
-    // Function reduces leafs that do not contain the isosurface
+    // Function reduces leafs that do not contain the isosurface.
+    // It only needs two bits per element of the octree array besides the reduced array.
     void reduceTree();
 };
 
@@ -188,6 +280,12 @@ inline SdfFunction::SdfFormat TOctreeSdf<TriCubicInterpolation>::getFormat() con
     return SdfFunction::SdfFormat::TRICUBIC_OCTREE;
 }
 
+template<>
+inline SdfFunction::SdfFormat TOctreeSdf<TriQuadraticInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRIQUADRATIC_OCTREE;
+}
+
 typedef TOctreeSdf<> OctreeSdf;
 
 // --- Public method definition --- //
@@ -207,10 +305,15 @@ float TOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample) const
        startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
        startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
     {
-        return mBox.getDistance(sample) + mMinBorderValue;
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        return glm::max(mBox.getDistance(sample) + mMinBorderValue, mFarFieldProxy.getDistance(sample));
     }
 
-    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+    const uint32_t startCellIndex = startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x;
+    const uint64_t offset = getStartCellOffset(startCellIndex);
+    const OctreeNode* nodes = mOctreeData.data() + offset;
+    const OctreeNode* currentNode = &mOctreeData[startCellIndex];
+    uint32_t levels = 0;
 
     while(!currentNode->isLeaf())
     {
@@ -218,19 +321,35 @@ float TOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample) const
                                   (roundFloat(fracPart.y) << 1) + 
                                    roundFloat(fracPart.x);
 
-        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        currentNode = &nodes[currentNode->getChildrenIndex() + childIdx];
         fracPart = glm::fract(2.0f * fracPart);
+        levels++;
     }
 
-    if(currentNode->getChildrenIndex() >= mOctreeData.size()) return 10.0;
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(levels + 1, glm::findMSB(mStartGridSize) + levels);
 
-    auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&mOctreeData[currentNode->getChildrenIndex()]);
+    if(offset + currentNode->getChildrenIndex() >= mOctreeData.size()) return 10.0;
+
+    auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&nodes[currentNode->getChildrenIndex()]);
 
     return InterpolationMethod::interpolateValue(values, fracPart);
 }
 
 template<typename InterpolationMethod>
 float TOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    return queryDistanceAndGradient<true>(sample, outGradient);
+}
+
+template<typename InterpolationMethod>
+float TOctreeSdf<InterpolationMethod>::getDistanceAndUnnormalizedGradient(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    return queryDistanceAndGradient<false>(sample, outGradient);
+}
+
+template<typename InterpolationMethod>
+template<bool NormalizeGradient>
+float TOctreeSdf<InterpolationMethod>::queryDistanceAndGradient(glm::vec3 sample, glm::vec3& outGradient) const
 {
     auto roundFloat = [](float a) -> uint32_t
     {
@@ -245,10 +364,23 @@ float TOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample, glm::vec3&
        startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
        startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
     {
-        return mBox.getDistance(sample, outGradient) + mMinBorderValue;
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        const float boxDist = mBox.getDistance(sample, outGradient) + mMinBorderValue;
+        glm::vec3 proxyGradient;
+        const float proxyDist = mFarFieldProxy.getDistance(sample, proxyGradient);
+        if(proxyDist > boxDist)
+        {
+            outGradient = proxyGradient;
+            return proxyDist;
+        }
+        return boxDist;
     }
 
-    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+    const uint32_t startCellIndex = startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x;
+    const uint64_t offset = getStartCellOffset(startCellIndex);
+    const OctreeNode* nodes = mOctreeData.data() + offset;
+    const OctreeNode* currentNode = &mOctreeData[startCellIndex];
+    uint32_t levels = 0;
 
     while(!currentNode->isLeaf())
     {
@@ -256,14 +388,20 @@ float TOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample, glm::vec3&
                                   (roundFloat(fracPart.y) << 1) + 
                                    roundFloat(fracPart.x);
 
-        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        currentNode = &nodes[currentNode->getChildrenIndex() + childIdx];
         fracPart = glm::fract(2.0f * fracPart);
+        levels++;
     }
 
-    auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&mOctreeData[currentNode->getChildrenIndex()]);
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(levels + 1, glm::findMSB(mStartGridSize) + levels);
 
-    outGradient = glm::normalize(InterpolationMethod::interpolateGradient(values, fracPart));
-    return InterpolationMethod::interpolateValue(values, fracPart);
+    auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&nodes[currentNode->getChildrenIndex()]);
+
+    const float distance = InterpolationMethod::interpolateValueAndGradient(values, fracPart, outGradient);
+    // The interpolation gradient is relative to the leaf size
+    if(NormalizeGradient) outGradient = glm::normalize(outGradient);
+    else outGradient *= static_cast<float>(1 << levels) / mStartGridCellSize;
+    return distance;
 }
 
 template<typename InterpolationMethod>
@@ -278,7 +416,9 @@ typename TOctreeSdf<InterpolationMethod>::OctreeNode TOctreeSdf<InterpolationMet
     glm::ivec3 startArrayPos = glm::floor(fracPart);
     fracPart = glm::fract(fracPart);
 
-    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+    const uint32_t startCellIndex = startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x;
+    const OctreeNode* nodes = mOctreeData.data() + getStartCellOffset(startCellIndex);
+    const OctreeNode* currentNode = &mOctreeData[startCellIndex];
 
     leafPos = glm::vec3(0.0f);
     leafSize = 1.0f;
@@ -289,7 +429,7 @@ typename TOctreeSdf<InterpolationMethod>::OctreeNode TOctreeSdf<InterpolationMet
             (roundFloat(fracPart.y) << 1) +
             roundFloat(fracPart.x);
 
-        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        currentNode = &nodes[currentNode->getChildrenIndex() + childIdx];
         leafSize *= 0.5f;
         leafPos += glm::vec3(leafSize * roundFloat(fracPart.x), leafSize * roundFloat(fracPart.y), leafSize * roundFloat(fracPart.z));
         fracPart = glm::fract(2.0f * fracPart);
@@ -332,8 +472,9 @@ void TOctreeSdf<InterpolationMethod>::computeMinBorderValue()
         glm::vec3(1.0f, 1.0f, 1.0f)
     };
 
-    std::function<float(uint32_t nIdx, glm::vec3 pos, float halfSize)> processNode;
-    processNode = [&](uint32_t nIdx, glm::vec3 pos, float halfSize) -> float
+    uint64_t offset = 0;
+    std::function<float(uint64_t nIdx, glm::vec3 pos, float halfSize)> processNode;
+    processNode = [&](uint64_t nIdx, glm::vec3 pos, float halfSize) -> float
     {
         if(!mOctreeData[nIdx].isLeaf())
         {
@@ -344,7 +485,7 @@ void TOctreeSdf<InterpolationMethod>::computeMinBorderValue()
                 if(cp.x < halfSize || cp.y < halfSize || cp.z < halfSize ||
                    cp.x > (1.0f-halfSize) || cp.y > (1.0f-halfSize) || cp.z > (1.0f-halfSize))
                 {
-                    minValue = glm::min(minValue, processNode(mOctreeData[nIdx].getChildrenIndex() + i, cp, 0.5f * halfSize));
+                    minValue = glm::min(minValue, processNode(offset + mOctreeData[nIdx].getChildrenIndex() + i, cp, 0.5f * halfSize));
                 }
             }
 
@@ -360,7 +501,7 @@ void TOctreeSdf<InterpolationMethod>::computeMinBorderValue()
                    sp.x > (1.0f-1e-4) || sp.y > (1.0f-1e-4) || sp.z > (1.0f-1e-4))
                 {
                     std::array<float, InterpolationMethod::NUM_COEFFICIENTS>* coeff = reinterpret_cast<std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(
-                                                                                            &mOctreeData[mOctreeData[nIdx].getChildrenIndex()]);
+                                                                                            &mOctreeData[offset + mOctreeData[nIdx].getChildrenIndex()]);
                     minValue = glm::min(minValue, InterpolationMethod::interpolateValue(*coeff, 0.5f * childrens[i] + glm::vec3(0.5f)));
 
                     float val = InterpolationMethod::interpolateValue(*coeff, 0.5f * childrens[i] + glm::vec3(0.5f));
@@ -386,6 +527,7 @@ void TOctreeSdf<InterpolationMethod>::computeMinBorderValue()
                 const glm::vec3 pos((static_cast<float>(i) + 0.5f) * gridCellSize,
                                     (static_cast<float>(j) + 0.5f) * gridCellSize,
                                     (static_cast<float>(k) + 0.5f) * gridCellSize);
+                offset = getStartCellOffset(idx);
                 minValue = glm::min(minValue, processNode(idx, pos, 0.5f * gridCellSize));
             }
         }
@@ -394,73 +536,369 @@ void TOctreeSdf<InterpolationMethod>::computeMinBorderValue()
     mMinBorderValue = minValue;
 }
 
+template<typename InterpolationMethod>
+SdfFunction::MemoryUsage TOctreeSdf<InterpolationMethod>::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.nodesPerDepth.assign(mMaxDepth + 1, 0);
+    usage.leavesPerDepth.assign(mMaxDepth + 1, 0);
+
+    std::vector<bool> visitedChildren(mOctreeData.size(), false);
+    uint64_t numNodes = 0;
+    uint64_t offset = 0;
+    std::function<void(const OctreeNode&, uint32_t)> vistNode;
+    vistNode = [&](const OctreeNode& node, uint32_t depth)
+    {
+        usage.nodesPerDepth[depth]++;
+        if(node.isLeaf())
+        {
+            usage.leavesPerDepth[depth]++;
+            return;
+        }
+
+        const uint64_t childrenIndex = offset + node.getChildrenIndex();
+        if(visitedChildren[childrenIndex]) return;
+        visitedChildren[childrenIndex] = true;
+        numNodes += 8;
+
+        for(uint32_t i = 0; i < 8; i++)
+        {
+            vistNode(mOctreeData[childrenIndex + i], depth + 1);
+        }
+    };
+
+    const uint32_t startDepth = glm::round(glm::log2(static_cast<float>(mStartGridSize)));
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        offset = getStartCellOffset(i);
+        vistNode(mOctreeData[i], startDepth);
+    }
+
+    // The rest of the array are the coefficients and the padding added by the relayout
+    const size_t nodesBytes = (startGridNumNodes + numNodes) * sizeof(OctreeNode);
+    usage.addArray("nodes", nodesBytes);
+    usage.addArray("coefficients", mOctreeData.capacity() * sizeof(OctreeNode) - nodesBytes);
+    usage.addArray("start cell offsets", mStartCellOffsets);
+    return usage;
+}
+
 template<typename InterpolationMethod>
 void TOctreeSdf<InterpolationMethod>::reduceTree()
 {
-    std::vector<TOctreeSdf::OctreeNode> octreeTmp = mOctreeData;
-    uint32_t currentIndex = mStartGridSize * mStartGridSize * mStartGridSize;
-    std::function<bool(OctreeNode&, uint32_t)> vistNode;
-    vistNode = [&](OctreeNode& node, uint32_t nodeIndex)
+    // The tree is reduced in place. Instead of copying the octree, it only uses a bit per array element
+    // marking the elements kept and the number of elements kept before each block of 64 elements.
+    const uint64_t numElements = mOctreeData.size();
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+
+    std::vector<uint64_t> keptMask((numElements + 63) / 64, 0);
+    auto keepElements = [&](uint64_t start, uint64_t count)
+    {
+        for(uint64_t e=start; e < start + count; e++) keptMask[e >> 6] |= 1ull << (e & 63);
+    };
+    auto isKept = [&](uint64_t element)
+    {
+        return element < numElements && ((keptMask[element >> 6] >> (element & 63)) & 1ull) != 0;
+    };
+
+    // First pass, marks the children of the nodes not reduced and the values of the leaves containing the isosurface
+    keepElements(0, startGridNumNodes);
+
+    uint64_t offset = 0;
+    std::function<bool(uint64_t)> markNode;
+    markNode = [&](uint64_t nodeIndex)
     {
-        // Iterate children
+        const OctreeNode& node = mOctreeData[nodeIndex];
+        const uint64_t arrayIndex = offset + node.getChildrenIndex();
         if(!node.isLeaf())
         {
             bool reduceNode = true;
-            uint32_t childrenIndices = currentIndex;
-            currentIndex += 8;
             for(uint32_t i = 0; i < 8; i++)
             {
-                reduceNode = vistNode(octreeTmp[node.getChildrenIndex() + i], childrenIndices + i) && reduceNode;
+                reduceNode = markNode(arrayIndex + i) && reduceNode;
             }
 
-            if(reduceNode)
-            {
-                mOctreeData[nodeIndex].setValues(true, std::numeric_limits<uint32_t>::max());
-                currentIndex = childrenIndices;
-            } 
-            else
+            if(!reduceNode) keepElements(arrayIndex, 8);
+            return reduceNode;
+        }
+
+        auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&mOctreeData[arrayIndex]);
+        if(InterpolationMethod::isIsosurfaceInside(values))
+        {
+            keepElements(arrayIndex, InterpolationMethod::NUM_COEFFICIENTS);
+            return false;
+        }
+
+        return true;
+    };
+
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        offset = getStartCellOffset(i);
+        markNode(i);
+    }
+
+    // The new position of a kept element is the number of elements kept before it
+    std::vector<uint64_t> blockRanks(keptMask.size());
+    uint64_t numKept = 0;
+    for(size_t b=0; b < keptMask.size(); b++)
+    {
+        blockRanks[b] = numKept;
+        uint64_t bits = keptMask[b];
+        for(; bits != 0; numKept++) bits &= bits - 1;
+    }
+
+    if(!OctreeNode::fitsIndex(0, numKept))
+    {
+        SPDLOG_ERROR("The reduced octree cannot be addressed with global indices, the octree is not reduced");
+        return;
+    }
+
+    auto getNewIndex = [&](uint64_t element)
+    {
+        uint64_t newIndex = blockRanks[element >> 6];
+        uint64_t bits = keptMask[element >> 6] & ((1ull << (element & 63)) - 1);
+        for(; bits != 0; newIndex++) bits &= bits - 1;
+        return newIndex;
+    };
+
+    // Second pass, updates the nodes with the new indices.
+    // The children are updated first, because the node index is needed to find them.
+    std::function<void(uint64_t)> updateNode;
+    updateNode = [&](uint64_t nodeIndex)
+    {
+        OctreeNode& node = mOctreeData[nodeIndex];
+        const uint64_t arrayIndex = offset + node.getChildrenIndex();
+        if(!isKept(arrayIndex))
+        {
+            node.setValues(true, std::numeric_limits<uint32_t>::max());
+        }
+        else if(!node.isLeaf())
+        {
+            for(uint32_t i = 0; i < 8; i++)
             {
-                mOctreeData[nodeIndex].setValues(false, childrenIndices);
+                updateNode(arrayIndex + i);
             }
 
-            return reduceNode;
+            node.setValues(false, static_cast<uint32_t>(getNewIndex(arrayIndex)));
         }
         else
         {
-            auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&octreeTmp[node.getChildrenIndex()]);
-            if(InterpolationMethod::isIsosurfaceInside(values))
+            node.setValues(true, static_cast<uint32_t>(getNewIndex(arrayIndex)));
+            node.markNode();
+        }
+    };
+
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        offset = getStartCellOffset(i);
+        updateNode(i);
+    }
+
+    // The reduced tree is written with global indices
+    mStartCellOffsets.clear();
+
+    // Third pass, moves the kept elements. Each element moves to a lower or equal position, 
+    // so the elements not visited yet are never overwritten.
+    uint64_t newSize = 0;
+    for(uint64_t e=0; e < numElements; e++)
+    {
+        if(isKept(e)) mOctreeData[newSize++] = mOctreeData[e];
+    }
+
+    mOctreeData.resize(newSize);
+    mOctreeData.shrink_to_fit();
+}
+
+template<typename InterpolationMethod>
+bool TOctreeSdf<InterpolationMethod>::relayoutOctreeData(uint32_t hotLevels)
+{
+    constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+    // Alignment in number of nodes, 16 nodes are one cache line of 64 bytes
+    constexpr uint32_t COEFFICIENTS_ALIGNMENT = (InterpolationMethod::NUM_COEFFICIENTS >= 16) ? 16 :
+                                                (InterpolationMethod::NUM_COEFFICIENTS > 4) ? 8 : 4;
+
+    if(hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The relayout is not supported by octrees with segmented indices");
+        return false;
+    }
+
+    const uint32_t oldSize = static_cast<uint32_t>(mOctreeData.size());
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+
+    LargeArray<OctreeNode> newOctreeData;
+    newOctreeData.reserve(oldSize + oldSize / 4);
+    newOctreeData.insert(newOctreeData.end(), mOctreeData.begin(), mOctreeData.begin() + startGridNumNodes);
+
+    // Maps the old arrays positions to the new ones, it allows sharing arrays between nodes
+    std::vector<uint32_t> newIndices(oldSize, INVALID_INDEX);
+
+    auto setIndex = [&](uint32_t nodeIndex, uint32_t newIndex)
+    {
+        const uint32_t flags = newOctreeData[nodeIndex].childrenIndex & (OctreeNode::IS_LEAF_MASK | OctreeNode::MARK_MASK);
+        newOctreeData[nodeIndex].childrenIndex = (newIndex & OctreeNode::CHILDREN_INDEX_MASK) | flags;
+    };
+
+    // Copies the children of the node and returns if they have been copied now
+    auto placeChildren = [&](uint32_t nodeIndex) -> bool
+    {
+        const uint32_t oldIndex = newOctreeData[nodeIndex].getChildrenIndex();
+        if(newIndices[oldIndex] != INVALID_INDEX)
+        {
+            setIndex(nodeIndex, newIndices[oldIndex]);
+            return false;
+        }
+
+        const uint32_t newIndex = static_cast<uint32_t>(newOctreeData.size());
+        newOctreeData.insert(newOctreeData.end(), mOctreeData.begin() + oldIndex, mOctreeData.begin() + oldIndex + 8);
+        newIndices[oldIndex] = newIndex;
+        setIndex(nodeIndex, newIndex);
+        return true;
+    };
+
+    auto placeCoefficients = [&](uint32_t nodeIndex)
+    {
+        const uint32_t oldIndex = newOctreeData[nodeIndex].getChildrenIndex();
+        if(oldIndex >= oldSize) return; // Leaf without values
+        if(newIndices[oldIndex] != INVALID_INDEX)
+        {
+            setIndex(nodeIndex, newIndices[oldIndex]);
+            return;
+        }
+
+        const uint32_t newSize = (static_cast<uint32_t>(newOctreeData.size()) + COEFFICIENTS_ALIGNMENT - 1) & ~(COEFFICIENTS_ALIGNMENT - 1);
+        OctreeNode padding; padding.value = 0.0f;
+        newOctreeData.resize(newSize, padding);
+
+        newOctreeData.insert(newOctreeData.end(), mOctreeData.begin() + oldIndex, mOctreeData.begin() + oldIndex + InterpolationMethod::NUM_COEFFICIENTS);
+        newIndices[oldIndex] = newSize;
+        setIndex(nodeIndex, newSize);
+    };
+
+    // Pack the first levels together
+    std::vector<uint32_t> frontier(startGridNumNodes);
+    for(uint32_t i=0; i < startGridNumNodes; i++) frontier[i] = i;
+
+    std::vector<uint32_t> pendingNodes;
+    for(uint32_t level=0; level < hotLevels; level++)
+    {
+        std::vector<uint32_t> nextFrontier;
+        for(uint32_t nodeIndex : frontier)
+        {
+            if(newOctreeData[nodeIndex].isLeaf())
             {
-                mOctreeData[nodeIndex].setValues(true, currentIndex);
-                mOctreeData[nodeIndex].markNode();
-                for(uint32_t i=0; i < InterpolationMethod::NUM_COEFFICIENTS; i++)
-                {
-                    mOctreeData[currentIndex++].value = values[i];
-                }
-                return false;
+                pendingNodes.push_back(nodeIndex);
             }
-            else
+            else if(placeChildren(nodeIndex))
             {
-                mOctreeData[nodeIndex].setValues(true, std::numeric_limits<uint32_t>::max());
-                return true;
+                const uint32_t childrenIndex = newOctreeData[nodeIndex].getChildrenIndex();
+                for(uint32_t c=0; c < 8; c++) nextFrontier.push_back(childrenIndex + c);
             }
         }
+        frontier = std::move(nextFrontier);
+    }
+    pendingNodes.insert(pendingNodes.end(), frontier.begin(), frontier.end());
+
+    // Store the remaining subtrees in depth-first order
+    std::function<void(uint32_t)> placeSubtree;
+    placeSubtree = [&](uint32_t nodeIndex)
+    {
+        if(newOctreeData[nodeIndex].isLeaf())
+        {
+            placeCoefficients(nodeIndex);
+        }
+        else if(placeChildren(nodeIndex))
+        {
+            const uint32_t childrenIndex = newOctreeData[nodeIndex].getChildrenIndex();
+            for(uint32_t c=0; c < 8; c++) placeSubtree(childrenIndex + c);
+        }
+    };
+
+    for(uint32_t nodeIndex : pendingNodes)
+    {
+        placeSubtree(nodeIndex);
+    }
 
+    // The coefficients padding can make the new array larger than the original one.
+    // In that case the indices stored by setIndex have been truncated, so the result is discarded.
+    if(!OctreeNode::fitsIndex(0, newOctreeData.size()))
+    {
+        SPDLOG_ERROR("The relayout octree array exceeds the maximum node index ({}), the original layout is kept", 
+                     OctreeNode::CHILDREN_INDEX_MASK);
         return false;
+    }
+
+    newOctreeData.shrink_to_fit();
+    mOctreeData = std::move(newOctreeData);
+    return true;
+}
+
+template<typename InterpolationMethod>
+uint32_t TOctreeSdf<InterpolationMethod>::compressOctreeData()
+{
+    constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    if(hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The compression is not supported by octrees with segmented indices");
+        return 0;
+    }
+
+    const uint32_t oldSize = static_cast<uint32_t>(mOctreeData.size());
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+
+    LargeArray<OctreeNode> newOctreeData(mOctreeData.begin(), mOctreeData.begin() + startGridNumNodes);
+
+    // Arrays already processed, the octree can already share some of them
+    std::vector<uint32_t> newIndices(oldSize, INVALID_INDEX);
+
+    // Blocks of children or coefficients already stored, indexed by their hash and compared against the new array
+    SharedBlocks<LargeArray<OctreeNode>> storedBlocks(newOctreeData);
+
+    auto storeBlock = [&](const OctreeNode* block, uint32_t blockSize) -> uint32_t
+    {
+        return static_cast<uint32_t>(storedBlocks.insert(block, blockSize));
     };
 
-    for(uint32_t k=0; k < mStartGridSize; k++)
+    // Returns the node with its array index pointing to the shared copy,
+    // so two nodes are equal only if their subtrees are equal
+    std::function<OctreeNode(OctreeNode)> compressNode;
+    compressNode = [&](OctreeNode node) -> OctreeNode
     {
-        for(uint32_t j=0; j < mStartGridSize; j++)
+        const uint32_t oldIndex = node.getChildrenIndex();
+        if(oldIndex >= oldSize) return node; // Leaf without values
+
+        if(newIndices[oldIndex] == INVALID_INDEX)
         {
-            for(uint32_t i=0; i < mStartGridSize; i++)
+            if(node.isLeaf())
+            {
+                newIndices[oldIndex] = storeBlock(&mOctreeData[oldIndex], InterpolationMethod::NUM_COEFFICIENTS);
+            }
+            else
             {
-                const uint32_t nodeStartIndex = k * mStartGridSize * mStartGridSize + j * mStartGridSize + i;
-                vistNode(octreeTmp[nodeStartIndex], nodeStartIndex);
+                // The children are compressed bottom-up before hashing their block
+                std::array<OctreeNode, 8> children;
+                for(uint32_t c=0; c < 8; c++) children[c] = compressNode(mOctreeData[oldIndex + c]);
+                newIndices[oldIndex] = storeBlock(children.data(), 8);
             }
         }
+
+        const uint32_t flags = node.childrenIndex & (OctreeNode::IS_LEAF_MASK | OctreeNode::MARK_MASK);
+        node.childrenIndex = (newIndices[oldIndex] & OctreeNode::CHILDREN_INDEX_MASK) | flags;
+        return node;
+    };
+
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        newOctreeData[i] = compressNode(mOctreeData[i]);
     }
 
-    mOctreeData.resize(currentIndex);
+    SPDLOG_INFO("Octree compression: {} -> {} nodes, {} unique blocks", oldSize, newOctreeData.size(), storedBlocks.size());
+
+    newOctreeData.shrink_to_fit();
+    mOctreeData = std::move(newOctreeData);
+    return oldSize - static_cast<uint32_t>(mOctreeData.size());
 }
 }
 
@@ -468,4 +906,8 @@ void TOctreeSdf<InterpolationMethod>::reduceTree()
 #include "OctreeSdfBreadthFirst.h"
 #include "OctreeSdfBreadthFirstNoDelay.h"
 
+CEREAL_CLASS_VERSION(sdflib::TOctreeSdf<sdflib::TriLinearInterpolation>, 1);
+CEREAL_CLASS_VERSION(sdflib::TOctreeSdf<sdflib::TriCubicInterpolation>, 1);
+CEREAL_CLASS_VERSION(sdflib::TOctreeSdf<sdflib::TriQuadraticInterpolation>, 1);
+
 #endif
\ No newline at end of file
@@ -356,7 +356,7 @@ void TOctreeSdf<InterpolationMethod>::initOctreeWithContinuityNoDelay(const Mesh
                                         ? node.parentChildrenIndex + (node.childIndices & 0b0111)
                                         : std::numeric_limits<uint32_t>::max();
 
-            const std::vector<OctreeNode>& octreeData = mOctreeData;
+            const LargeArray<OctreeNode>& octreeData = mOctreeData;
 
             glm::ivec3 nodeStartGridPos;
             if(currentDepth == startDepth)
@@ -138,7 +138,7 @@ void TOctreeSdf<InterpolationMethod>::initOctree(const Mesh& mesh, uint32_t star
         }
     }
 
-    auto processNode = [&mesh, &trianglesData] (const NodeInfo& node, ThreadContext& tContext, std::vector<OctreeNode>& outputOctree)
+    auto processNode = [&mesh, &trianglesData] (const NodeInfo& node, ThreadContext& tContext, LargeArray<OctreeNode>& outputOctree)
     {
         const std::array<glm::vec3, 19> nodeSamplePoints =
         {
@@ -433,7 +433,7 @@ void TOctreeSdf<InterpolationMethod>::initOctree(const Mesh& mesh, uint32_t star
         struct OctreeDataWithPadding
         {
             OctreeDataWithPadding() {}
-            std::vector<OctreeNode> octreeData;
+            LargeArray<OctreeNode> octreeData;
             uint32_t padding[16];
         };
         std::vector<OctreeDataWithPadding> subOctrees(voxlesPerAxis * voxlesPerAxis * voxlesPerAxis);
@@ -452,13 +452,13 @@ void TOctreeSdf<InterpolationMethod>::initOctree(const Mesh& mesh, uint32_t star
             {
                 glm::ivec3 startArrayPos = glm::floor((node.center - mBox.min) / mStartGridCellSize);
                 node.nodeIndex = 0;
-                std::vector<OctreeNode>* subOctreePtr = &subOctrees[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x].octreeData;
+                LargeArray<OctreeNode>* subOctreePtr = &subOctrees[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x].octreeData;
                 subOctreePtr->resize(1);
                 const uint32_t rDepth = startDepth - mainThread.startOctreeDepth;
                 std::vector<uint32_t> startTriangles = mainThread.triangles[rDepth];
                 #pragma omp task shared(threadsContext) firstprivate(node, subOctreePtr, rDepth, startTriangles)
                 {
-                    std::vector<OctreeNode>& subOctree = *subOctreePtr;
+                    LargeArray<OctreeNode>& subOctree = *subOctreePtr;
                     const uint32_t tId = omp_get_thread_num();
                     ThreadContext& threadContext = threadsContext[tId];
                     threadContext.triangles[rDepth] = std::move(startTriangles);
@@ -481,9 +481,31 @@ void TOctreeSdf<InterpolationMethod>::initOctree(const Mesh& mesh, uint32_t star
 
         // Merge all the subtrees
         mOctreeData.resize(voxlesPerAxis * voxlesPerAxis * voxlesPerAxis);
+
+        // If the final array cannot be addressed by the nodes, each subtree keeps its own indices
+        uint64_t totalSize = mOctreeData.size();
+        for(uint32_t i=0; i < subOctrees.size(); i++) totalSize += subOctrees[i].octreeData.size() - 1;
+        const bool useSegmentedIndices = totalSize > OctreeNode::CHILDREN_INDEX_MASK;
+        if(useSegmentedIndices)
+        {
+            SPDLOG_INFO("The octree has {} nodes, using segmented indices", totalSize);
+            mOctreeData.reserve(totalSize);
+            mStartCellOffsets.resize(subOctrees.size());
+        }
+
         for(uint32_t i=0; i < subOctrees.size(); i++)
         {
-            std::vector<OctreeNode>& octreeData = subOctrees[i].octreeData;
+            LargeArray<OctreeNode>& octreeData = subOctrees[i].octreeData;
+
+            if(useSegmentedIndices)
+            {
+                // The subtree local index 0 is the start grid node, so its local index 1 is the next array position
+                mStartCellOffsets[i] = mOctreeData.size() - 1;
+                mOctreeData[i] = octreeData[0];
+                mOctreeData.insert(mOctreeData.end(), octreeData.begin()+1, octreeData.end());
+                LargeArray<OctreeNode>().swap(octreeData);
+                continue;
+            }
 
             const uint32_t startIndex = mOctreeData.size();
             
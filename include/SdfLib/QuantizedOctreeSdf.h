@@ -0,0 +1,476 @@
+#ifndef QUANTIZED_OCTREE_SDF_H
+#define QUANTIZED_OCTREE_SDF_H
+
+#include <array>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+
+#include <glm/gtc/packing.hpp>
+#include <spdlog/spdlog.h>
+
+#include "SdfLib/InterpolationMethods.h"
+#include "OctreeSdf.h"
+
+#include <cereal/types/vector.hpp>
+
+namespace sdflib
+{
+/**
+ * @brief Indicates the coefficients that represent a constant field with value 1.
+ *        The leaf offset is only subtracted from these coefficients, so it can be added
+ *        back after the interpolation instead of for each coefficient.
+ **/
+template<typename InterpolationMethod>
+struct LeafOffsetCoefficients
+{
+    // The interpolation weights of the nodal bases add up to one
+    static constexpr bool isOffsetCoefficient(uint32_t index) { return true; }
+};
+
+template<>
+struct LeafOffsetCoefficients<TriCubicInterpolation>
+{
+    // Only the constant term of the polynomial
+    static constexpr bool isOffsetCoefficient(uint32_t index) { return index == 0; }
+};
+
+/**
+ * @brief Octree with the same structure than TOctreeSdf but storing the leaves coefficients
+ *        in a compressed format. Each leaf stores an offset and a scale, and its coefficients
+ *        are encoded relative to them as half floats or as 16 or 8 bits integers.
+ *        The interpolation is linear on the coefficients, so the offset and the scale are applied
+ *        to the interpolated value instead of decoding each coefficient.
+ **/
+template <typename InterpolationMethod=TriLinearInterpolation>
+class TQuantizedOctreeSdf : public IOctreeSdf
+{
+public:
+    enum CoefficientsEncoding
+    {
+        HALF_FLOAT,
+        QUANTIZED_16BIT,
+        QUANTIZED_8BIT
+    };
+
+    TQuantizedOctreeSdf() {}
+
+    /**
+     * @brief Compresses the leaves of an octree.
+     *        It returns nullptr if the quantization error is greater than the maximum error.
+     * @param octree The octree to compress.
+     * @param encoding The encoding used for the coefficients.
+     * @param maxError The maximum error that the quantization can add to the octree values.
+     *                 It should be the error used by the octree termination rule.
+     **/
+    static std::unique_ptr<TQuantizedOctreeSdf> fromOctree(const TOctreeSdf<InterpolationMethod>& octree,
+                                                           CoefficientsEncoding encoding, float maxError);
+
+    static std::optional<CoefficientsEncoding> stringToCoefficientsEncoding(const std::string& text)
+    {
+        if(text == "fp16" || text == "HALF_FLOAT") return std::optional<CoefficientsEncoding>(CoefficientsEncoding::HALF_FLOAT);
+        else if(text == "16bit" || text == "QUANTIZED_16BIT") return std::optional<CoefficientsEncoding>(CoefficientsEncoding::QUANTIZED_16BIT);
+        else if(text == "8bit" || text == "QUANTIZED_8BIT") return std::optional<CoefficientsEncoding>(CoefficientsEncoding::QUANTIZED_8BIT);
+
+        return std::optional<CoefficientsEncoding>();
+    }
+
+    float getDistance(glm::vec3 sample) const override;
+    float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+    SdfFunction::SdfFormat getFormat() const override { return SdfFunction::SdfFormat::NONE; }
+
+    /**
+     * @return The encoding of the leaves coefficients
+     **/
+    CoefficientsEncoding getCoefficientsEncoding() const { return mEncoding; }
+
+    /**
+     * @return The maximum difference with the original octree measured during the compression
+     **/
+    float getQuantizationError() const { return mQuantizationError; }
+
+    /**
+     * @return The array containing the encoded leaves
+     **/
+    const std::vector<uint32_t>& getLeavesData() const { return mLeavesData; }
+
+    // Load and save function for storing the structure on disk
+    template<class Archive>
+    void save(Archive & archive) const
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mFarFieldProxy);
+        archive(mEncoding, mQuantizationError, mOctreeData, mLeavesData);
+    }
+
+    template<class Archive>
+    void load(Archive & archive)
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mSdfOnlyAySurface, mValueRange, mMinBorderValue, mFarFieldProxy);
+        archive(mEncoding, mQuantizationError, mOctreeData, mLeavesData);
+
+        mStartGridCellSize = mBox.getSize().x / static_cast<float>(mStartGridSize);
+        mStartGridXY = mStartGridSize * mStartGridSize;
+        mLeafStride = getLeafStride(mEncoding);
+
+        float total = mOctreeData.size() * sizeof(OctreeNode) + mLeavesData.size() * sizeof(uint32_t);
+        SPDLOG_INFO("Quantized Octree Sdf Total: {}MB", total/1048576.0f);
+        SPDLOG_INFO("Quantized Octree Sdf Leaves: {}MB", mLeavesData.size() * sizeof(uint32_t) / 1048576.0f);
+    }
+
+private:
+    static constexpr uint32_t NUM_COEFFICIENTS = InterpolationMethod::NUM_COEFFICIENTS;
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    // Offset and scale stored at the start of each leaf
+    struct LeafHeader
+    {
+        float offset;
+        float scale;
+    };
+
+    CoefficientsEncoding mEncoding = CoefficientsEncoding::HALF_FLOAT;
+    // Size in 32 bits words of each leaf
+    uint32_t mLeafStride = 0;
+    float mQuantizationError = 0.0f;
+    // Array storing the encoded leaves, the octree leaves store the index of their leaf
+    std::vector<uint32_t> mLeavesData;
+
+    static uint32_t getLeafStride(CoefficientsEncoding encoding)
+    {
+        const uint32_t bytesPerCoefficient = (encoding == CoefficientsEncoding::QUANTIZED_8BIT) ? 1 : 2;
+        return (sizeof(LeafHeader) + NUM_COEFFICIENTS * bytesPerCoefficient + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    }
+
+    void encodeLeaf(const std::array<float, NUM_COEFFICIENTS>& coefficients, uint32_t* outLeaf) const;
+    void decodeLeaf(uint32_t leafIndex, LeafHeader& outHeader, std::array<float, NUM_COEFFICIENTS>& outCoefficients) const;
+};
+
+template<>
+inline SdfFunction::SdfFormat TQuantizedOctreeSdf<TriLinearInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRILINEAR_QUANTIZED_OCTREE;
+}
+
+template<>
+inline SdfFunction::SdfFormat TQuantizedOctreeSdf<TriCubicInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRICUBIC_QUANTIZED_OCTREE;
+}
+
+typedef TQuantizedOctreeSdf<> QuantizedOctreeSdf;
+
+// --- Public method definition --- //
+template<typename InterpolationMethod>
+std::unique_ptr<TQuantizedOctreeSdf<InterpolationMethod>> TQuantizedOctreeSdf<InterpolationMethod>::fromOctree(
+                                                                const TOctreeSdf<InterpolationMethod>& octree,
+                                                                CoefficientsEncoding encoding, float maxError)
+{
+    if(octree.hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The quantization is not supported by octrees with segmented indices");
+        return std::unique_ptr<TQuantizedOctreeSdf>();
+    }
+
+    std::unique_ptr<TQuantizedOctreeSdf> obj(new TQuantizedOctreeSdf());
+    obj->mBox = octree.getGridBoundingBox();
+    obj->mValueRange = octree.getOctreeValueRange();
+    obj->mMinBorderValue = octree.getOctreeMinBorderValue();
+    obj->mFarFieldProxy = octree.getFarFieldProxy();
+    obj->mStartGridSize = octree.getStartGridSize().x;
+    obj->mStartGridXY = obj->mStartGridSize * obj->mStartGridSize;
+    obj->mStartGridCellSize = obj->mBox.getSize().x / static_cast<float>(obj->mStartGridSize);
+    obj->mMaxDepth = octree.getOctreeMaxDepth();
+    obj->mSdfOnlyAySurface = octree.hasSdfOnlyAtSurface();
+    obj->mEncoding = encoding;
+    obj->mLeafStride = getLeafStride(encoding);
+
+    const LargeArray<OctreeNode>& octreeData = octree.getOctreeData();
+    const uint32_t startGridNumNodes = obj->mStartGridSize * obj->mStartGridXY;
+    obj->mOctreeData.assign(octreeData.begin(), octreeData.begin() + startGridNumNodes);
+
+    // Maps the old arrays positions to the new ones, it allows sharing arrays between nodes
+    std::vector<uint32_t> newIndices(octreeData.size(), INVALID_INDEX);
+    uint32_t numLeaves = 0;
+    float maxQuantizationError = 0.0f;
+
+    std::function<void(uint32_t, uint32_t)> vistNode;
+    vistNode = [&](uint32_t oldIndex, uint32_t newIndex)
+    {
+        OctreeNode node = octreeData[oldIndex];
+        const bool isMarked = node.isMarked();
+        const uint32_t oldChildrenIndex = node.getChildrenIndex();
+
+        if(!node.isLeaf())
+        {
+            if(newIndices[oldChildrenIndex] == INVALID_INDEX)
+            {
+                const uint32_t childrenIndex = static_cast<uint32_t>(obj->mOctreeData.size());
+                newIndices[oldChildrenIndex] = childrenIndex;
+                obj->mOctreeData.resize(obj->mOctreeData.size() + 8);
+                for(uint32_t i=0; i < 8; i++)
+                {
+                    vistNode(oldChildrenIndex + i, childrenIndex + i);
+                }
+            }
+            obj->mOctreeData[newIndex].setValues(false, newIndices[oldChildrenIndex]);
+        }
+        else if(oldChildrenIndex >= octreeData.size())
+        {
+            // Leaf without coefficients
+            obj->mOctreeData[newIndex] = node;
+        }
+        else
+        {
+            if(newIndices[oldChildrenIndex] == INVALID_INDEX)
+            {
+                newIndices[oldChildrenIndex] = numLeaves++;
+                obj->mLeavesData.resize(obj->mLeavesData.size() + obj->mLeafStride, 0);
+
+                auto& values = *reinterpret_cast<const std::array<float, NUM_COEFFICIENTS>*>(&octreeData[oldChildrenIndex]);
+                obj->encodeLeaf(values, &obj->mLeavesData[obj->mLeavesData.size() - obj->mLeafStride]);
+
+                // Measure the error in a regular grid of points inside the leaf
+                LeafHeader header;
+                std::array<float, NUM_COEFFICIENTS> decoded;
+                obj->decodeLeaf(newIndices[oldChildrenIndex], header, decoded);
+                for(uint32_t k=0; k < 4; k++)
+                {
+                    for(uint32_t j=0; j < 4; j++)
+                    {
+                        for(uint32_t i=0; i < 4; i++)
+                        {
+                            const glm::vec3 fracPart = glm::vec3(i, j, k) / 3.0f;
+                            const float value = header.offset + header.scale * InterpolationMethod::interpolateValue(decoded, fracPart);
+                            maxQuantizationError = glm::max(maxQuantizationError,
+                                                            glm::abs(value - InterpolationMethod::interpolateValue(values, fracPart)));
+                        }
+                    }
+                }
+            }
+            obj->mOctreeData[newIndex].setValues(true, newIndices[oldChildrenIndex]);
+        }
+
+        if(isMarked) obj->mOctreeData[newIndex].markNode();
+    };
+
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        vistNode(i, i);
+    }
+
+    obj->mQuantizationError = maxQuantizationError;
+    const float oldSize = octreeData.size() * sizeof(OctreeNode);
+    const float newSize = obj->mOctreeData.size() * sizeof(OctreeNode) + obj->mLeavesData.size() * sizeof(uint32_t);
+    SPDLOG_INFO("Octree compressed from {}MB to {}MB, quantization error {}",
+                oldSize / 1048576.0f, newSize / 1048576.0f, maxQuantizationError);
+
+    if(maxQuantizationError > maxError)
+    {
+        SPDLOG_ERROR("The quantization error {} is greater than the maximum error {}, use a wider encoding",
+                     maxQuantizationError, maxError);
+        return std::unique_ptr<TQuantizedOctreeSdf>();
+    }
+
+    return obj;
+}
+
+template<typename InterpolationMethod>
+float TQuantizedOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample) const
+{
+    auto roundFloat = [](float a) -> uint32_t
+    {
+        return (a >= 0.5f) ? 1 : 0;
+    };
+
+    glm::vec3 fracPart = (sample - mBox.min) / mStartGridCellSize;
+    glm::ivec3 startArrayPos = glm::floor(fracPart);
+    fracPart = glm::fract(fracPart);
+
+    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
+       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
+       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        return glm::max(mBox.getDistance(sample) + mMinBorderValue, mFarFieldProxy.getDistance(sample));
+    }
+
+    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+    uint32_t levels = 0;
+
+    while(!currentNode->isLeaf())
+    {
+        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) +
+                                  (roundFloat(fracPart.y) << 1) +
+                                   roundFloat(fracPart.x);
+
+        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        fracPart = glm::fract(2.0f * fracPart);
+        levels++;
+    }
+
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(levels + 1, glm::findMSB(mStartGridSize) + levels);
+
+    if(currentNode->getChildrenIndex() == OctreeNode::CHILDREN_INDEX_MASK) return 10.0;
+
+    LeafHeader header;
+    std::array<float, NUM_COEFFICIENTS> values;
+    decodeLeaf(currentNode->getChildrenIndex(), header, values);
+
+    return header.offset + header.scale * InterpolationMethod::interpolateValue(values, fracPart);
+}
+
+template<typename InterpolationMethod>
+float TQuantizedOctreeSdf<InterpolationMethod>::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    auto roundFloat = [](float a) -> uint32_t
+    {
+        return (a >= 0.5f) ? 1 : 0;
+    };
+
+    glm::vec3 fracPart = (sample - mBox.min) / mStartGridCellSize;
+    glm::ivec3 startArrayPos = glm::floor(fracPart);
+    fracPart = glm::fract(fracPart);
+
+    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
+       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
+       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        const float boxDist = mBox.getDistance(sample, outGradient) + mMinBorderValue;
+        glm::vec3 proxyGradient;
+        const float proxyDist = mFarFieldProxy.getDistance(sample, proxyGradient);
+        if(proxyDist > boxDist)
+        {
+            outGradient = proxyGradient;
+            return proxyDist;
+        }
+        return boxDist;
+    }
+
+    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+    uint32_t levels = 0;
+
+    while(!currentNode->isLeaf())
+    {
+        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) +
+                                  (roundFloat(fracPart.y) << 1) +
+                                   roundFloat(fracPart.x);
+
+        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        fracPart = glm::fract(2.0f * fracPart);
+        levels++;
+    }
+
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(levels + 1, glm::findMSB(mStartGridSize) + levels);
+
+    if(currentNode->getChildrenIndex() == OctreeNode::CHILDREN_INDEX_MASK)
+    {
+        outGradient = glm::vec3(0.0f);
+        return 10.0;
+    }
+
+    LeafHeader header;
+    std::array<float, NUM_COEFFICIENTS> values;
+    decodeLeaf(currentNode->getChildrenIndex(), header, values);
+
+    // The offset is constant inside the leaf and the scale is positive, so it does not change the gradient direction
+    const float distance = InterpolationMethod::interpolateValueAndGradient(values, fracPart, outGradient);
+    outGradient = glm::normalize(outGradient);
+    return header.offset + header.scale * distance;
+}
+
+template<typename InterpolationMethod>
+void TQuantizedOctreeSdf<InterpolationMethod>::encodeLeaf(const std::array<float, NUM_COEFFICIENTS>& coefficients, uint32_t* outLeaf) const
+{
+    // The offset is centered in the range of the coefficients containing it
+    float minValue = INFINITY;
+    float maxValue = -INFINITY;
+    for(uint32_t i=0; i < NUM_COEFFICIENTS; i++)
+    {
+        if(LeafOffsetCoefficients<InterpolationMethod>::isOffsetCoefficient(i))
+        {
+            minValue = glm::min(minValue, coefficients[i]);
+            maxValue = glm::max(maxValue, coefficients[i]);
+        }
+    }
+
+    LeafHeader header;
+    header.offset = 0.5f * (minValue + maxValue);
+
+    std::array<float, NUM_COEFFICIENTS> residuals;
+    float maxResidual = 0.0f;
+    for(uint32_t i=0; i < NUM_COEFFICIENTS; i++)
+    {
+        residuals[i] = coefficients[i] - (LeafOffsetCoefficients<InterpolationMethod>::isOffsetCoefficient(i) ? header.offset : 0.0f);
+        maxResidual = glm::max(maxResidual, glm::abs(residuals[i]));
+    }
+
+    uint8_t* outCoefficients = reinterpret_cast<uint8_t*>(outLeaf) + sizeof(LeafHeader);
+    switch(mEncoding)
+    {
+        case CoefficientsEncoding::HALF_FLOAT:
+        {
+            header.scale = 1.0f;
+            std::array<uint16_t, NUM_COEFFICIENTS> halfs;
+            for(uint32_t i=0; i < NUM_COEFFICIENTS; i++) halfs[i] = glm::packHalf1x16(residuals[i]);
+            std::memcpy(outCoefficients, halfs.data(), sizeof(halfs));
+            break;
+        }
+        case CoefficientsEncoding::QUANTIZED_16BIT:
+        {
+            header.scale = (maxResidual > 0.0f) ? maxResidual / 32767.0f : 1.0f;
+            std::array<int16_t, NUM_COEFFICIENTS> quantized;
+            for(uint32_t i=0; i < NUM_COEFFICIENTS; i++) quantized[i] = static_cast<int16_t>(glm::round(residuals[i] / header.scale));
+            std::memcpy(outCoefficients, quantized.data(), sizeof(quantized));
+            break;
+        }
+        case CoefficientsEncoding::QUANTIZED_8BIT:
+        {
+            header.scale = (maxResidual > 0.0f) ? maxResidual / 127.0f : 1.0f;
+            std::array<int8_t, NUM_COEFFICIENTS> quantized;
+            for(uint32_t i=0; i < NUM_COEFFICIENTS; i++) quantized[i] = static_cast<int8_t>(glm::round(residuals[i] / header.scale));
+            std::memcpy(outCoefficients, quantized.data(), sizeof(quantized));
+            break;
+        }
+    }
+
+    std::memcpy(outLeaf, &header, sizeof(LeafHeader));
+}
+
+template<typename InterpolationMethod>
+inline void TQuantizedOctreeSdf<InterpolationMethod>::decodeLeaf(uint32_t leafIndex, LeafHeader& outHeader, std::array<float, NUM_COEFFICIENTS>& outCoefficients) const
+{
+    const uint32_t* leaf = &mLeavesData[leafIndex * mLeafStride];
+    std::memcpy(&outHeader, leaf, sizeof(LeafHeader));
+    const uint8_t* coefficients = reinterpret_cast<const uint8_t*>(leaf) + sizeof(LeafHeader);
+
+    switch(mEncoding)
+    {
+        case CoefficientsEncoding::HALF_FLOAT:
+        {
+            std::array<uint16_t, NUM_COEFFICIENTS> halfs;
+            std::memcpy(halfs.data(), coefficients, sizeof(halfs));
+            for(uint32_t i=0; i < NUM_COEFFICIENTS; i++) outCoefficients[i] = glm::unpackHalf1x16(halfs[i]);
+            break;
+        }
+        case CoefficientsEncoding::QUANTIZED_16BIT:
+        {
+            std::array<int16_t, NUM_COEFFICIENTS> quantized;
+            std::memcpy(quantized.data(), coefficients, sizeof(quantized));
+            for(uint32_t i=0; i < NUM_COEFFICIENTS; i++) outCoefficients[i] = static_cast<float>(quantized[i]);
+            break;
+        }
+        case CoefficientsEncoding::QUANTIZED_8BIT:
+        {
+            std::array<int8_t, NUM_COEFFICIENTS> quantized;
+            std::memcpy(quantized.data(), coefficients, sizeof(quantized));
+            for(uint32_t i=0; i < NUM_COEFFICIENTS; i++) outCoefficients[i] = static_cast<float>(quantized[i]);
+            break;
+        }
+    }
+}
+}
+
+#endif
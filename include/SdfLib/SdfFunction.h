@@ -4,6 +4,9 @@
 #include <glm/glm.hpp>
 #include <cereal/archives/portable_binary.hpp>
 #include <fstream>
+#include <future>
+#include <string>
+#include <vector>
 
 #include "utils/Mesh.h"
 
@@ -19,7 +22,55 @@ public:
         TRILINEAR_OCTREE,
         TRICUBIC_OCTREE,
         EXACT_OCTREE,
-        NONE
+        NONE,
+        TRILINEAR_QUANTIZED_OCTREE,
+        TRICUBIC_QUANTIZED_OCTREE,
+        TRILINEAR_MORTON_OCTREE,
+        TRICUBIC_MORTON_OCTREE,
+        BRICK_MAP,
+        SPARSE_GRID,
+        TRIQUADRATIC_OCTREE,
+        MIXED_OCTREE,
+        COMPRESSED_OCTREE, // Followed by the format of the compressed octree
+        TRILINEAR_SEQUENCE,
+        TRICUBIC_SEQUENCE,
+        TRIQUADRATIC_SEQUENCE
+    };
+
+    /**
+     * @brief Memory used by a structure, split by its arrays
+     **/
+    struct MemoryUsage
+    {
+        struct Array
+        {
+            std::string name;
+            size_t numBytes;
+        };
+
+        std::vector<Array> arrays;
+        // Number of nodes and leaves at each depth, they are empty if the structure is not hierarchical
+        std::vector<uint64_t> nodesPerDepth;
+        std::vector<uint64_t> leavesPerDepth;
+
+        void addArray(const std::string& name, size_t numBytes) { arrays.push_back({name, numBytes}); }
+
+        // The allocated capacity is used, because it is the memory that remains resident
+        template<typename T, typename A>
+        void addArray(const std::string& name, const std::vector<T, A>& array) 
+        { 
+            addArray(name, array.capacity() * sizeof(T)); 
+        }
+
+        /**
+         * @return The memory used by all the arrays in bytes
+         **/
+        size_t getTotalBytes() const
+        {
+            size_t total = 0;
+            for(const Array& array : arrays) total += array.numBytes;
+            return total;
+        }
     };
 
     virtual ~SdfFunction() = default;
@@ -33,6 +84,14 @@ public:
      * @param outGradient Returns the gradient of the field
      **/
     virtual float getDistance(glm::vec3 sample, glm::vec3& outGradient) const = 0;
+    /**
+     * @brief Computes the signed distances of a batch of samples.
+     *        The structures can override it to share work between nearby samples.
+     * @param samples Array of points to evaluate
+     * @param outDistances Array where the distances are stored, it must have numSamples elements
+     * @param numSamples Number of points
+     **/
+    virtual void getDistances(const glm::vec3* samples, float* outDistances, size_t numSamples) const;
     /**
      * @return The bounding box that can be queried
      **/
@@ -41,13 +100,49 @@ public:
      * @return The format of the structure
      **/
     virtual SdfFormat getFormat() const { return SdfFormat::NONE; }
+    /**
+     * @return The memory used by the structure arrays and, for the hierarchical structures,
+     *         the number of nodes and leaves per depth
+     **/
+    virtual MemoryUsage getMemoryUsage() const { return MemoryUsage(); }
+    /**
+     * @return False if the construction of the structure failed and it cannot be queried or stored
+     **/
+    virtual bool isValid() const { return true; }
+    /**
+     * @return The size of the smallest cell or leaf of the structure, or 0 if it does not discretize the space
+     **/
+    virtual float getMinCellSize() const { return 0.0f; }
+
+    /**
+     * @brief Computes the distances of a batch of samples in the library thread pool.
+     *        The batch is split in chunks that are evaluated by all the pool workers.
+     *        The structure and the arrays must be alive until the returned future is ready.
+     *        Do not wait the future from inside a pool task.
+     * @param samples Array of points to evaluate
+     * @param outDistances Array where the distances are stored, it must have numSamples elements
+     * @param numSamples Number of points
+     * @param outGradients Optional array where the gradients are stored, it must have numSamples elements
+     * @return A future that gets ready when all the distances have been computed
+     **/
+    std::future<void> getDistancesAsync(const glm::vec3* samples, float* outDistances, size_t numSamples,
+                                        glm::vec3* outGradients = nullptr) const;
+
+    /**
+     * @brief Computes the distances of a batch of samples in the library thread pool.
+     *        The output array is resized to the number of samples before returning.
+     **/
+    std::future<void> getDistancesAsync(const std::vector<glm::vec3>& samples, std::vector<float>& outDistances) const;
     
     /**
      * @brief Stores the structure to disk.
      * @param outputPath The file path where the structure should be stored
+     * @param compress If the structure is stored entropy coded in independent chunks, 
+     *                 which are decoded in parallel when it is loaded. 
+     *                 It is only supported by the trilinear, triquadratic and tricubic octrees.
      * @return If the structure has been stored successfully
      **/
-    bool saveToFile(const std::string& outputPath);
+    bool saveToFile(const std::string& outputPath, bool compress = false);
 
     /**
      * @brief Load a structure from disk
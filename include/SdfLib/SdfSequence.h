@@ -0,0 +1,526 @@
+#ifndef SDF_SEQUENCE_H
+#define SDF_SEQUENCE_H
+
+#include <array>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <spdlog/spdlog.h>
+
+#include "SdfLib/InterpolationMethods.h"
+#include "OctreeSdf.h"
+
+#include <cereal/types/vector.hpp>
+
+#ifdef OPENMP_AVAILABLE
+#include <omp.h>
+#endif
+
+namespace sdflib
+{
+/**
+ * @brief Sequence of octrees representing an animated distance field.
+ *        All the frames are stored in one octree array and each frame has its own start grid.
+ *        When a frame is added, the start grid cells whose subtree is identical to the previous frame
+ *        reference the subtree already stored, so only the changed subtrees are copied.
+ *        Switching the current frame only selects the start grid used by the queries.
+ **/
+template<typename InterpolationMethod=TriLinearInterpolation>
+class TSdfSequence : public SdfFunction
+{
+public:
+    typedef IOctreeSdf::OctreeNode OctreeNode;
+
+    TSdfSequence() {}
+
+    /**
+     * @brief Appends a frame to the sequence.
+     *        All the frames must cover the same area with the same start grid.
+     * @param octree The octree of the frame, it cannot have segmented indices.
+     * @param numThreads Number of threads used to hash the start grid subtrees.
+     * @return False if the octree cannot be added to the sequence
+     **/
+    bool addFrame(const TOctreeSdf<InterpolationMethod>& octree, uint32_t numThreads = 1);
+
+    /**
+     * @return The number of frames of the sequence
+     **/
+    uint32_t getNumFrames() const { return static_cast<uint32_t>(mFrames.size()); }
+
+    /**
+     * @brief Selects the frame used by getDistance. It is clamped to the last frame.
+     *        It must not be called while other threads are querying the sequence.
+     **/
+    void setCurrentFrame(uint32_t frame) { mCurrentFrame = glm::min(frame, glm::max(getNumFrames(), 1u) - 1); }
+    uint32_t getCurrentFrame() const { return mCurrentFrame; }
+
+    /**
+     * @return The number of start grid cells that reference the subtree of the previous frame,
+     *         added up over all the frames
+     **/
+    uint64_t getNumSharedCells() const { return mNumSharedCells; }
+
+    /**
+     * @brief The queries use the current frame. The sequence must have at least one frame.
+     **/
+    float getDistance(glm::vec3 sample) const override;
+    float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+
+    /**
+     * @brief Linearly interpolates the distances of the two frames adjacent to the time.
+     *        The result is not an exact distance field, but the surface moves continuously between the frames.
+     * @param time The time measured in frames, it is clamped to the sequence length.
+     **/
+    float getDistanceAtTime(glm::vec3 sample, float time) const;
+    float getDistanceAtTime(glm::vec3 sample, float time, glm::vec3& outGradient) const;
+
+    BoundingBox getSampleArea() const override { return mBox; }
+    SdfFormat getFormat() const override { return SdfFormat::NONE; }
+
+    /**
+     * @brief The octree array is split into the start grids of all the frames and the subtrees.
+     *        The nodes per depth are counted for the current frame.
+     **/
+    MemoryUsage getMemoryUsage() const override;
+
+    // Load and save function for storing the structure on disk
+    template<class Archive>
+    void save(Archive & archive) const
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mValueRange, mNumSharedCells);
+        archive(mFrames, mOctreeData);
+    }
+
+    template<class Archive>
+    void load(Archive & archive)
+    {
+        archive(mBox, mStartGridSize, mMaxDepth, mValueRange, mNumSharedCells);
+        archive(mFrames, mOctreeData);
+
+        mStartGridCellSize = mBox.getSize().x / static_cast<float>(mStartGridSize);
+        mStartGridXY = mStartGridSize * mStartGridSize;
+        mCurrentFrame = 0;
+        mLastFrameHashes.clear();
+
+        float total = mOctreeData.size() * sizeof(OctreeNode);
+        SPDLOG_INFO("Sdf Sequence of {} frames Total: {}MB", mFrames.size(), total/1048576.0f);
+    }
+
+private:
+    struct Frame
+    {
+        // Position of the frame start grid in the octree array
+        uint32_t startGridIndex;
+        float minBorderValue;
+        FarFieldProxy farFieldProxy;
+
+        template<class Archive>
+        void serialize(Archive & archive)
+        {
+            archive(startGridIndex, minBorderValue, farFieldProxy);
+        }
+    };
+
+    template<bool ComputeGradient>
+    float queryFrame(uint32_t frame, glm::vec3 sample, glm::vec3& outGradient) const;
+
+    // Hash of the subtree contents, it does not depend on where the subtree is stored
+    static uint64_t hashSubtree(const LargeArray<OctreeNode>& data, OctreeNode root);
+    static bool equalSubtrees(const LargeArray<OctreeNode>& dataA, OctreeNode rootA,
+                              const LargeArray<OctreeNode>& dataB, OctreeNode rootB);
+    // Leaves whose coefficients are not stored, the octrees only storing the isosurface have them
+    static bool isEmptyLeaf(const LargeArray<OctreeNode>& data, OctreeNode node)
+    {
+        return node.isLeaf() && static_cast<uint64_t>(node.getChildrenIndex()) + InterpolationMethod::NUM_COEFFICIENTS > data.size();
+    }
+
+    BoundingBox mBox;
+    int mStartGridSize = 0;
+    int mStartGridXY = 0;
+    float mStartGridCellSize = 0.0f;
+    uint32_t mMaxDepth = 0;
+    // Maximum distance in absolute value of all the frames
+    float mValueRange = 0.0f;
+
+    std::vector<Frame> mFrames;
+    uint32_t mCurrentFrame = 0;
+    uint64_t mNumSharedCells = 0;
+
+    // Array storing the start grids and the subtrees of all the frames, the indices are absolute
+    LargeArray<OctreeNode> mOctreeData;
+    // Hashes of the last frame start grid subtrees, they are recomputed if the sequence is loaded from disk
+    std::vector<uint64_t> mLastFrameHashes;
+};
+
+template<>
+inline SdfFunction::SdfFormat TSdfSequence<TriLinearInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRILINEAR_SEQUENCE;
+}
+
+template<>
+inline SdfFunction::SdfFormat TSdfSequence<TriCubicInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRICUBIC_SEQUENCE;
+}
+
+template<>
+inline SdfFunction::SdfFormat TSdfSequence<TriQuadraticInterpolation>::getFormat() const
+{
+    return SdfFunction::SdfFormat::TRIQUADRATIC_SEQUENCE;
+}
+
+typedef TSdfSequence<> SdfSequence;
+
+// --- Public method definition --- //
+template<typename InterpolationMethod>
+bool TSdfSequence<InterpolationMethod>::addFrame(const TOctreeSdf<InterpolationMethod>& octree, uint32_t numThreads)
+{
+    if(octree.hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The sequences do not support octrees with segmented indices");
+        return false;
+    }
+
+    // At most, the frame copies its start grid and all its octree array
+    const uint64_t frameStartGridSize = octree.getStartGridSize().x;
+    const uint64_t maxFrameSize = frameStartGridSize * frameStartGridSize * frameStartGridSize + octree.getOctreeData().size();
+    if(!OctreeNode::fitsIndex(mOctreeData.size(), maxFrameSize))
+    {
+        SPDLOG_ERROR("The sequence array cannot address more frames with the nodes indices");
+        return false;
+    }
+
+    const BoundingBox& box = octree.getGridBoundingBox();
+    const int startGridSize = octree.getStartGridSize().x;
+    if(mFrames.empty())
+    {
+        mBox = box;
+        mStartGridSize = startGridSize;
+        mStartGridXY = mStartGridSize * mStartGridSize;
+        mStartGridCellSize = mBox.getSize().x / static_cast<float>(mStartGridSize);
+        mMaxDepth = octree.getOctreeMaxDepth();
+        mValueRange = octree.getOctreeValueRange();
+    }
+    else if(startGridSize != mStartGridSize ||
+            glm::any(glm::notEqual(box.min, mBox.min)) || glm::any(glm::notEqual(box.max, mBox.max)))
+    {
+        SPDLOG_ERROR("All the frames of a sequence must cover the same area with the same start grid");
+        return false;
+    }
+    else
+    {
+        mMaxDepth = glm::max(mMaxDepth, octree.getOctreeMaxDepth());
+        mValueRange = glm::max(mValueRange, octree.getOctreeValueRange());
+    }
+
+    const LargeArray<OctreeNode>& octreeData = octree.getOctreeData();
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+
+#ifdef OPENMP_AVAILABLE
+    omp_set_dynamic(0);
+    omp_set_num_threads(glm::max(numThreads, 1u));
+#endif
+
+    std::vector<uint64_t> hashes(startGridNumNodes);
+    #pragma omp parallel for schedule(dynamic)
+    for(int c=0; c < static_cast<int>(startGridNumNodes); c++)
+    {
+        hashes[c] = hashSubtree(octreeData, octreeData[c]);
+    }
+
+    const uint32_t lastStartGridIndex = (mFrames.empty()) ? 0 : mFrames.back().startGridIndex;
+    if(!mFrames.empty() && mLastFrameHashes.size() != startGridNumNodes)
+    {
+        mLastFrameHashes.resize(startGridNumNodes);
+        #pragma omp parallel for schedule(dynamic)
+        for(int c=0; c < static_cast<int>(startGridNumNodes); c++)
+        {
+            mLastFrameHashes[c] = hashSubtree(mOctreeData, mOctreeData[lastStartGridIndex + c]);
+        }
+    }
+
+    Frame frame;
+    frame.startGridIndex = static_cast<uint32_t>(mOctreeData.size());
+    frame.minBorderValue = octree.getOctreeMinBorderValue();
+    frame.farFieldProxy = octree.getFarFieldProxy();
+    mOctreeData.resize(mOctreeData.size() + startGridNumNodes);
+
+    // Copies the changed subtrees, keeping the arrays shared by a compressed octree
+    std::unordered_map<uint32_t, uint32_t> copiedArrays;
+    std::function<OctreeNode(OctreeNode)> copyNode;
+    copyNode = [&](OctreeNode node) -> OctreeNode
+    {
+        const uint32_t flags = node.childrenIndex & (OctreeNode::IS_LEAF_MASK | OctreeNode::MARK_MASK);
+        if(isEmptyLeaf(octreeData, node))
+        {
+            node.childrenIndex = OctreeNode::CHILDREN_INDEX_MASK | flags;
+            return node;
+        }
+
+        const uint32_t index = node.getChildrenIndex();
+        auto it = copiedArrays.find(index);
+        uint32_t newIndex;
+        if(it != copiedArrays.end())
+        {
+            newIndex = it->second;
+        }
+        else if(node.isLeaf())
+        {
+            newIndex = static_cast<uint32_t>(mOctreeData.size());
+            copiedArrays[index] = newIndex;
+            mOctreeData.insert(mOctreeData.end(), octreeData.begin() + index,
+                               octreeData.begin() + index + InterpolationMethod::NUM_COEFFICIENTS);
+        }
+        else
+        {
+            newIndex = static_cast<uint32_t>(mOctreeData.size());
+            copiedArrays[index] = newIndex;
+            mOctreeData.resize(mOctreeData.size() + 8);
+            for(uint32_t c=0; c < 8; c++)
+            {
+                const OctreeNode child = copyNode(octreeData[index + c]);
+                mOctreeData[newIndex + c] = child;
+            }
+        }
+
+        node.childrenIndex = newIndex | flags;
+        return node;
+    };
+
+    uint32_t numSharedCells = 0;
+    for(uint32_t c=0; c < startGridNumNodes; c++)
+    {
+        OctreeNode root;
+        if(!mFrames.empty() && hashes[c] == mLastFrameHashes[c] &&
+           equalSubtrees(octreeData, octreeData[c], mOctreeData, mOctreeData[lastStartGridIndex + c]))
+        {
+            root = mOctreeData[lastStartGridIndex + c];
+            numSharedCells++;
+        }
+        else
+        {
+            root = copyNode(octreeData[c]);
+        }
+        mOctreeData[frame.startGridIndex + c] = root;
+    }
+
+    mFrames.push_back(frame);
+    mLastFrameHashes = std::move(hashes);
+    mNumSharedCells += numSharedCells;
+
+    SPDLOG_INFO("Sequence frame {}: {} of {} start grid cells shared with the previous frame, {}MB total",
+                mFrames.size() - 1, numSharedCells, startGridNumNodes, mOctreeData.size() * sizeof(OctreeNode) / 1048576.0f);
+    return true;
+}
+
+template<typename InterpolationMethod>
+float TSdfSequence<InterpolationMethod>::getDistance(glm::vec3 sample) const
+{
+    glm::vec3 gradient;
+    return queryFrame<false>(mCurrentFrame, sample, gradient);
+}
+
+template<typename InterpolationMethod>
+float TSdfSequence<InterpolationMethod>::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    const float distance = queryFrame<true>(mCurrentFrame, sample, outGradient);
+    outGradient = glm::normalize(outGradient);
+    return distance;
+}
+
+template<typename InterpolationMethod>
+float TSdfSequence<InterpolationMethod>::getDistanceAtTime(glm::vec3 sample, float time) const
+{
+    time = glm::clamp(time, 0.0f, static_cast<float>(getNumFrames() - 1));
+    const uint32_t frame = static_cast<uint32_t>(time);
+    const float t = time - static_cast<float>(frame);
+
+    glm::vec3 gradient;
+    const float distance = queryFrame<false>(frame, sample, gradient);
+    if(t == 0.0f) return distance;
+    return glm::mix(distance, queryFrame<false>(frame + 1, sample, gradient), t);
+}
+
+template<typename InterpolationMethod>
+float TSdfSequence<InterpolationMethod>::getDistanceAtTime(glm::vec3 sample, float time, glm::vec3& outGradient) const
+{
+    time = glm::clamp(time, 0.0f, static_cast<float>(getNumFrames() - 1));
+    const uint32_t frame = static_cast<uint32_t>(time);
+    const float t = time - static_cast<float>(frame);
+
+    float distance = queryFrame<true>(frame, sample, outGradient);
+    if(t > 0.0f)
+    {
+        glm::vec3 nextGradient;
+        distance = glm::mix(distance, queryFrame<true>(frame + 1, sample, nextGradient), t);
+        outGradient = glm::mix(outGradient, nextGradient, t);
+    }
+    outGradient = glm::normalize(outGradient);
+    return distance;
+}
+
+template<typename InterpolationMethod>
+SdfFunction::MemoryUsage TSdfSequence<InterpolationMethod>::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.nodesPerDepth.assign(mMaxDepth + 1, 0);
+    usage.leavesPerDepth.assign(mMaxDepth + 1, 0);
+    if(mFrames.empty()) return usage;
+
+    std::function<void(const OctreeNode&, uint32_t)> vistNode;
+    vistNode = [&](const OctreeNode& node, uint32_t depth)
+    {
+        usage.nodesPerDepth[depth]++;
+        if(node.isLeaf())
+        {
+            usage.leavesPerDepth[depth]++;
+            return;
+        }
+
+        for(uint32_t i = 0; i < 8; i++)
+        {
+            vistNode(mOctreeData[node.getChildrenIndex() + i], depth + 1);
+        }
+    };
+
+    const uint32_t startDepth = glm::round(glm::log2(static_cast<float>(mStartGridSize)));
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+    const uint32_t startGridIndex = mFrames[mCurrentFrame].startGridIndex;
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        vistNode(mOctreeData[startGridIndex + i], startDepth);
+    }
+
+    const size_t startGridsBytes = mFrames.size() * startGridNumNodes * sizeof(OctreeNode);
+    usage.addArray("start grids", startGridsBytes);
+    usage.addArray("subtrees", mOctreeData.capacity() * sizeof(OctreeNode) - startGridsBytes);
+    usage.addArray("frames", mFrames);
+    return usage;
+}
+
+// --- Private method definition --- //
+template<typename InterpolationMethod>
+template<bool ComputeGradient>
+float TSdfSequence<InterpolationMethod>::queryFrame(uint32_t frame, glm::vec3 sample, glm::vec3& outGradient) const
+{
+    auto roundFloat = [](float a) -> uint32_t
+    {
+        return (a >= 0.5f) ? 1 : 0;
+    };
+
+    const Frame& frameInfo = mFrames[frame];
+
+    glm::vec3 fracPart = (sample - mBox.min) / mStartGridCellSize;
+    glm::ivec3 startArrayPos = glm::floor(fracPart);
+    fracPart = glm::fract(fracPart);
+
+    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
+       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
+       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    {
+        if(!ComputeGradient)
+        {
+            return glm::max(mBox.getDistance(sample) + frameInfo.minBorderValue, frameInfo.farFieldProxy.getDistance(sample));
+        }
+
+        const float boxDist = mBox.getDistance(sample, outGradient) + frameInfo.minBorderValue;
+        glm::vec3 proxyGradient;
+        const float proxyDist = frameInfo.farFieldProxy.getDistance(sample, proxyGradient);
+        if(proxyDist > boxDist)
+        {
+            outGradient = proxyGradient;
+            return proxyDist;
+        }
+        return boxDist;
+    }
+
+    const uint32_t startCellIndex = startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x;
+    const OctreeNode* currentNode = &mOctreeData[frameInfo.startGridIndex + startCellIndex];
+    uint32_t levels = 0;
+
+    while(!currentNode->isLeaf())
+    {
+        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) +
+                                  (roundFloat(fracPart.y) << 1) +
+                                   roundFloat(fracPart.x);
+
+        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        fracPart = glm::fract(2.0f * fracPart);
+        levels++;
+    }
+
+    if(currentNode->getChildrenIndex() >= mOctreeData.size())
+    {
+        if(ComputeGradient) outGradient = glm::vec3(0.0f);
+        return 10.0f;
+    }
+
+    auto& values = *reinterpret_cast<const std::array<float, InterpolationMethod::NUM_COEFFICIENTS>*>(&mOctreeData[currentNode->getChildrenIndex()]);
+
+    if(!ComputeGradient) return InterpolationMethod::interpolateValue(values, fracPart);
+
+    const float distance = InterpolationMethod::interpolateValueAndGradient(values, fracPart, outGradient);
+    // The interpolation gradient is relative to the leaf size
+    outGradient *= static_cast<float>(1 << levels) / mStartGridCellSize;
+    return distance;
+}
+
+template<typename InterpolationMethod>
+uint64_t TSdfSequence<InterpolationMethod>::hashSubtree(const LargeArray<OctreeNode>& data, OctreeNode root)
+{
+    // FNV-1a over the node flags and the coefficients in depth-first order
+    uint64_t hash = 14695981039346656037ull;
+    auto addWord = [&](uint32_t word)
+    {
+        hash = (hash ^ word) * 1099511628211ull;
+    };
+
+    std::function<void(OctreeNode)> vistNode;
+    vistNode = [&](OctreeNode node)
+    {
+        addWord(node.childrenIndex & (OctreeNode::IS_LEAF_MASK | OctreeNode::MARK_MASK));
+        const uint32_t index = node.getChildrenIndex();
+        if(isEmptyLeaf(data, node))
+        {
+            addWord(OctreeNode::CHILDREN_INDEX_MASK);
+        }
+        else if(node.isLeaf())
+        {
+            for(uint32_t i=0; i < InterpolationMethod::NUM_COEFFICIENTS; i++) addWord(data[index + i].childrenIndex);
+        }
+        else
+        {
+            for(uint32_t c=0; c < 8; c++) vistNode(data[index + c]);
+        }
+    };
+
+    vistNode(root);
+    return hash;
+}
+
+template<typename InterpolationMethod>
+bool TSdfSequence<InterpolationMethod>::equalSubtrees(const LargeArray<OctreeNode>& dataA, OctreeNode rootA,
+                                                      const LargeArray<OctreeNode>& dataB, OctreeNode rootB)
+{
+    constexpr uint32_t FLAGS_MASK = OctreeNode::IS_LEAF_MASK | OctreeNode::MARK_MASK;
+    if((rootA.childrenIndex & FLAGS_MASK) != (rootB.childrenIndex & FLAGS_MASK)) return false;
+
+    const uint32_t indexA = rootA.getChildrenIndex();
+    const uint32_t indexB = rootB.getChildrenIndex();
+    if(rootA.isLeaf())
+    {
+        const bool emptyA = isEmptyLeaf(dataA, rootA);
+        if(emptyA || isEmptyLeaf(dataB, rootB)) return emptyA && isEmptyLeaf(dataB, rootB);
+        return std::memcmp(&dataA[indexA], &dataB[indexB], InterpolationMethod::NUM_COEFFICIENTS * sizeof(OctreeNode)) == 0;
+    }
+
+    for(uint32_t c=0; c < 8; c++)
+    {
+        if(!equalSubtrees(dataA, dataA[indexA + c], dataB, dataB[indexB + c])) return false;
+    }
+    return true;
+}
+}
+
+#endif
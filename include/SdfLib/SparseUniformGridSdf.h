@@ -0,0 +1,132 @@
+#ifndef SPARSE_UNIFORM_GRID_SDF_H
+#define SPARSE_UNIFORM_GRID_SDF_H
+
+#include <array>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#include "utils/Mesh.h"
+#include "utils/UsefullSerializations.h"
+#include "SdfFunction.h"
+
+#include <cereal/types/vector.hpp>
+
+namespace sdflib
+{
+/**
+ * @brief Uniform grid of distances that only stores the samples near the surface.
+ *        The samples are grouped in blocks of 8x8x8 stored in an open addressing hash table.
+ *        Outside the stored blocks the grid returns the band width with the sign of the block,
+ *        so only one byte per block is stored for the empty space.
+ *        The grid has at least two samples per axis.
+ **/
+class SparseUniformGridSdf : public SdfFunction
+{
+public:
+    // Number of samples per axis of a block
+    static constexpr uint32_t BLOCK_SIZE = 8;
+    static constexpr uint32_t BLOCK_NUM_SAMPLES = BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE;
+
+    SparseUniformGridSdf() {}
+    /**
+     * @param mesh The input mesh.
+     * @param box The area that the structure must cover.
+     * @param cellSize The distance between the grid samples.
+     * @param bandWidth The samples with distances lower than this value are stored.
+     * @param numThreads The maximum number of threads to use during the structure construction.
+     **/
+    SparseUniformGridSdf(const Mesh& mesh, BoundingBox box, float cellSize, float bandWidth, uint32_t numThreads = 1);
+    /**
+     * @brief Samples an existing structure.
+     * @param sdf The structure to sample.
+     * @param box The area that the structure must cover.
+     * @param cellSize The distance between the grid samples.
+     * @param bandWidth The samples with distances lower than this value are stored.
+     * @param numThreads The maximum number of threads to use during the structure construction.
+     **/
+    SparseUniformGridSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float bandWidth, uint32_t numThreads = 1);
+
+    float getDistance(glm::vec3 sample) const override;
+    float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
+    SdfFormat getFormat() const override { return SdfFormat::SPARSE_GRID; }
+
+    /**
+     * @return False if the grid has not been built because it is too big to be indexed or its parameters are not valid
+     **/
+    bool isValid() const override { return !mTableKeys.empty(); }
+
+    float getMinCellSize() const override { return mCellSize; }
+
+    const BoundingBox& getGridBoundingBox() const { return mBox; }
+    BoundingBox getSampleArea() const override { return mBox; }
+    float getGridCellSize() const { return mCellSize; }
+    float getBandWidth() const { return mBandWidth; }
+    glm::ivec3 getGridSize() const { return mGridSize; }
+
+    /**
+     * @return The number of blocks stored
+     **/
+    uint32_t getNumStoredBlocks() const { return static_cast<uint32_t>(mBlocks.size() / BLOCK_NUM_SAMPLES); }
+
+    template<class Archive>
+    void save(Archive & archive) const
+    {
+        archive(mBox, mCellSize, mBandWidth, mGridSize, mNumBlocks, mBlockSigns, mTableKeys, mTableBlocks, mBlocks);
+    }
+
+    template<class Archive>
+    void load(Archive & archive)
+    {
+        archive(mBox, mCellSize, mBandWidth, mGridSize, mNumBlocks, mBlockSigns, mTableKeys, mTableBlocks, mBlocks);
+        mTableMask = static_cast<uint32_t>(mTableKeys.size()) - 1;
+
+        float total = mBlockSigns.size() * sizeof(uint8_t) + mTableKeys.size() * sizeof(uint64_t) +
+                      mTableBlocks.size() * sizeof(uint32_t) + mBlocks.size() * sizeof(float);
+        SPDLOG_INFO("Sparse Uniform Grid Sdf Total: {}MB, {} blocks stored", total/1048576.0f, getNumStoredBlocks());
+    }
+
+private:
+    static constexpr uint64_t EMPTY_KEY = ~0ull;
+    static constexpr uint32_t BITS_PER_AXIS = 21;
+
+    BoundingBox mBox;
+    float mCellSize = 0.0f;
+    float mBandWidth = 0.0f;
+    glm::ivec3 mGridSize = glm::ivec3(0);
+    glm::ivec3 mNumBlocks = glm::ivec3(0);
+
+    // Sign of the distances of each block, used for the blocks not stored
+    std::vector<uint8_t> mBlockSigns;
+
+    // Hash table with linear probing, it maps the block positions to the blocks array
+    uint32_t mTableMask = 0;
+    std::vector<uint64_t> mTableKeys;
+    std::vector<uint32_t> mTableBlocks;
+
+    // Samples of the stored blocks
+    std::vector<float> mBlocks;
+
+    void initFromSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float bandWidth, uint32_t numThreads);
+
+    static inline uint64_t getBlockKey(glm::ivec3 blockPos)
+    {
+        return static_cast<uint64_t>(blockPos.x) |
+               (static_cast<uint64_t>(blockPos.y) << BITS_PER_AXIS) |
+               (static_cast<uint64_t>(blockPos.z) << (2 * BITS_PER_AXIS));
+    }
+
+    inline uint32_t getTableSlot(uint64_t key) const
+    {
+        return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mTableMask;
+    }
+
+    /**
+     * @return The samples of the block or nullptr if it is not stored
+     **/
+    const float* findBlock(glm::ivec3 blockPos) const;
+    float getSample(glm::ivec3 samplePos) const;
+    void getCellValues(glm::vec3 sample, std::array<float, 8>& outValues, glm::vec3& outFracPart) const;
+};
+}
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef UNIFORM_GRID_SDF_H
 #define UNIFORM_GRID_SDF_H
 
+#include <string>
 #include <vector>
 
 #include "utils/Mesh.h"
@@ -29,6 +30,7 @@ public:
     float getDistance(glm::vec3 sample) const override;
     float getDistance(glm::vec3 sample, glm::vec3& outGradient) const override;
     SdfFormat getFormat() const override { return SdfFormat::GRID; }
+    float getMinCellSize() const override { return mCellSize; }
 
     const BoundingBox& getGridBoundingBox() const { return mBox; }
     BoundingBox getSampleArea() const override { return mBox; }
@@ -36,17 +38,84 @@ public:
     glm::ivec3 getGridSize() const { return mGridSize; }
     const std::vector<float>& getGrid() const { return mGrid; }
 
+    /**
+     * @brief Builds a chain of coarser grids, each one with half the resolution of the previous one.
+     *        Each coarse value is the minimum of the finer values in the cells around it,
+     *        so the interpolated distance of a coarse level is never greater than the one of the finest grid.
+     * @param numLevels The maximum number of coarse levels. The chain stops before a level has less than 3 values per axis.
+     * @param numThreads The maximum number of threads to use.
+     **/
+    void buildMipChain(uint32_t numLevels, uint32_t numThreads = 1);
+
+    /**
+     * @return The number of levels, including the finest grid
+     **/
+    uint32_t getNumMipLevels() const { return static_cast<uint32_t>(mMipGrids.size()) + 1; }
+
+    /**
+     * @return The distance between the samples of a level
+     **/
+    float getMipCellSize(uint32_t level) const { return mCellSize * static_cast<float>(1 << level); }
+
+    /**
+     * @return The coarsest level whose cells are not bigger than the footprint, it can be used as the level of detail
+     **/
+    uint32_t getMipLevelForFootprint(float footprint) const;
+
+    /**
+     * @brief Gets a lower bound of the distance using a level of the mip chain.
+     *        The samples outside the grid are clamped to it and the distance to the grid is subtracted.
+     * @param level The level used, it is clamped to the coarsest one. Level 0 is the finest grid.
+     **/
+    float getDistanceConservative(glm::vec3 sample, uint32_t level) const;
+
+    /**
+     * @brief Sphere traces a ray using the coarse levels to skip the empty space.
+     *        It moves to a finer level when the ray gets closer than a cell to the surface of a level,
+     *        and back to a coarser level when it moves away.
+     * @param origin The ray origin.
+     * @param direction The normalized ray direction.
+     * @param maxDistance The maximum distance travelled along the ray.
+     * @param outDistance The distance along the ray to the surface.
+     * @param epsilon The distance to the surface considered a hit.
+     * @param maxSteps The maximum number of queries.
+     * @param outNumSteps If it is not null, it returns the number of queries done.
+     * @return If the ray hits the surface
+     **/
+    bool rayMarch(glm::vec3 origin, glm::vec3 direction, float maxDistance, float& outDistance,
+                  float epsilon = 1e-4f, uint32_t maxSteps = 512, uint32_t* outNumSteps = nullptr) const;
+
+    MemoryUsage getMemoryUsage() const override
+    {
+        MemoryUsage usage;
+        usage.addArray("grid values", mGrid);
+        for(uint32_t l=0; l < mMipGrids.size(); l++)
+        {
+            usage.addArray("mip level " + std::to_string(l + 1), mMipGrids[l]);
+        }
+        return usage;
+    }
+
+    // The version 0 is the layout before the mip chain was added
     template<class Archive>
-    void save(Archive & archive) const
+    void save(Archive & archive, std::uint32_t const version) const
     { 
         archive(mBox, mGridSize, mGrid);
+        if(version >= 1) archive(mMipGridSizes, mMipGrids);
     }
 
     template<class Archive>
-    void load(Archive & archive)
+    void load(Archive & archive, std::uint32_t const version)
     {
         archive(mBox, mGridSize, mGrid);
 
+        if(version >= 1) archive(mMipGridSizes, mMipGrids);
+        else
+        {
+            mMipGridSizes.clear();
+            mMipGrids.clear();
+        }
+
         glm::vec3 cellSize = mBox.getSize() / glm::vec3(mGridSize - 1);
         assert(
             glm::abs(cellSize.x - cellSize.y) < 0.00001f &&
@@ -65,6 +134,12 @@ private:
     int mGridXY = 0;
     std::vector<float> mGrid;
 
+    // Coarse levels of the mip chain, the level l is stored at l - 1
+    std::vector<glm::ivec3> mMipGridSizes;
+    std::vector<std::vector<float>> mMipGrids;
+
+    float interpolateGrid(const std::vector<float>& grid, glm::ivec3 gridSize, float cellSize, glm::vec3 sample) const;
+
     void basicInit(const std::vector<TriangleUtils::TriangleData>& trianglesData);
     void octreeInit(const Mesh& mesh, const std::vector<TriangleUtils::TriangleData>& trianglesData);
     void evalNode(glm::vec3 center, glm::vec3 size, 
@@ -74,4 +149,6 @@ private:
 };
 }
 
+CEREAL_CLASS_VERSION(sdflib::UniformGridSdf, 1);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sdflib
+{
+namespace Compression
+{
+    /**
+     * @brief Appends an unsigned integer using 7 bits per byte.
+     **/
+    void writeVarint(uint64_t value, std::vector<uint8_t>& out);
+
+    /**
+     * @brief Reads an integer written by writeVarint and advances the position.
+     * @return False if the integer exceeds the end of the data
+     **/
+    bool readVarint(const uint8_t* data, size_t dataSize, size_t& position, uint64_t& outValue);
+
+    /**
+     * @brief Stores the first byte of all the elements, then the second one, and so on.
+     *        The bytes with similar meanings are stored together, which helps the entropy coder.
+     * @param elementSize The size in bytes of each element.
+     **/
+    void splitBytePlanes(const uint8_t* data, size_t numElements, size_t elementSize, uint8_t* outPlanes);
+
+    /**
+     * @brief Inverse of splitBytePlanes.
+     **/
+    void mergeBytePlanes(const uint8_t* planes, size_t numElements, size_t elementSize, uint8_t* outData);
+
+    /**
+     * @brief Appends the data encoded with an order-0 rANS coder.
+     *        If the encoding does not reduce the size, the data is stored raw.
+     **/
+    void encodeBytes(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+    /**
+     * @brief Decodes a block written by encodeBytes.
+     * @param size The size of the decoded data, it must be stored by the caller.
+     * @return False if the block is corrupted
+     **/
+    bool decodeBytes(const uint8_t* data, size_t dataSize, uint8_t* outData, size_t size);
+}
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef FAR_FIELD_PROXY_H
+#define FAR_FIELD_PROXY_H
+
+#include <array>
+#include <glm/glm.hpp>
+#include <cereal/types/array.hpp>
+
+#include "SdfLib/utils/Mesh.h"
+
+namespace sdflib
+{
+/**
+ * @brief Coarse convex hull of a mesh used to answer the queries outside the structures area.
+ *        The hull is a 26-DOP, the mesh extent along 13 fixed directions. The distance to
+ *        any of its slabs is a lower bound of the distance to the mesh surface.
+ **/
+struct FarFieldProxy
+{
+    static constexpr uint32_t NUM_DIRECTIONS = 13;
+
+    FarFieldProxy()
+    {
+        mMin.fill(INFINITY);
+        mMax.fill(-INFINITY);
+    }
+
+    FarFieldProxy(const Mesh& mesh);
+
+    /**
+     * @return If the proxy has been computed from a mesh.
+     **/
+    bool isValid() const { return mMin[0] <= mMax[0]; }
+
+    /**
+     * @brief Returns a lower bound of the distance from the sample to the mesh.
+     *        The bound is only meaningful for samples outside the mesh.
+     *        It returns -INFINITY if the proxy is not valid.
+     **/
+    inline float getDistance(glm::vec3 sample) const
+    {
+        float maxDist = -INFINITY;
+        for(uint32_t i=0; i < NUM_DIRECTIONS; i++)
+        {
+            const float d = glm::dot(getDirection(i), sample);
+            maxDist = glm::max(maxDist, glm::max(d - mMax[i], mMin[i] - d));
+        }
+        return maxDist;
+    }
+
+    /**
+     * @brief Returns a lower bound of the distance from the sample to the mesh
+     *        and the normal of the slab generating the bound.
+     **/
+    inline float getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+    {
+        float maxDist = -INFINITY;
+        outGradient = glm::vec3(0.0f);
+        for(uint32_t i=0; i < NUM_DIRECTIONS; i++)
+        {
+            const glm::vec3 dir = getDirection(i);
+            const float d = glm::dot(dir, sample);
+            if(d - mMax[i] > maxDist)
+            {
+                maxDist = d - mMax[i];
+                outGradient = dir;
+            }
+
+            if(mMin[i] - d > maxDist)
+            {
+                maxDist = mMin[i] - d;
+                outGradient = -dir;
+            }
+        }
+        return maxDist;
+    }
+
+    template<class Archive>
+    void serialize(Archive & archive)
+    {
+        archive(mMin, mMax);
+    }
+
+private:
+    static inline glm::vec3 getDirection(uint32_t index)
+    {
+        constexpr float a = 0.70710678f; // 1/sqrt(2)
+        constexpr float b = 0.57735027f; // 1/sqrt(3)
+        static constexpr float directions[NUM_DIRECTIONS][3] =
+        {
+            { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+            { a, a, 0.0f }, { a, -a, 0.0f },
+            { a, 0.0f, a }, { a, 0.0f, -a },
+            { 0.0f, a, a }, { 0.0f, a, -a },
+            { b, b, b }, { b, b, -b }, { b, -b, b }, { b, -b, -b }
+        };
+
+        return glm::vec3(directions[index][0], directions[index][1], directions[index][2]);
+    }
+
+    std::array<float, NUM_DIRECTIONS> mMin;
+    std::array<float, NUM_DIRECTIONS> mMax;
+};
+}
+
+#endif
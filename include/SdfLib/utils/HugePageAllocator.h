@@ -0,0 +1,80 @@
+#ifndef HUGE_PAGE_ALLOCATOR_H
+#define HUGE_PAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace sdflib
+{
+/**
+ * @brief Policies to allocate the big arrays of the structures.
+ **/
+enum class LargeArrayPolicy
+{
+    DEFAULT, // Memory aligned to the cache line
+    HUGE_PAGES, // The arrays bigger than a huge page are aligned to it and advised to use transparent huge pages
+    HUGE_PAGES_LOCKED // Like HUGE_PAGES, but the memory is also locked in RAM
+};
+
+/**
+ * @brief Sets the policy used by the next allocations of the large arrays.
+ *        The arrays already allocated keep their policy, so it must be set before constructing or loading a structure.
+ *        The default policy is HUGE_PAGES if the library is built with SDFLIB_USE_HUGE_PAGES, otherwise it is DEFAULT.
+ **/
+void setLargeArrayPolicy(LargeArrayPolicy policy);
+
+/**
+ * @return The policy used to allocate the large arrays
+ **/
+LargeArrayPolicy getLargeArrayPolicy();
+
+namespace internal
+{
+    constexpr size_t CACHE_LINE_SIZE = 64;
+    constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    void* allocateLargeArray(size_t numBytes);
+    void freeLargeArray(void* ptr, size_t numBytes);
+}
+
+/**
+ * @brief Allocator for the big arrays of the structures. It follows the current LargeArrayPolicy.
+ **/
+template<typename T>
+class HugePageAllocator
+{
+public:
+    typedef T value_type;
+
+    HugePageAllocator() noexcept {}
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        if(n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+        void* ptr = internal::allocateLargeArray(n * sizeof(T));
+        if(ptr == nullptr) throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        internal::freeLargeArray(ptr, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const HugePageAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const HugePageAllocator<U>&) const noexcept { return false; }
+};
+
+// Array type used for the big arrays of the structures
+template<typename T>
+using LargeArray = std::vector<T, HugePageAllocator<T>>;
+}
+
+#endif
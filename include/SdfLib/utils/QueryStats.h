@@ -0,0 +1,113 @@
+#ifndef QUERY_STATS_H
+#define QUERY_STATS_H
+
+#include <array>
+#include <atomic>
+
+namespace sdflib
+{
+/**
+ * @brief Counters of the work done by the queries of a structure.
+ **/
+struct QueryStats
+{
+    static constexpr uint32_t MAX_DEPTH = 32;
+
+    uint64_t numQueries = 0; // Queries inside the structure box
+    uint64_t numOutOfBoxQueries = 0;
+    uint64_t nodesVisited = 0;
+    uint64_t trianglesEvaluated = 0;
+    uint64_t maskBitsDecoded = 0;
+    std::array<uint64_t, MAX_DEPTH> leafDepthHistogram{};
+
+    QueryStats& operator+=(const QueryStats& other)
+    {
+        numQueries += other.numQueries;
+        numOutOfBoxQueries += other.numOutOfBoxQueries;
+        nodesVisited += other.nodesVisited;
+        trianglesEvaluated += other.trianglesEvaluated;
+        maskBitsDecoded += other.maskBitsDecoded;
+        for(uint32_t d=0; d < MAX_DEPTH; d++) leafDepthHistogram[d] += other.leafDepthHistogram[d];
+        return *this;
+    }
+};
+
+/**
+ * @brief Per-thread query counters of a structure that can be switched at runtime.
+ *        When it is disabled, the queries only pay for a load and a branch.
+ *        The counters are a fixed array of cache line aligned slots, indexed by the thread creation order,
+ *        and getStats() adds them up. The array is only allocated the first time the counters are enabled.
+ **/
+class QueryStatsCounter
+{
+public:
+    QueryStatsCounter();
+    // The counters are not copied, the copy starts empty
+    QueryStatsCounter(const QueryStatsCounter& other);
+    QueryStatsCounter& operator=(const QueryStatsCounter& other);
+    ~QueryStatsCounter();
+
+    /**
+     * @brief Enables or disables the counters. The first time they are enabled, the slots are allocated.
+     **/
+    void setEnabled(bool enabled);
+    // The acquire load makes the slots allocated by setEnabled visible to the recording threads
+    inline bool isEnabled() const { return mEnabled.load(std::memory_order_acquire); }
+
+    /**
+     * @return The sum of the counters of all the threads
+     **/
+    QueryStats getStats() const;
+    /**
+     * @brief Sets all the counters to zero.
+     *        It should not be called while there are queries running.
+     **/
+    void reset();
+
+    // The record functions can only be called while the counters are enabled
+    inline void recordOutOfBox() const
+    {
+        ThreadCounters& c = mThreadsCounters.load(std::memory_order_relaxed)[getThreadSlot()];
+        increment(c.numOutOfBoxQueries, 1);
+    }
+
+    inline void recordQuery(uint32_t nodesVisited, uint32_t leafDepth,
+                            uint32_t trianglesEvaluated = 0, uint32_t maskBitsDecoded = 0) const
+    {
+        ThreadCounters& c = mThreadsCounters.load(std::memory_order_relaxed)[getThreadSlot()];
+        increment(c.numQueries, 1);
+        increment(c.nodesVisited, nodesVisited);
+        increment(c.trianglesEvaluated, trianglesEvaluated);
+        increment(c.maskBitsDecoded, maskBitsDecoded);
+        increment(c.leafDepthHistogram[(leafDepth < QueryStats::MAX_DEPTH) ? leafDepth : QueryStats::MAX_DEPTH - 1], 1);
+    }
+
+private:
+    static constexpr uint32_t NUM_THREAD_SLOTS = 64;
+
+    // Aligned to its own cache line, so the threads do not invalidate each other slots
+    struct alignas(64) ThreadCounters
+    {
+        std::atomic<uint64_t> numQueries{0};
+        std::atomic<uint64_t> numOutOfBoxQueries{0};
+        std::atomic<uint64_t> nodesVisited{0};
+        std::atomic<uint64_t> trianglesEvaluated{0};
+        std::atomic<uint64_t> maskBitsDecoded{0};
+        std::array<std::atomic<uint64_t>, QueryStats::MAX_DEPTH> leafDepthHistogram{};
+    };
+
+    // More than NUM_THREAD_SLOTS threads share slots, so the increments must be atomic
+    static inline void increment(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static uint32_t getThreadSlot();
+
+    std::atomic<bool> mEnabled{false};
+    // Array of NUM_THREAD_SLOTS slots, null until the counters are enabled
+    std::atomic<ThreadCounters*> mThreadsCounters{nullptr};
+};
+}
+
+#endif
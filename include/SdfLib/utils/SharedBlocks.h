@@ -0,0 +1,71 @@
+#ifndef SHARED_BLOCKS_H
+#define SHARED_BLOCKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace sdflib
+{
+/**
+ * @brief Index of the blocks written in an array, used to share the identical blocks.
+ *        It only keeps the hash and the position of each block, the candidates are compared against the array,
+ *        so the blocks are not copied again.
+ **/
+template<typename Array>
+class SharedBlocks
+{
+public:
+    typedef typename Array::value_type Element;
+
+    SharedBlocks(Array& array) : mArray(array) {}
+
+    /**
+     * @return The position of a block equal to the given one, which is appended to the array if there is none.
+     *         The block cannot be part of the array.
+     **/
+    uint64_t insert(const Element* block, uint64_t blockSize)
+    {
+        const uint64_t hash = hashBlock(block, blockSize);
+        auto range = mPositions.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it)
+        {
+            // Blocks of different sizes can have the same hash, the one found could end after the array
+            if(it->second + blockSize <= mArray.size() &&
+               std::memcmp(mArray.data() + it->second, block, blockSize * sizeof(Element)) == 0)
+            {
+                return it->second;
+            }
+        }
+
+        const uint64_t position = mArray.size();
+        mArray.insert(mArray.end(), block, block + blockSize);
+        mPositions.emplace(hash, position);
+        return position;
+    }
+
+    /**
+     * @return The number of different blocks
+     **/
+    size_t size() const { return mPositions.size(); }
+
+private:
+    Array& mArray;
+    std::unordered_multimap<uint64_t, uint64_t> mPositions;
+
+    static uint64_t hashBlock(const Element* block, uint64_t blockSize)
+    {
+        // FNV-1a over the block bytes, starting with its size
+        uint64_t hash = (14695981039346656037ull ^ blockSize) * 1099511628211ull;
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(block);
+        for(uint64_t b=0; b < blockSize * sizeof(Element); b++)
+        {
+            hash = (hash ^ bytes[b]) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sdflib
+{
+/**
+ * @brief Work-stealing thread pool used to run the asynchronous queries.
+ *        Each worker owns a task queue, takes tasks from its front and,
+ *        when it is empty, steals tasks from the back of the other queues.
+ **/
+class ThreadPool
+{
+public:
+    /**
+     * @param numThreads Number of worker threads.
+     *                   If it is zero, it uses the number of hardware threads.
+     **/
+    ThreadPool(uint32_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @return The pool shared by all the library structures.
+     *          It is created with one worker per hardware thread on the first call.
+     **/
+    static ThreadPool& getGlobalPool();
+
+    /**
+     * @return The number of worker threads
+     **/
+    uint32_t getNumThreads() const { return static_cast<uint32_t>(mThreads.size()); }
+
+    /**
+     * @brief Adds a task to the pool.
+     *        Tasks submitted from a worker are pushed to the worker own queue.
+     **/
+    void submit(std::function<void()> task);
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mSleepMutex;
+    std::condition_variable mSleepCondition;
+    uint32_t mPendingTasks = 0; // Protected by mSleepMutex
+    bool mStop = false; // Protected by mSleepMutex
+
+    std::atomic<uint32_t> mNextQueue{0};
+
+    void workerLoop(uint32_t workerIndex);
+    bool popTask(uint32_t workerIndex, std::function<void()>& outTask);
+};
+}
+
+#endif
@@ -71,15 +71,113 @@ namespace TriangleUtils
         std::array<glm::vec3, 3> verticesNormal;
     };
 
-    std::vector<TriangleData> calculateMeshTriangleData(const Mesh& mesh);
+    // Encodes a unit vector with the octahedral mapping using 16 bits per component
+    inline uint32_t encodeOctahedralNormal(glm::vec3 n)
+    {
+        n /= glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+        glm::vec2 p(n.x, n.y);
+        if(n.z < 0.0f)
+        {
+            p = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2((n.x >= 0.0f) ? 1.0f : -1.0f, (n.y >= 0.0f) ? 1.0f : -1.0f);
+        }
 
-    inline float getSqDistPointAndTriangle(glm::vec3 point, const TriangleData& data)
+        const glm::ivec2 q = glm::ivec2(glm::round(glm::clamp(p, -1.0f, 1.0f) * 32767.0f));
+        return (static_cast<uint32_t>(q.x) & 0xFFFF) | (static_cast<uint32_t>(q.y) << 16);
+    }
+
+    inline glm::vec3 decodeOctahedralNormal(uint32_t code)
     {
-        glm::vec3 projPoint = data.transform * (point - data.origin);
+        const glm::vec2 p = glm::vec2(static_cast<float>(static_cast<int16_t>(code & 0xFFFF)),
+                                      static_cast<float>(static_cast<int16_t>(code >> 16))) / 32767.0f;
+        glm::vec3 n(p.x, p.y, 1.0f - glm::abs(p.x) - glm::abs(p.y));
+        const float t = glm::max(-n.z, 0.0f);
+        n.x += (n.x >= 0.0f) ? -t : t;
+        n.y += (n.y >= 0.0f) ? -t : t;
+        return glm::normalize(n);
+    }
+
+    /**
+     * @brief Reduced version of the TriangleData, it uses 72 bytes instead of 148.
+     *        It only stores the first and last rows of the triangle space transform,
+     *        the rest of the frame and the edges directions are rebuilt during the distance evaluation.
+     *        The normals are only used for the distance sign, so they are stored octahedral encoded.
+     **/
+    struct CompactTriangleData
+    {
+        CompactTriangleData() {}
+        CompactTriangleData(const TriangleData& data)
+        {
+            origin = data.origin;
+            sx = glm::vec3(data.transform[0][0], data.transform[1][0], data.transform[2][0]);
+            sz = data.getTriangleNormal();
+            v2 = data.v2;
+            v3 = data.v3;
+
+            auto encode = [](glm::vec3 n)
+            {
+                const float length = glm::length(n);
+                return encodeOctahedralNormal((length > 0.0f) ? n / length : glm::vec3(0.0f, 0.0f, 1.0f));
+            };
+
+            for(uint32_t i=0; i < 3; i++)
+            {
+                normals[i] = encode(data.edgesNormal[i]);
+                normals[3 + i] = encode(data.verticesNormal[i]);
+            }
+        }
+
+        inline glm::vec3 getSy() const { return glm::cross(sz, sx); }
+        inline glm::vec2 getB() const { return glm::normalize(v3 - glm::vec2(v2, 0.0f)); }
+        inline glm::vec2 getC() const { return glm::normalize(-v3); }
+
+        /**
+         * @return The triangle with all its properties decoded
+         **/
+        TriangleData toTriangleData() const
+        {
+            TriangleData data;
+            data.origin = origin;
+            data.transform = glm::transpose(glm::mat3x3(sx, getSy(), sz));
+            data.b = getB();
+            data.c = getC();
+            data.v2 = v2;
+            data.v3 = v3;
+            for(uint32_t i=0; i < 3; i++)
+            {
+                data.edgesNormal[i] = decodeOctahedralNormal(normals[i]);
+                data.verticesNormal[i] = decodeOctahedralNormal(normals[3 + i]);
+            }
+            return data;
+        }
+
+        template<class Archive>
+        void serialize(Archive & archive)
+        {
+            archive(origin, sx, sz, v2, v3, normals);
+        }
+
+        glm::vec3 origin;
+
+        // Rows of the triangle space transform
+        glm::vec3 sx;
+        glm::vec3 sz;
+
+        // Vertices position in triangle space
+        float v2;
+        glm::vec2 v3;
+
+        // Edges normals followed by the vertices normals, in triangle space
+        std::array<uint32_t, 6> normals;
+    };
 
+    std::vector<TriangleData> calculateMeshTriangleData(const Mesh& mesh);
+
+    // Squared distance to a triangle from a point already transformed to the triangle space
+    inline float getSqDistProjPointAndTriangle(glm::vec3 projPoint, float v2, glm::vec2 v3, glm::vec2 b, glm::vec2 c)
+    {
         const float de1 = -projPoint.y;
-        const float de2 = (projPoint.x - data.v2) * data.b.y - projPoint.y * data.b.x;
-        const float de3 = projPoint.x * data.c.y - projPoint.y * data.c.x;
+        const float de2 = (projPoint.x - v2) * b.y - projPoint.y * b.x;
+        const float de3 = projPoint.x * c.y - projPoint.y * c.x;
 
         if(de1 >= 0)
         {
@@ -87,9 +185,9 @@ namespace TriangleUtils
             {
                 return glm::dot(projPoint, projPoint);
             }
-            else if(projPoint.x >= data.v2) // Its near v2
+            else if(projPoint.x >= v2) // Its near v2
             {
-                const glm::vec3 p = projPoint - glm::vec3(data.v2, 0.0, 0.0);
+                const glm::vec3 p = projPoint - glm::vec3(v2, 0.0, 0.0);
                 return glm::dot(p, p);
             }
             else // Its near edge 1
@@ -99,14 +197,14 @@ namespace TriangleUtils
         }
         else if(de2 >= 0)
         {
-            if((projPoint.x - data.v2) * data.b.x + projPoint.y * data.b.y <= 0) // Its near v2
+            if((projPoint.x - v2) * b.x + projPoint.y * b.y <= 0) // Its near v2
             {
-                const glm::vec3 p = projPoint - glm::vec3(data.v2, 0.0, 0.0);
+                const glm::vec3 p = projPoint - glm::vec3(v2, 0.0, 0.0);
                 return glm::dot(p, p);
             }
-            else if((projPoint.x - data.v3.x) * data.b.x + (projPoint.y - data.v3.y) * data.b.y >= 0) // Its near v3
+            else if((projPoint.x - v3.x) * b.x + (projPoint.y - v3.y) * b.y >= 0) // Its near v3
             {
-                const glm::vec3 p = projPoint - glm::vec3(data.v3.x, data.v3.y, 0.0);
+                const glm::vec3 p = projPoint - glm::vec3(v3.x, v3.y, 0.0);
                 return glm::dot(p, p);
             }
             else // Its near edge 2
@@ -116,13 +214,13 @@ namespace TriangleUtils
         }
         else if(de3 >= 0)
         {
-            if(projPoint.x * data.c.x + projPoint.y * data.c.y >= 0) // Its near v1
+            if(projPoint.x * c.x + projPoint.y * c.y >= 0) // Its near v1
             {
                 return glm::dot(projPoint, projPoint);
             }
-            else if((projPoint.x - data.v3.x) * data.c.x + (projPoint.y - data.v3.y) * data.c.y <= 0) // Its near v3
+            else if((projPoint.x - v3.x) * c.x + (projPoint.y - v3.y) * c.y <= 0) // Its near v3
             {
-                const glm::vec3 p = projPoint - glm::vec3(data.v3.x, data.v3.y, 0.0);
+                const glm::vec3 p = projPoint - glm::vec3(v3.x, v3.y, 0.0);
                 return glm::dot(p, p);
             }
             else // Its near edge 3
@@ -134,6 +232,11 @@ namespace TriangleUtils
         return projPoint.z * projPoint.z;
     }
 
+    inline float getSqDistPointAndTriangle(glm::vec3 point, const TriangleData& data)
+    {
+        return getSqDistProjPointAndTriangle(data.transform * (point - data.origin), data.v2, data.v3, data.b, data.c);
+    }
+
     inline float getSignedDistPointAndTriangle(glm::vec3 point, const TriangleData& data)
     {
         glm::vec3 projPoint = data.transform * (point - data.origin);
@@ -464,6 +567,24 @@ namespace TriangleUtils
         return projPoint.z;
     }
     
+    inline float getSqDistPointAndTriangle(glm::vec3 point, const CompactTriangleData& data)
+    {
+        const glm::vec3 p = point - data.origin;
+        return getSqDistProjPointAndTriangle(glm::vec3(glm::dot(data.sx, p), glm::dot(data.getSy(), p), glm::dot(data.sz, p)),
+                                             data.v2, data.v3, data.getB(), data.getC());
+    }
+
+    // The sign is only computed for the nearest triangle, so the triangle is fully decoded
+    inline float getSignedDistPointAndTriangle(glm::vec3 point, const CompactTriangleData& data)
+    {
+        return getSignedDistPointAndTriangle(point, data.toTriangleData());
+    }
+
+    inline float getSignedDistPointAndTriangle(glm::vec3 point, const CompactTriangleData& data, glm::vec3& outNormal)
+    {
+        return getSignedDistPointAndTriangle(point, data.toTriangleData(), outNormal);
+    }
+    
     inline float dot2(glm::vec3 v)
     {
         return glm::dot(v, v);
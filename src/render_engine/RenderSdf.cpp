@@ -25,12 +25,35 @@ void RenderSdf::restart()
     glDeleteBuffers(1, &mOctreeSSBO);
     glDeleteProgram(mRenderProgramId);
     glDeleteTextures(1, &mRenderTexture);
+    mOctreeSSBO = 0;
+    mRenderProgramId = 0;
+    mRenderTexture = 0;
 
     start();
 }
 
 void RenderSdf::start()
 {
+    // The shader reads the nodes and the float leaves of TOctreeSdf, the other octrees store other leaves behind the same interface
+    const SdfFunction::SdfFormat format = mInputOctree->getFormat();
+    if(format == IOctreeSdf::MIXED_OCTREE)
+    {
+        // The order of each leaf is in the mark bit of its node, the shader would read it as a child index
+        SPDLOG_ERROR("The shaders do not support the mixed octree, use a trilinear or tricubic octree");
+        return;
+    }
+    else if(format != IOctreeSdf::TRILINEAR_OCTREE && format != IOctreeSdf::TRICUBIC_OCTREE)
+    {
+        SPDLOG_ERROR("The shaders only support the trilinear and tricubic octrees");
+        return;
+    }
+
+    if(mInputOctree->hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The shaders do not support octrees with segmented indices");
+        return;
+    }
+
     auto checkForOpenGLErrors = []() -> GLenum
     {
         GLenum errorCode;
@@ -76,11 +99,11 @@ void RenderSdf::start()
         // Add headers
         std::string computeShader;
         computeShader.append("#version 460 core\n\n");
-        if(mInputOctree->getFormat() == IOctreeSdf::TRILINEAR_OCTREE)
+        if(format == IOctreeSdf::TRILINEAR_OCTREE)
         {
             computeShader.append("#define USE_TRILINEAR_INTERPOLATION\n");
         }
-        else if(mInputOctree->getFormat() == IOctreeSdf::TRICUBIC_OCTREE)
+        else if(format == IOctreeSdf::TRICUBIC_OCTREE)
         {
             computeShader.append("#define USE_TRICUBIC_INTERPOLATION\n");
         }
@@ -221,6 +244,9 @@ void RenderSdf::start()
 
 void RenderSdf::draw(Camera* camera)
 {
+    // Nothing is drawn if the octree could not be uploaded
+    if(mOctreeSSBO == 0) return;
+
     glm::ivec2 currentScreenSize = Window::getCurrentWindow().getWindowSize();
 
     if( currentScreenSize.x != mRenderTextureSize.x ||
@@ -57,10 +57,10 @@ private:
     bool mFirstLoad = true;
     RenderMesh mRenderMesh;
     ScreenPlaneShader screenPlaneShader;
-    unsigned int mRenderProgramId;
-    unsigned int mRenderTexture;
+    unsigned int mRenderProgramId = 0;
+    unsigned int mRenderTexture = 0;
     glm::ivec2 mRenderTextureSize;
-    unsigned int mOctreeSSBO;
+    unsigned int mOctreeSSBO = 0;
     unsigned int mOctreeTricubicSSBO;
 
     unsigned int mPixelToViewLocation;
@@ -12,8 +12,8 @@
 class GICopyRadianceShader 
 {
 public:
-    GICopyRadianceShader(std::shared_ptr<SceneOctree> octree, unsigned int sceneOctreeSSBO) : 
-        mSceneOctree(octree), mSceneOctreeSSBO(sceneOctreeSSBO)
+    GICopyRadianceShader(std::shared_ptr<SceneOctree> octree, unsigned int sceneLeafRadianceSSBO) : 
+        mSceneOctree(octree), mSceneLeafRadianceSSBO(sceneLeafRadianceSSBO)
     {
         // Compile compute shader
         {
@@ -50,23 +50,18 @@ public:
             glDeleteShader(compute);
         }
 
-        mLeafIndicesSize = octree->getLeafIndices().size();
-
-        glGenBuffers(1, &mLeafIndicesSSBO);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mLeafIndicesSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, mLeafIndicesSize * sizeof(uint32_t), octree->getLeafIndices().data(), GL_STATIC_DRAW);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, mLeafIndicesSSBO);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        // The radiance cache is indexed by leaf, so each invocation updates one leaf
+        mNumLeaves = octree->getNumLeaves();
 
         constexpr int LOCAL_SIZE_X = 64;
 
-        mNumGroupsX = glm::ceil(float(mLeafIndicesSize) / float(LOCAL_SIZE_X));
+        mNumGroupsX = glm::ceil(float(mNumLeaves) / float(LOCAL_SIZE_X));
 
-        std::cout << "Num work groups x: " << mNumGroupsX << " for local size: " << LOCAL_SIZE_X << " and size(): " << mLeafIndicesSize << "\n";
+        std::cout << "Num work groups x: " << mNumGroupsX << " for local size: " << LOCAL_SIZE_X << " and size(): " << mNumLeaves << "\n";
 
         mResetAccumulationLocation = glGetUniformLocation(mRenderProgramId, "reset");
         mInvalidateLocation = glGetUniformLocation(mRenderProgramId, "invalidate");
-        mLeafIndicesSizeLocation = glGetUniformLocation(mRenderProgramId, "leafIndicesSize");
+        mNumLeavesLocation = glGetUniformLocation(mRenderProgramId, "numLeaves");
     }
 
     ~GICopyRadianceShader()
@@ -88,12 +83,11 @@ public:
     {
         glUseProgram(mRenderProgramId);
 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneOctreeSSBO);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mLeafIndicesSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneLeafRadianceSSBO);
 
         glUniform1i(mResetAccumulationLocation, mResetAccumulation);
         glUniform1i(mInvalidateLocation, mInvalidate);
-        glUniform1i(mLeafIndicesSizeLocation, mLeafIndicesSize);
+        glUniform1i(mNumLeavesLocation, mNumLeaves);
 
         glDispatchCompute(mNumGroupsX, 1, 1);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
@@ -103,8 +97,7 @@ private:
     unsigned int mRenderProgramId;
 
     std::shared_ptr<SceneOctree> mSceneOctree;
-    unsigned int mSceneOctreeSSBO;
-    unsigned int mLeafIndicesSSBO;
+    unsigned int mSceneLeafRadianceSSBO;
 
     unsigned int mNumGroupsX;
 
@@ -114,6 +107,6 @@ private:
     bool mInvalidate;
     unsigned int mInvalidateLocation;
 
-    int mLeafIndicesSize;
-    unsigned int mLeafIndicesSizeLocation;
+    int mNumLeaves;
+    unsigned int mNumLeavesLocation;
 };
\ No newline at end of file
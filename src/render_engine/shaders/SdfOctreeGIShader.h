@@ -81,6 +81,19 @@ public:
         mSceneOctreeSizeLocation = glGetUniformLocation(mRenderProgramId, "sceneOctreeSize");
         mSceneOctreeSize = sceneOctree.getRoot()->halfSize * 2.0f;
 
+        // The header only defines the trilinear and tricubic interpolations, the leaves of the other octrees have other layouts
+        if(octreeSdf.getFormat() != sdflib::IOctreeSdf::TRILINEAR_OCTREE && octreeSdf.getFormat() != sdflib::IOctreeSdf::TRICUBIC_OCTREE)
+        {
+            SPDLOG_ERROR("The shaders only support the trilinear and tricubic octrees");
+            return;
+        }
+
+        if(octreeSdf.hasSegmentedIndices())
+        {
+            SPDLOG_ERROR("The shaders do not support octrees with segmented indices");
+            return;
+        }
+
         // Set octree data
         glGenBuffers(1, &mOctreeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, mOctreeSSBO);
@@ -93,6 +106,20 @@ public:
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneOctreeSSBO);
         glBufferData(GL_SHADER_STORAGE_BUFFER, sceneOctree.getShaderOctreeData().size() * sizeof(ShaderOctreeNode), sceneOctree.getShaderOctreeData().data(), GL_STATIC_DRAW);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, mSceneOctreeSSBO);
+
+        glGenBuffers(1, &mSceneLeafAttributesSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneLeafAttributesSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sceneOctree.getLeafAttributes().size() * sizeof(ShaderLeafAttributes), sceneOctree.getLeafAttributes().data(), GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, mSceneLeafAttributesSSBO);
+
+        {
+            // The radiance cache starts empty
+            std::vector<ShaderLeafRadiance> leafRadiance(sceneOctree.getNumLeaves());
+            glGenBuffers(1, &mSceneLeafRadianceSSBO);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneLeafRadianceSSBO);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, leafRadiance.size() * sizeof(ShaderLeafRadiance), leafRadiance.data(), GL_DYNAMIC_COPY);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, mSceneLeafRadianceSSBO);
+        }
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
 
@@ -100,6 +127,8 @@ public:
     {
         glDeleteBuffers(1, &mOctreeSSBO);
         glDeleteBuffers(1, &mSceneOctreeSSBO);
+        glDeleteBuffers(1, &mSceneLeafAttributesSSBO);
+        glDeleteBuffers(1, &mSceneLeafRadianceSSBO);
     }
 
     //Global Illumination Settings
@@ -208,6 +237,8 @@ public:
     {
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, mOctreeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneOctreeSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneLeafAttributesSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSceneLeafRadianceSSBO);
 
         glUniformMatrix4fv(worldToStartGridMatrixLocation, 1, GL_FALSE, glm::value_ptr(worldToStartGridMatrix));
         glUniformMatrix3fv(normalWorldToStartGridMatrixLocation, 1, GL_FALSE, glm::value_ptr(normalWorldToStartGridMatrix));
@@ -265,10 +296,12 @@ public:
 
     }
 
-    unsigned int mSceneOctreeSSBO;
+    unsigned int mSceneOctreeSSBO = 0;
+    unsigned int mSceneLeafAttributesSSBO = 0;
+    unsigned int mSceneLeafRadianceSSBO = 0;
 
 private:
-    unsigned int mOctreeSSBO;
+    unsigned int mOctreeSSBO = 0;
 
     glm::mat4x4 worldToStartGridMatrix;
     unsigned int worldToStartGridMatrixLocation;
@@ -409,7 +442,7 @@ private:
             return "#define USE_TRICUBIC_INTERPOLATION\n\n";
             break;
         default:
-            assert(false);
+            // The constructor refuses the other formats
             break;
         }
         return "";
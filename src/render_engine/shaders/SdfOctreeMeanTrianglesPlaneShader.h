@@ -27,6 +27,12 @@ public:
         startGridSizeLocation = glGetUniformLocation(getProgramId(), "startGridSize");
         startGridSize = glm::vec3(octreeSdf.getStartGridSize());
 
+        if(octreeSdf.hasCompactNodes() || octreeSdf.hasDeduplicatedTriangles() || octreeSdf.hasSegmentedIndices())
+        {
+            SPDLOG_ERROR("The shader only supports exact octrees with wide nodes, global indices and without shared triangle sets");
+            return;
+        }
+
         // Set octree data
         glGenBuffers(1, &mOctreeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, mOctreeSSBO);
@@ -57,7 +63,7 @@ public:
         glUniform3f(planeNormalLocation, planeNormal.x, planeNormal.y, planeNormal.z);
     }
 private:
-    unsigned int mOctreeSSBO;
+    unsigned int mOctreeSSBO = 0;
     glm::mat4x4 worldToStartGridMatrix;
     unsigned int worldToStartGridMatrixLocation;
     float minNumTriangles;
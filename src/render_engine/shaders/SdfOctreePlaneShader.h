@@ -31,6 +31,19 @@ public:
         printIsolinesLocation = glGetUniformLocation(getProgramId(), "printIsolines");
         printIsolines = true;
 
+        // The header only defines the trilinear and tricubic interpolations, the leaves of the other octrees have other layouts
+        if(octreeSdf.getFormat() != sdflib::IOctreeSdf::TRILINEAR_OCTREE && octreeSdf.getFormat() != sdflib::IOctreeSdf::TRICUBIC_OCTREE)
+        {
+            SPDLOG_ERROR("The shaders only support the trilinear and tricubic octrees");
+            return;
+        }
+
+        if(octreeSdf.hasSegmentedIndices())
+        {
+            SPDLOG_ERROR("The shaders do not support octrees with segmented indices");
+            return;
+        }
+
         // Set octree data
         glGenBuffers(1, &mOctreeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, mOctreeSSBO);
@@ -58,7 +71,7 @@ public:
         glUniform1i(printIsolinesLocation, printIsolines);
     }
 private:
-    unsigned int mOctreeSSBO;
+    unsigned int mOctreeSSBO = 0;
     glm::mat4x4 worldToStartGridMatrix;
     unsigned int worldToStartGridMatrixLocation;
     float octreeValueRange;
@@ -83,7 +96,7 @@ private:
             return "#define USE_TRICUBIC_INTERPOLATION\n\n";
             break;
         default:
-            assert(false);
+            // The constructor refuses the other formats
             break;
         }
         return "";
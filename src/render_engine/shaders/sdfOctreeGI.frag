@@ -443,19 +443,30 @@ struct Material
     int idx;
 };
 
-struct OctreeNode 
+// Scene octree nodes
+// - bit 31,30:   node type
+// - bit 29-0:    children idx for the grey nodes, leaf idx for the black nodes
+layout(std430, binding = 4) buffer SceneOctree 
 {
-    // 32 bits
-    // - bit 31,30:   node type
-    // - bit 29-0:    children idx
-    uint data;
-    uint depth;
+    uint sceneNodes[];
+};
 
+// Attributes of the black leaves
+struct LeafAttributes
+{
     vec4 color;
-    // roughness, metallic, -, -
+    // roughness, metallic, depth, -
     vec4 material;
+};
+
+layout(std430, binding = 5) buffer SceneOctreeLeafAttributes 
+{
+    LeafAttributes sceneAttributes[];
+};
 
-    // radiance caching
+// Radiance caching of the black leaves
+struct LeafRadiance
+{
     vec4 readRadiance[6];
     vec4 writeRadiance[6];
 
@@ -463,9 +474,9 @@ struct OctreeNode
     vec4 invalidWriteRadiance[6];
 };
 
-layout(std140, binding = 4) buffer SceneOctree 
+layout(std430, binding = 6) buffer SceneOctreeLeafRadiance 
 {
-    OctreeNode sceneData[];
+    LeafRadiance sceneRadiance[];
 };
 
 uniform float sceneOctreeSize;
@@ -513,24 +524,22 @@ Material getSceneOctreeColor(vec3 gridPoint)
                arrayPos.z * uint(sceneOctreeStartGridSize.x) +
                arrayPos.x;
 
-    OctreeNode currentNode = sceneData[idx];
+    uint currentNode = sceneNodes[idx];
 
-    int depth = 0;
-    uint prevIdx = idx;
-    while(!nodeIsLeaf(currentNode.data))
+    while(!nodeIsLeaf(currentNode))
     {
         uint childIdx = (roundFloat(fracPart.y) << 2) + 
                         (roundFloat(fracPart.z) << 1) + 
                         roundFloat(fracPart.x);
 
 
-        idx = (currentNode.data & OCTREENODE_CHILDREN_MASK) + childIdx;
+        idx = (currentNode & OCTREENODE_CHILDREN_MASK) + childIdx;
 
-        currentNode = sceneData[idx];
+        currentNode = sceneNodes[idx];
         fracPart = fract(2.0 * fracPart);
     }
 
-    if (nodeIsWhite(currentNode.data))
+    if (nodeIsWhite(currentNode))
     {
         Material mat;
         mat.albedo = vec3(0.0, 0.0, 0.0);
@@ -538,11 +547,13 @@ Material getSceneOctreeColor(vec3 gridPoint)
         return mat;
     }
 
+    uint leafIdx = currentNode & OCTREENODE_CHILDREN_MASK;
+
     Material mat;
-    mat.albedo = currentNode.color.rgb;
-    mat.roughness = currentNode.material.x;
-    mat.metallic = currentNode.material.y;
-    mat.idx = int(idx);
+    mat.albedo = sceneAttributes[leafIdx].color.rgb;
+    mat.roughness = sceneAttributes[leafIdx].material.x;
+    mat.metallic = sceneAttributes[leafIdx].material.y;
+    mat.idx = int(leafIdx);
 
     return mat;
 }
@@ -564,7 +575,7 @@ vec4 sampleCurrentRadiance(Material mat, vec3 gridPos, vec3 N)
 {
     if (mat.idx == -1) return vec4(0.0);
 
-    OctreeNode node = sceneData[mat.idx];
+    LeafRadiance node = sceneRadiance[mat.idx];
 
     uint orientationIdx = getRadianceClosestOrientation(N);
     if (!neighborSampling) 
@@ -578,7 +589,7 @@ vec4 sampleCurrentRadiance(Material mat, vec3 gridPos, vec3 N)
         return node.readRadiance[orientationIdx];
     }
 
-    float size = sceneOctreeSize / pow(2, node.depth);
+    float size = sceneOctreeSize / pow(2, sceneAttributes[mat.idx].material.z);
     vec3 center = (fragInverseWorldToStartGridMatrix * vec4(gridPos, 1.0)).xyz;
 
     bool isNodeInvalid = false;
@@ -607,17 +618,17 @@ vec4 sampleCurrentRadiance(Material mat, vec3 gridPos, vec3 N)
                 if (neighborIdx == -1) continue;
 
                 // Cache is invalid
-                if (isNodeInvalid && sceneData[neighborIdx].invalidReadRadiance[orientationIdx].w > MIN_SAMPLES_RADIANCE)
+                if (isNodeInvalid && sceneRadiance[neighborIdx].invalidReadRadiance[orientationIdx].w > MIN_SAMPLES_RADIANCE)
                 {
-                    radiance += sceneData[neighborIdx].invalidReadRadiance[orientationIdx].rgb;
+                    radiance += sceneRadiance[neighborIdx].invalidReadRadiance[orientationIdx].rgb;
                     sumWeights += 1.0;
                     continue;
                 }
 
-                if (sceneData[neighborIdx].readRadiance[orientationIdx].w < MIN_SAMPLES_RADIANCE) continue;
-                if (sceneData[neighborIdx].invalidReadRadiance[orientationIdx].w > 0.5) continue;
+                if (sceneRadiance[neighborIdx].readRadiance[orientationIdx].w < MIN_SAMPLES_RADIANCE) continue;
+                if (sceneRadiance[neighborIdx].invalidReadRadiance[orientationIdx].w > 0.5) continue;
 
-                radiance += sceneData[neighborIdx].readRadiance[orientationIdx].rgb;
+                radiance += sceneRadiance[neighborIdx].readRadiance[orientationIdx].rgb;
                 sumWeights += 1.0;
             }
         }
@@ -869,7 +880,7 @@ vec3 name(vec3 pos, vec3 N, vec3 V, int depth, uint seed)
     vec4 currentRadiance = sampleCurrentRadiance(mat, pos, N);                     \
                                                                                    \
     uint orientationIdx = getRadianceClosestOrientation(N);                        \
-    vec4 invalidData = sceneData[mat.idx].invalidReadRadiance[orientationIdx];     \
+    vec4 invalidData = sceneRadiance[mat.idx].invalidReadRadiance[orientationIdx]; \
     if (currentRadiance.w >= NUM_SAMPLES_CONVERGENCE && invalidData.w <= 0.5)      \
     {                                                                              \
         indirectLight = currentRadiance.rgb;                                       \
@@ -913,14 +924,14 @@ vec3 name(vec3 pos, vec3 N, vec3 V, int depth, uint seed)
                                                                                    \
     if (currentRadiance.w == 0.0 && depth == maxDepth)                             \
     {                                                                              \
-        sceneData[mat.idx].writeRadiance[orientationIdx] =                         \
+        sceneRadiance[mat.idx].writeRadiance[orientationIdx] =                     \
             vec4(indirectLight, float(numSamples));                                \
     }                                                                              \
     else if (invalidData.w == 1.0 && depth == maxDepth)                            \
     {                                                                              \
-        sceneData[mat.idx].invalidWriteRadiance[orientationIdx] =                  \
+        sceneRadiance[mat.idx].invalidWriteRadiance[orientationIdx] =              \
             vec4(indirectLight, float(numSamples));                                \
-        indirectLight = sceneData[mat.idx].readRadiance[orientationIdx].rgb;       \
+        indirectLight = sceneRadiance[mat.idx].readRadiance[orientationIdx].rgb;   \
     }                                                                              \
     else if (invalidData.w > 0.5 && depth == maxDepth)                             \
     {                                                                              \
@@ -929,10 +940,10 @@ vec3 name(vec3 pos, vec3 N, vec3 V, int depth, uint seed)
             = (numSamples / totalSamples) * indirectLight                          \
             + (invalidData.w / totalSamples) * currentRadiance.rgb;                \
                                                                                    \
-        sceneData[mat.idx].invalidWriteRadiance[orientationIdx]                    \
+        sceneRadiance[mat.idx].invalidWriteRadiance[orientationIdx]                \
             = vec4(newRadiance, totalSamples);                                     \
                                                                                    \
-        vec4 nonInvalidData = sceneData[mat.idx].readRadiance[orientationIdx];     \
+        vec4 nonInvalidData = sceneRadiance[mat.idx].readRadiance[orientationIdx]; \
         float perc = totalSamples / nonInvalidData.w;                              \
         indirectLight = mix(nonInvalidData.rgb, newRadiance, perc);                \
     }                                                                              \
@@ -943,7 +954,7 @@ vec3 name(vec3 pos, vec3 N, vec3 V, int depth, uint seed)
             (numSamples / totalSamples) * indirectLight                            \
             + (currentRadiance.w / totalSamples) * currentRadiance.rgb;            \
                                                                                    \
-        sceneData[mat.idx].writeRadiance[orientationIdx]                           \
+        sceneRadiance[mat.idx].writeRadiance[orientationIdx]                       \
             = vec4(newRadiance, min(totalSamples, 300));                           \
                                                                                    \
         indirectLight = newRadiance;                                               \
@@ -0,0 +1,88 @@
+#ifndef BLOCK_GRID_UTILS_H
+#define BLOCK_GRID_UTILS_H
+
+#include <array>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "SdfLib/ExactOctreeSdf.h"
+#include "SdfLib/InterpolationMethods.h"
+
+// Functions shared by the grids that group their samples in blocks (SparseUniformGridSdf and BrickMapSdf)
+namespace sdflib
+{
+namespace internal
+{
+    /**
+     * @brief Builds the exact octree used to evaluate the samples of the blocks, its leaves have around the size of a block.
+     * @param blockLength The size of a block.
+     * @param maxDepth The maximum depth of the octree.
+     * @return The octree or nullptr if it could not be built
+     **/
+    inline std::unique_ptr<ExactOctreeSdf> buildBlocksSampler(const Mesh& mesh, BoundingBox box, float blockLength,
+                                                               uint32_t maxDepth, uint32_t numThreads)
+    {
+        BoundingBox octreeBox = box;
+        octreeBox.addMargin(blockLength);
+        const glm::vec3 octreeBoxSize = octreeBox.getSize();
+        const float maxSize = glm::max(glm::max(octreeBoxSize.x, octreeBoxSize.y), octreeBoxSize.z);
+        const uint32_t octreeDepth = glm::clamp(static_cast<uint32_t>(glm::ceil(glm::log2(maxSize / blockLength))), 2u, maxDepth);
+
+        std::unique_ptr<ExactOctreeSdf> exactSdf(new ExactOctreeSdf(mesh, octreeBox, octreeDepth, 1, 32, numThreads));
+        if(!exactSdf->isValid()) return nullptr;
+        return exactSdf;
+    }
+
+    /**
+     * @return If all the distances of a cubic region are farther than the band from the surface
+     **/
+    inline bool isRegionOutsideBand(float centerDist, float regionLength, float bandWidth)
+    {
+        // The field is 1-Lipschitz, so the center distance bounds the distances inside the region
+        return glm::abs(centerDist) - 0.5f * glm::sqrt(3.0f) * regionLength > bandWidth;
+    }
+
+    /**
+     * @brief Evaluates a grid at any point. Outside the box, the distance is approximated from the nearest point of the box.
+     * @param getCellValues Function returning the trilinear values and the fractional part of the cell containing a sample inside the box.
+     **/
+    template<typename GetCellValues>
+    inline float getGridDistance(glm::vec3 sample, const BoundingBox& box, GetCellValues&& getCellValues)
+    {
+        const glm::vec3 insideSample = glm::clamp(sample, box.min, box.max);
+
+        std::array<float, 8> values;
+        glm::vec3 fracPart;
+        getCellValues(insideSample, values, fracPart);
+
+        return TriLinearInterpolation::interpolateValue(values, fracPart) + glm::length(sample - insideSample);
+    }
+
+    template<typename GetCellValues>
+    inline float getGridDistance(glm::vec3 sample, glm::vec3& outGradient, const BoundingBox& box, GetCellValues&& getCellValues)
+    {
+        const glm::vec3 insideSample = glm::clamp(sample, box.min, box.max);
+
+        std::array<float, 8> values;
+        glm::vec3 fracPart;
+        getCellValues(insideSample, values, fracPart);
+
+        const float outsideDist = glm::length(sample - insideSample);
+        if(outsideDist > 0.0f)
+        {
+            outGradient = (sample - insideSample) / outsideDist;
+        }
+        else
+        {
+            // The gradient is zero in the clamped areas
+            const glm::vec3 gradient = TriLinearInterpolation::interpolateGradient(values, fracPart);
+            const float gradientLength = glm::length(gradient);
+            outGradient = (gradientLength > 0.0f) ? gradient / gradientLength : glm::vec3(0.0f);
+        }
+
+        return TriLinearInterpolation::interpolateValue(values, fracPart) + outsideDist;
+    }
+}
+}
+
+#endif
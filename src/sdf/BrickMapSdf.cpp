@@ -0,0 +1,204 @@
+#include "SdfLib/BrickMapSdf.h"
+#include "SdfLib/InterpolationMethods.h"
+#include "sdf/BlockGridUtils.h"
+
+#include <limits>
+
+#ifdef OPENMP_AVAILABLE
+#include <omp.h>
+#endif
+
+namespace sdflib
+{
+BrickMapSdf::BrickMapSdf(const Mesh& mesh, BoundingBox box, float cellSize, float narrowBand,
+                         float maxCoarseError, uint32_t numThreads)
+{
+    if(!(cellSize > 0.0f))
+    {
+        SPDLOG_ERROR("The cell size of the brick map must be positive");
+        return;
+    }
+
+    // The exact octree is used to evaluate the samples
+    std::unique_ptr<ExactOctreeSdf> exactSdf = internal::buildBlocksSampler(mesh, box, cellSize * static_cast<float>(BRICK_CELLS), 8u, numThreads);
+    if(exactSdf == nullptr)
+    {
+        SPDLOG_ERROR("The octree used to sample the bricks could not be built");
+        return;
+    }
+
+    initFromSdf(*exactSdf, box, cellSize, narrowBand, maxCoarseError, numThreads);
+}
+
+BrickMapSdf::BrickMapSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float narrowBand,
+                         float maxCoarseError, uint32_t numThreads)
+{
+    initFromSdf(sdf, box, cellSize, narrowBand, maxCoarseError, numThreads);
+}
+
+void BrickMapSdf::initFromSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float narrowBand,
+                              float maxCoarseError, uint32_t numThreads)
+{
+    if(!(cellSize > 0.0f))
+    {
+        SPDLOG_ERROR("The cell size of the brick map must be positive");
+        return;
+    }
+
+    mCellSize = cellSize;
+    mBrickSize = cellSize * static_cast<float>(BRICK_CELLS);
+    mNarrowBand = narrowBand;
+
+    // The coarse grid has one more value per axis than bricks and both are indexed with ints
+    const glm::dvec3 numBricks3 = glm::max(glm::ceil(glm::dvec3(box.getSize()) / static_cast<double>(mBrickSize)), glm::dvec3(1.0));
+    const double numCoarseValues3 = (numBricks3.x + 1.0) * (numBricks3.y + 1.0) * (numBricks3.z + 1.0);
+    if(numCoarseValues3 > static_cast<double>(std::numeric_limits<int>::max()))
+    {
+        SPDLOG_ERROR("The brick map is too big to be indexed");
+        return;
+    }
+
+    mNumBricks = glm::ivec3(numBricks3);
+    mBox.min = box.min;
+    mBox.max = box.min + mBrickSize * glm::vec3(mNumBricks);
+    SPDLOG_INFO("Brick map size: {}, {}, {} bricks", mNumBricks.x, mNumBricks.y, mNumBricks.z);
+
+#ifdef OPENMP_AVAILABLE
+    omp_set_dynamic(0);
+    omp_set_num_threads(glm::max(numThreads, 1u));
+#endif
+
+    // Coarse grid at the bricks corners
+    const glm::ivec3 coarseSize = mNumBricks + glm::ivec3(1);
+    const int numCoarseValues = coarseSize.x * coarseSize.y * coarseSize.z;
+    mCoarseGrid.resize(numCoarseValues);
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(int i=0; i < numCoarseValues; i++)
+    {
+        const glm::ivec3 pos(i % coarseSize.x, (i / coarseSize.x) % coarseSize.y, i / (coarseSize.x * coarseSize.y));
+        mCoarseGrid[i] = sdf.getDistance(mBox.min + mBrickSize * glm::vec3(pos));
+    }
+
+    auto getBrickPos = [&](int brickIndex)
+    {
+        return glm::ivec3(brickIndex % mNumBricks.x, (brickIndex / mNumBricks.x) % mNumBricks.y, brickIndex / (mNumBricks.x * mNumBricks.y));
+    };
+
+    auto sampleBrick = [&](glm::ivec3 brickPos, float* outSamples)
+    {
+        const glm::vec3 brickMin = mBox.min + mBrickSize * glm::vec3(brickPos);
+        for(uint32_t k=0; k < BRICK_SIZE; k++)
+        {
+            for(uint32_t j=0; j < BRICK_SIZE; j++)
+            {
+                for(uint32_t i=0; i < BRICK_SIZE; i++)
+                {
+                    outSamples[k * BRICK_SIZE * BRICK_SIZE + j * BRICK_SIZE + i] = sdf.getDistance(brickMin + mCellSize * glm::vec3(i, j, k));
+                }
+            }
+        }
+    };
+
+    // Decide which bricks have to be allocated
+    const int numBricks = mNumBricks.x * mNumBricks.y * mNumBricks.z;
+    std::vector<uint8_t> allocateBrick(numBricks, 0);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int b=0; b < numBricks; b++)
+    {
+        const glm::ivec3 brickPos = getBrickPos(b);
+
+        const float centerDist = sdf.getDistance(mBox.min + mBrickSize * (glm::vec3(brickPos) + 0.5f));
+        if(!internal::isRegionOutsideBand(centerDist, mBrickSize, narrowBand))
+        {
+            allocateBrick[b] = 1;
+            continue;
+        }
+
+        if(maxCoarseError < INFINITY)
+        {
+            std::array<float, 8> corners;
+            for(uint32_t c=0; c < 8; c++)
+            {
+                corners[c] = mCoarseGrid[getCoarseIndex(brickPos + glm::ivec3(c & 1, (c >> 1) & 1, c >> 2))];
+            }
+
+            std::array<float, BRICK_NUM_SAMPLES> samples;
+            sampleBrick(brickPos, samples.data());
+            for(uint32_t s=0; s < BRICK_NUM_SAMPLES && !allocateBrick[b]; s++)
+            {
+                const glm::vec3 fracPart = glm::vec3(s % BRICK_SIZE, (s / BRICK_SIZE) % BRICK_SIZE, s / (BRICK_SIZE * BRICK_SIZE)) /
+                                           static_cast<float>(BRICK_CELLS);
+                if(glm::abs(TriLinearInterpolation::interpolateValue(corners, fracPart) - samples[s]) > maxCoarseError)
+                {
+                    allocateBrick[b] = 1;
+                }
+            }
+        }
+    }
+
+    // Assign the bricks positions
+    mBrickIndex.resize(numBricks);
+    uint32_t numAllocatedBricks = 0;
+    for(int b=0; b < numBricks; b++)
+    {
+        mBrickIndex[b] = (allocateBrick[b]) ? numAllocatedBricks++ : EMPTY_BRICK;
+    }
+
+    mBricks.resize(static_cast<size_t>(numAllocatedBricks) * BRICK_NUM_SAMPLES);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int b=0; b < numBricks; b++)
+    {
+        if(mBrickIndex[b] != EMPTY_BRICK)
+        {
+            sampleBrick(getBrickPos(b), &mBricks[static_cast<size_t>(mBrickIndex[b]) * BRICK_NUM_SAMPLES]);
+        }
+    }
+
+    SPDLOG_INFO("Allocated bricks: {} of {}", numAllocatedBricks, numBricks);
+}
+
+inline void BrickMapSdf::getCellValues(glm::vec3 sample, std::array<float, 8>& outValues, glm::vec3& outFracPart) const
+{
+    const glm::vec3 pos = (sample - mBox.min) / mBrickSize;
+    const glm::ivec3 brickPos = glm::clamp(glm::ivec3(glm::floor(pos)), glm::ivec3(0), mNumBricks - 1);
+    const uint32_t brickIndex = mBrickIndex[brickPos.z * mNumBricks.x * mNumBricks.y + brickPos.y * mNumBricks.x + brickPos.x];
+
+    if(brickIndex != EMPTY_BRICK)
+    {
+        const glm::vec3 cellPos = (pos - glm::vec3(brickPos)) * static_cast<float>(BRICK_CELLS);
+        const glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(cellPos)), glm::ivec3(0), glm::ivec3(BRICK_CELLS - 1));
+        outFracPart = cellPos - glm::vec3(cell);
+
+        const float* values = &mBricks[static_cast<size_t>(brickIndex) * BRICK_NUM_SAMPLES +
+                                       cell.z * BRICK_SIZE * BRICK_SIZE + cell.y * BRICK_SIZE + cell.x];
+        for(uint32_t i=0; i < 8; i++)
+        {
+            outValues[i] = values[(i >> 2) * BRICK_SIZE * BRICK_SIZE + ((i >> 1) & 1) * BRICK_SIZE + (i & 1)];
+        }
+    }
+    else
+    {
+        outFracPart = pos - glm::vec3(brickPos);
+        for(uint32_t i=0; i < 8; i++)
+        {
+            outValues[i] = mCoarseGrid[getCoarseIndex(brickPos + glm::ivec3(i & 1, (i >> 1) & 1, i >> 2))];
+        }
+    }
+}
+
+float BrickMapSdf::getDistance(glm::vec3 sample) const
+{
+    return internal::getGridDistance(sample, mBox, [&](glm::vec3 insideSample, std::array<float, 8>& values, glm::vec3& fracPart)
+    {
+        getCellValues(insideSample, values, fracPart);
+    });
+}
+
+float BrickMapSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    return internal::getGridDistance(sample, outGradient, mBox, [&](glm::vec3 insideSample, std::array<float, 8>& values, glm::vec3& fracPart)
+    {
+        getCellValues(insideSample, values, fracPart);
+    });
+}
+}
@@ -0,0 +1,193 @@
+#include "SdfLib/CachedSdf.h"
+
+#include <cassert>
+#include <functional>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+namespace sdflib
+{
+CachedSdf::CachedSdf(std::shared_ptr<SdfFunction> sdf, float quantum, uint32_t numEntries)
+    : mSdf(std::move(sdf)),
+      mQuantum(quantum),
+      mInvQuantum(1.0f / quantum)
+{
+    assert(quantum > 0.0f);
+
+    // The hits are extrapolated with the gradient, which is only accurate while the field is smooth inside a quantum
+    const float minCellSize = mSdf->getMinCellSize();
+    if(minCellSize > 0.0f && quantum > minCellSize)
+    {
+        SPDLOG_WARN("The cache quantum ({}) is larger than the smallest cell of the structure ({}), the cached distances will not be accurate",
+                    quantum, minCellSize);
+    }
+
+    // The quantized coordinates are centered in the structure area
+    mOrigin = mSdf->getSampleArea().getCenter() - quantum * static_cast<float>(1 << (BITS_PER_AXIS - 1));
+
+    // The product is computed in 64 bits, it overflows in 32 bits for more than 2^31 entries
+    uint64_t numSets = 1;
+    while(numSets * NUM_WAYS < numEntries && numSets < MAX_NUM_SETS) numSets <<= 1;
+    if(numSets * NUM_WAYS < numEntries)
+    {
+        SPDLOG_WARN("The cache cannot have {} entries, it is limited to {} entries", numEntries, numSets * NUM_WAYS);
+    }
+    mSetsMask = static_cast<uint32_t>(numSets - 1);
+    mSets = std::make_unique<Set[]>(numSets);
+}
+
+bool CachedSdf::getKey(glm::vec3 sample, uint64_t& outKey, glm::vec3& outSnappedSample) const
+{
+    const glm::vec3 cell = glm::floor((sample - mOrigin) * mInvQuantum + 0.5f);
+    // The last cell is not used to avoid generating the empty key.
+    // The comparisons are negated so the non-finite samples also bypass the cache before the integer cast
+    const float maxCell = static_cast<float>((1 << BITS_PER_AXIS) - 2);
+    if(!(cell.x >= 0.0f && cell.y >= 0.0f && cell.z >= 0.0f &&
+         cell.x <= maxCell && cell.y <= maxCell && cell.z <= maxCell))
+    {
+        return false;
+    }
+
+    outKey = static_cast<uint64_t>(cell.x) |
+             (static_cast<uint64_t>(cell.y) << BITS_PER_AXIS) |
+             (static_cast<uint64_t>(cell.z) << (2 * BITS_PER_AXIS));
+    outSnappedSample = mOrigin + cell * mQuantum;
+    return true;
+}
+
+bool CachedSdf::find(uint64_t key, float& outDistance, glm::vec3& outGradient) const
+{
+    const Set& set = mSets[(key * 0x9E3779B97F4A7C15ull >> 32) & mSetsMask];
+    for(const Entry& entry : set.ways)
+    {
+        const uint32_t seq = entry.sequence.load(std::memory_order_acquire);
+        if(seq & 1) continue;
+
+        if(entry.key.load(std::memory_order_relaxed) != key) continue;
+
+        const float distance = entry.distance.load(std::memory_order_relaxed);
+        const glm::vec3 gradient(entry.gradient[0].load(std::memory_order_relaxed),
+                                 entry.gradient[1].load(std::memory_order_relaxed),
+                                 entry.gradient[2].load(std::memory_order_relaxed));
+
+        // Check that the entry has not been written during the read
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(entry.sequence.load(std::memory_order_relaxed) != seq) continue;
+
+        outDistance = distance;
+        outGradient = gradient;
+        return true;
+    }
+
+    return false;
+}
+
+void CachedSdf::insert(uint64_t key, float distance, glm::vec3 gradient) const
+{
+    Set& set = mSets[(key * 0x9E3779B97F4A7C15ull >> 32) & mSetsMask];
+
+    // Use an empty way if there is one, otherwise pick a way from the key bits
+    Entry* entry = &set.ways[(key ^ (key >> 29)) % NUM_WAYS];
+    for(Entry& e : set.ways)
+    {
+        if(e.key.load(std::memory_order_relaxed) == EMPTY_KEY)
+        {
+            entry = &e;
+            break;
+        }
+    }
+
+    // If other thread is writing the entry, the result is not stored
+    uint32_t seq = entry->sequence.load(std::memory_order_relaxed);
+    if((seq & 1) || !entry->sequence.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+    {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry->key.store(key, std::memory_order_relaxed);
+    entry->distance.store(distance, std::memory_order_relaxed);
+    entry->gradient[0].store(gradient.x, std::memory_order_relaxed);
+    entry->gradient[1].store(gradient.y, std::memory_order_relaxed);
+    entry->gradient[2].store(gradient.z, std::memory_order_relaxed);
+
+    entry->sequence.store(seq + 2, std::memory_order_release);
+}
+
+CachedSdf::CounterSlot& CachedSdf::getCounterSlot() const
+{
+    thread_local const uint32_t slot = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()) % NUM_COUNTER_SLOTS);
+    return mCounters[slot];
+}
+
+float CachedSdf::getDistance(glm::vec3 sample) const
+{
+    glm::vec3 gradient;
+    return getDistance(sample, gradient);
+}
+
+float CachedSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    uint64_t key;
+    glm::vec3 snappedSample;
+    if(!getKey(sample, key, snappedSample))
+    {
+        return mSdf->getDistance(sample, outGradient);
+    }
+
+    // The entries store the distance at the snapped sample, the hits correct it to first order with the gradient
+    float distance;
+    if(find(key, distance, outGradient))
+    {
+        getCounterSlot().hits.fetch_add(1, std::memory_order_relaxed);
+        return distance + glm::dot(outGradient, sample - snappedSample);
+    }
+
+    // The misses are evaluated at the real sample, so they have the error of the structure
+    getCounterSlot().misses.fetch_add(1, std::memory_order_relaxed);
+    distance = mSdf->getDistance(sample, outGradient);
+    insert(key, distance + glm::dot(outGradient, snappedSample - sample), outGradient);
+    return distance;
+}
+
+void CachedSdf::clear()
+{
+    for(uint32_t s=0; s <= mSetsMask; s++)
+    {
+        for(Entry& entry : mSets[s].ways)
+        {
+            entry.key.store(EMPTY_KEY, std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t CachedSdf::getNumHits() const
+{
+    uint64_t hits = 0;
+    for(const CounterSlot& slot : mCounters) hits += slot.hits.load(std::memory_order_relaxed);
+    return hits;
+}
+
+uint64_t CachedSdf::getNumMisses() const
+{
+    uint64_t misses = 0;
+    for(const CounterSlot& slot : mCounters) misses += slot.misses.load(std::memory_order_relaxed);
+    return misses;
+}
+
+float CachedSdf::getHitRate() const
+{
+    const uint64_t hits = getNumHits();
+    const uint64_t total = hits + getNumMisses();
+    return (total > 0) ? static_cast<float>(hits) / static_cast<float>(total) : 0.0f;
+}
+
+void CachedSdf::resetHitRate()
+{
+    for(CounterSlot& slot : mCounters)
+    {
+        slot.hits.store(0, std::memory_order_relaxed);
+        slot.misses.store(0, std::memory_order_relaxed);
+    }
+}
+}
@@ -2,12 +2,18 @@
 #include "SdfLib/TrianglesInfluence.h"
 #include "SdfLib/InterpolationMethods.h"
 #include "sdf/ExactOctreeSdfDepthFirst.h"
+#include "SdfLib/utils/SharedBlocks.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <functional>
 
 namespace sdflib
 {
 ExactOctreeSdf::ExactOctreeSdf(const Mesh& mesh, BoundingBox box, uint32_t maxDepth,
                                uint32_t startDepth, uint32_t minTrianglesPerNode,
-                               uint32_t numThreads)
+                               uint32_t numThreads, bool compactTriangles)
 {
     mMaxDepth = maxDepth;
 
@@ -22,152 +28,449 @@ ExactOctreeSdf::ExactOctreeSdf(const Mesh& mesh, BoundingBox box, uint32_t maxDe
 
     mStartGridCellSize = maxSize / static_cast<float>(mStartGridSize);
 
-    mTrianglesData = TriangleUtils::calculateMeshTriangleData(mesh);
+    // The influence functions work over a std::vector, so the triangles are only copied to the large array when the storage is compacted
+    std::vector<TriangleUtils::TriangleData> trianglesData = TriangleUtils::calculateMeshTriangleData(mesh);
+    mFarFieldProxy = FarFieldProxy(mesh);
 
-    initOctree<PerNodeRegionTrianglesInfluence<NoneInterpolation>>(mesh, startDepth, maxDepth, minTrianglesPerNode, numThreads);
-    //initOctree<PerVertexTrianglesInfluence<1, NoneInterpolation>>(mesh, startDepth, maxDepth, minTrianglesPerNode);
+    initOctree<PerNodeRegionTrianglesInfluence<NoneInterpolation>>(mesh, trianglesData, startDepth, maxDepth, minTrianglesPerNode, numThreads);
+    //initOctree<PerVertexTrianglesInfluence<1, NoneInterpolation>>(mesh, trianglesData, startDepth, maxDepth, minTrianglesPerNode);
     // calculateStatistics();
-    mTrianglesCache[0].resize(mMaxTrianglesEncodedInLeafs);
-    mTrianglesCache[1].resize(mMaxTrianglesEncodedInLeafs);
+
+    if(!hasAddressableIndices())
+    {
+        SPDLOG_ERROR("The octree arrays exceed the maximum node indices, the octree has not been built");
+        mOctreeData.clear();
+        mTrianglesSets.clear();
+        mTrianglesMasks.clear();
+        mSubtreeOffsets.clear();
+        return;
+    }
+
+    // Share the identical sets and masks, and remove the triangles not referenced by any leaf
+    compactTrianglesStorage(trianglesData);
+    std::vector<TriangleUtils::TriangleData>().swap(trianglesData);
+
+    if(compactTriangles) compactTrianglesData();
 }
 
-inline uint32_t roundFloat(float a)
+void ExactOctreeSdf::compactTrianglesData()
 {
-    return (a > 0.5f) ? 1 : 0;
+    if(mUseCompactTriangles) return;
+
+    mCompactTrianglesData.resize(mTrianglesData.size());
+    for(size_t t=0; t < mTrianglesData.size(); t++)
+    {
+        mCompactTrianglesData[t] = TriangleUtils::CompactTriangleData(mTrianglesData[t]);
+    }
+
+    mTrianglesData.clear();
+    mTrianglesData.shrink_to_fit();
+    mUseCompactTriangles = true;
 }
 
-float ExactOctreeSdf::getDistance(glm::vec3 sample) const
+void ExactOctreeSdf::compactOctreeNodes()
 {
-    glm::vec3 fracPart = (sample - mBox.min) / mStartGridCellSize;
-    glm::ivec3 startArrayPos = glm::floor(fracPart);
-    fracPart = glm::fract(fracPart);
+    if(mUseCompactNodes || mOctreeData.empty()) return;
 
-    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
-       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
-       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    const uint32_t numStartNodes = static_cast<uint32_t>(mStartGridXY * mStartGridSize);
+    LargeArray<uint32_t> compactNodes(numStartNodes);
+    std::vector<uint64_t> farValues;
+
+    auto getFarValue = [&](uint64_t value)
     {
-        return mBox.getDistance(sample) + glm::sqrt(3.0f) * mBox.getSize().x;
-    }
+        farValues.push_back(value);
+        return COMPACT_FAR_MASK | static_cast<uint32_t>(farValues.size() - 1);
+    };
+
+    // The compact nodes are not segmented, so the triangles indices get the offsets of their subtree
+    // when the triangle arrays are also segmented (see hasSegmentedTriangleIndices).
+    // The nodes below the bit encoding start depth store masks, the rest store sets.
+    SubtreeOffsets offsets;
+    bool fitsTrianglesIndices = true;
+    auto getTrianglesIndex = [&](const OctreeNode& node, uint32_t depth)
+    {
+        const uint64_t index = node.trianglesArrayIndex + 
+                               ((depth > mBitEncodingStartDepth) ? offsets.trianglesMasks : offsets.trianglesSets);
+        fitsTrianglesIndices = fitsTrianglesIndices && OctreeNode::fitsIndex(index, 1, std::numeric_limits<uint32_t>::max());
+        return static_cast<uint32_t>(index);
+    };
+
+    // The children blocks are written in depth-first order, 
+    // so most of the children are near their parent
+    std::function<void(uint64_t, uint64_t, uint32_t)> writeNode;
+    writeNode = [&](uint64_t nodeIndex, uint64_t position, uint32_t depth)
+    {
+        if(!fitsTrianglesIndices) return;
 
-    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+        const OctreeNode& node = mOctreeData[nodeIndex];
+        if(node.isLeaf())
+        {
+            const uint32_t trianglesIndex = getTrianglesIndex(node, depth);
+            compactNodes[position] = COMPACT_LEAF_MASK | 
+                                     ((trianglesIndex < COMPACT_FAR_MASK) ? trianglesIndex : getFarValue(trianglesIndex));
+            return;
+        }
 
-    float minDist = INFINITY;
-    uint32_t minIndex = 0;
-    uint32_t depth = mStartDepth;
+        // The inner nodes storing a set or a mask keep its index before the children
+        if(depth >= mBitEncodingStartDepth) compactNodes.push_back(getTrianglesIndex(node, depth));
 
-    while(!currentNode->isLeaf() && depth < mBitEncodingStartDepth)
+        const uint64_t childrenPosition = compactNodes.size();
+        compactNodes.resize(childrenPosition + 8);
+        compactNodes[position] = (childrenPosition - position <= COMPACT_VALUE_MASK) 
+                                    ? static_cast<uint32_t>(childrenPosition - position) 
+                                    : getFarValue(childrenPosition);
+
+        for(uint32_t c=0; c < 8; c++)
+        {
+            writeNode(offsets.nodes + node.getChildrenIndex() + c, childrenPosition + c, depth + 1);
+        }
+    };
+
+    for(uint32_t i=0; i < numStartNodes; i++)
     {
-        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) + 
-                                  (roundFloat(fracPart.y) << 1) + 
-                                   roundFloat(fracPart.x);
+        offsets = getSubtreeOffsets(i);
+        writeNode(i, i, mStartDepth);
+    }
 
-        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
-        fracPart = glm::fract(2.0f * fracPart);
-        depth++;
+    if(!fitsTrianglesIndices)
+    {
+        SPDLOG_ERROR("The triangles indices of the subtrees exceed the compact nodes indices, the nodes are not compacted");
+        return;
     }
 
-    if(currentNode->isLeaf())
+    // The octree keeps the wide nodes if the far values cannot be addressed
+    if(!OctreeNode::fitsIndex(0, farValues.size(), COMPACT_VALUE_MASK))
     {
-        uint32_t leafIndex = currentNode->trianglesArrayIndex;
-        const uint32_t numTriangles = mTrianglesSets[leafIndex++];
+        SPDLOG_ERROR("The compact nodes need more far values than they can address, the nodes are not compacted");
+        return;
+    }
+
+    SPDLOG_INFO("Compact nodes: {} -> {} bytes, {} far pointers", 
+                mOctreeData.size() * sizeof(OctreeNode), 
+                compactNodes.size() * sizeof(uint32_t) + farValues.size() * sizeof(uint64_t), 
+                farValues.size());
+
+    mCompactNodes = std::move(compactNodes);
+    mCompactFarValues = std::move(farValues);
+    mOctreeData.clear();
+    mOctreeData.shrink_to_fit();
+    mSubtreeOffsets.clear();
+    mUseCompactNodes = true;
+}
 
+void ExactOctreeSdf::compactTrianglesStorage(const std::vector<TriangleUtils::TriangleData>& trianglesData)
+{
+    const uint32_t oldBitsPerIndex = mBitsPerIndex;
+    auto decodeSet = [&](uint64_t setIndex, std::vector<uint32_t>& outTriangles)
+    {
+        const uint32_t numTriangles = mTrianglesSets[setIndex++];
+        outTriangles.resize(numTriangles);
         uint32_t bIdx = 0;
-        for(uint32_t t=0; t < numTriangles; t++, bIdx += mBitsPerIndex)
+        for(uint32_t t=0; t < numTriangles; t++, bIdx += oldBitsPerIndex)
         {
             uint32_t idx = bIdx >> 5;
             uint32_t bit = bIdx & 0b0011111;
-            const uint32_t tIndex = ((mTrianglesSets[leafIndex + idx] << bit) >> (32-mBitsPerIndex)) |
-                                static_cast<uint32_t>(static_cast<uint64_t>(mTrianglesSets[leafIndex + idx + 1]) >> (64 - (bit + mBitsPerIndex)));
-
-            const float dist = TriangleUtils::getSqDistPointAndTriangle(sample, mTrianglesData[tIndex]);
-            if(dist < minDist)
-            {
-                minIndex = tIndex;
-                minDist = dist;
-            }
+            outTriangles[t] = ((mTrianglesSets[setIndex + idx] << bit) >> (32-oldBitsPerIndex)) |
+                              static_cast<uint32_t>(static_cast<uint64_t>(mTrianglesSets[setIndex + idx + 1]) >> (64 - (bit + oldBitsPerIndex)));
         }
+    };
 
-        return TriangleUtils::getSignedDistPointAndTriangle(sample, mTrianglesData[minIndex]);
-    }
+    // Only the nodes until the bit encoding start depth store sets of triangles,
+    // the deeper nodes store masks over the triangles of its parent
+    auto hasTrianglesSet = [&](const OctreeNode& node, uint32_t depth)
+    {
+        return depth <= mBitEncodingStartDepth && (node.isLeaf() || depth == mBitEncodingStartDepth);
+    };
 
+    // Offsets of the start grid subtree being visited
+    SubtreeOffsets offsets;
 
-    uint32_t setIndex = currentNode->trianglesArrayIndex;
+    // Find the triangles referenced by the leaves
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> newTriangleIndex(trianglesData.size(), std::numeric_limits<uint32_t>::max());
+    std::function<void(uint64_t, uint32_t)> markTriangles;
+    markTriangles = [&](uint64_t nodeIndex, uint32_t depth)
+    {
+        const OctreeNode& node = mOctreeData[nodeIndex];
+        if(hasTrianglesSet(node, depth))
+        {
+            decodeSet(offsets.trianglesSets + node.trianglesArrayIndex, triangles);
+            for(uint32_t t : triangles) newTriangleIndex[t] = 0;
+        }
+        else if(!node.isLeaf() && depth < mBitEncodingStartDepth)
+        {
+            for(uint32_t c=0; c < 8; c++) markTriangles(offsets.nodes + node.getChildrenIndex() + c, depth + 1);
+        }
+    };
 
-    // Pass to next child
+    const uint32_t numStartNodes = static_cast<uint32_t>(mStartGridXY * mStartGridSize);
+    for(uint32_t i=0; i < numStartNodes; i++)
     {
-    const uint32_t childIdx = (roundFloat(fracPart.z) << 2) + 
-                              (roundFloat(fracPart.y) << 1) + 
-                               roundFloat(fracPart.x);
+        offsets = getSubtreeOffsets(i);
+        markTriangles(i, mStartDepth);
+    }
 
-    currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
-    fracPart = glm::fract(2.0f * fracPart);
+    // The new indices keep the triangles order, so the masks remain valid
+    LargeArray<TriangleUtils::TriangleData> newTrianglesData;
+    for(uint32_t t=0; t < trianglesData.size(); t++)
+    {
+        if(newTriangleIndex[t] == 0)
+        {
+            newTriangleIndex[t] = static_cast<uint32_t>(newTrianglesData.size());
+            newTrianglesData.push_back(trianglesData[t]);
+        }
     }
 
-    uint32_t numTriangles = mTrianglesSets[setIndex++];
-    uint32_t* inputTriangles = mTrianglesCache[0].data();
+    uint32_t newBitsPerIndex = 1;
+    while(newBitsPerIndex < 32 && (1ull << newBitsPerIndex) < newTrianglesData.size()) newBitsPerIndex++;
+
+    // Write again the sets and the masks sharing the identical ones
+    LargeArray<uint32_t> newTrianglesSets;
+    LargeArray<uint8_t> newTrianglesMasks;
+    SharedBlocks<LargeArray<uint32_t>> setsMap(newTrianglesSets);
+    SharedBlocks<LargeArray<uint8_t>> masksMap(newTrianglesMasks);
+    std::vector<uint32_t> encodedSet;
+
+    // The new arrays are shared by all the subtrees, so they must be addressable with the nodes indices.
+    // The first pass only writes the new arrays, and the second one updates the nodes once the arrays are known to fit.
+    bool updateNodes = false;
+    std::function<void(uint64_t, uint32_t, uint32_t)> rebuildNode;
+    rebuildNode = [&](uint64_t nodeIndex, uint32_t depth, uint32_t parentNumTriangles)
     {
-        const uint8_t* mask = mTrianglesMasks.data() + currentNode->trianglesArrayIndex;
+        OctreeNode& node = mOctreeData[nodeIndex];
+        uint32_t numTriangles = 0;
 
-        uint32_t newTriangles = 0;
-        uint32_t t = 0;
-        uint32_t bIdx = 0;
-        for(uint32_t b=0; t < numTriangles; b++)
+        if(depth > mBitEncodingStartDepth)
         {
-            uint32_t i=0;
-            uint8_t code = mask[b];
-            for(; i < 8; i++, t++, bIdx += mBitsPerIndex)
+            const uint32_t numBytes = (parentNumTriangles + 7) / 8;
+            const uint8_t* mask = mTrianglesMasks.data() + offsets.trianglesMasks + node.trianglesArrayIndex;
+            for(uint32_t b=0; b < numBytes; b++) numTriangles += static_cast<uint32_t>(std::bitset<8>(mask[b]).count());
+
+            const uint64_t maskIndex = masksMap.insert(mask, numBytes);
+            if(updateNodes) node.trianglesArrayIndex = static_cast<uint32_t>(maskIndex);
+        }
+        else if(hasTrianglesSet(node, depth))
+        {
+            decodeSet(offsets.trianglesSets + node.trianglesArrayIndex, triangles);
+            numTriangles = static_cast<uint32_t>(triangles.size());
+
+            encodedSet.assign((numTriangles * newBitsPerIndex + 31)/32 + 2, 0);
+            encodedSet[0] = numTriangles;
+            const uint32_t invBitsPerIndex = 32 - newBitsPerIndex;
+            uint32_t bIdx = 0;
+            for(uint32_t t=0; t < numTriangles; t++, bIdx += newBitsPerIndex)
             {
-                if(code & 0b10000000) 
-                {
-                    uint32_t idx = bIdx >> 5;
-                    uint32_t bit = bIdx & 0b0011111;
-                    inputTriangles[newTriangles++] = ((mTrianglesSets[setIndex + idx] << bit) >> (32-mBitsPerIndex)) |
-                                                     static_cast<uint32_t>(static_cast<uint64_t>(mTrianglesSets[setIndex + idx + 1]) >> (64 - (bit + mBitsPerIndex)));;
-                }
-                code = code << 1;
+                const uint32_t index = newTriangleIndex[triangles[t]];
+                uint32_t idx = bIdx >> 5;
+                uint32_t bit = bIdx & 0b0011111;
+                encodedSet[1 + idx] |= (index << invBitsPerIndex) >> bit;
+                encodedSet[1 + idx + 1] |= (static_cast<uint64_t>(index) << (64 - (bit + newBitsPerIndex)));
             }
+
+            const uint64_t setIndex = setsMap.insert(encodedSet.data(), encodedSet.size());
+            if(updateNodes) node.trianglesArrayIndex = static_cast<uint32_t>(setIndex);
         }
 
-        numTriangles = newTriangles;
+        if(!node.isLeaf())
+        {
+            for(uint32_t c=0; c < 8; c++) rebuildNode(offsets.nodes + node.getChildrenIndex() + c, depth + 1, numTriangles);
+        }
+    };
+
+    for(uint32_t i=0; i < numStartNodes; i++)
+    {
+        offsets = getSubtreeOffsets(i);
+        rebuildNode(i, mStartDepth, 0);
     }
 
-    uint32_t* outputTriangles = mTrianglesCache[1].data();
-    while(!currentNode->isLeaf())
+    if(!OctreeNode::fitsIndex(0, newTrianglesSets.size(), std::numeric_limits<uint32_t>::max()) ||
+       !OctreeNode::fitsIndex(0, newTrianglesMasks.size(), std::numeric_limits<uint32_t>::max()))
     {
-        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) + 
-                                  (roundFloat(fracPart.y) << 1) + 
-                                   roundFloat(fracPart.x);
+        // The original arrays and the subtree offsets are kept, so the indices remain segmented
+        SPDLOG_ERROR("The shared triangles arrays cannot be addressed with the nodes indices, the storage is not compacted");
+        mTrianglesData.assign(trianglesData.begin(), trianglesData.end());
+        return;
+    }
 
-        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
-        fracPart = glm::fract(2.0f * fracPart);
+    // The identical sets and masks are found again, so the nodes get the indices of the first pass
+    updateNodes = true;
+    for(uint32_t i=0; i < numStartNodes; i++)
+    {
+        offsets = getSubtreeOffsets(i);
+        rebuildNode(i, mStartDepth, 0);
+    }
 
-        const uint8_t* mask = mTrianglesMasks.data() + currentNode->trianglesArrayIndex;
+    SPDLOG_INFO("Triangle sets: {} unique, {} -> {} bytes", setsMap.size(), 
+                mTrianglesSets.size() * sizeof(uint32_t), newTrianglesSets.size() * sizeof(uint32_t));
+    SPDLOG_INFO("Triangle masks: {} unique, {} -> {} bytes", masksMap.size(), mTrianglesMasks.size(), newTrianglesMasks.size());
+    SPDLOG_INFO("Referenced triangles: {} of {}, {} bits per index", newTrianglesData.size(), trianglesData.size(), newBitsPerIndex);
 
-        uint32_t newTriangles = 0;
-        uint32_t idx = 0;
-        for(uint32_t b=0; idx < numTriangles; b++)
+    mOriginalTrianglesSetsSize = mTrianglesSets.size();
+    mOriginalTrianglesMasksSize = mTrianglesMasks.size();
+    mOriginalNumTriangles = static_cast<uint32_t>(trianglesData.size());
+
+    mTrianglesSets = std::move(newTrianglesSets);
+    mTrianglesMasks = std::move(newTrianglesMasks);
+    mTrianglesData = std::move(newTrianglesData);
+    mBitsPerIndex = newBitsPerIndex;
+
+    // Now the triangles indices are global, only the nodes indices remain segmented
+    for(SubtreeOffsets& subtreeOffsets : mSubtreeOffsets)
+    {
+        subtreeOffsets.trianglesSets = 0;
+        subtreeOffsets.trianglesMasks = 0;
+    }
+}
+
+bool ExactOctreeSdf::hasSegmentedTriangleIndices() const
+{
+    for(const SubtreeOffsets& offsets : mSubtreeOffsets)
+    {
+        if(offsets.trianglesSets != 0 || offsets.trianglesMasks != 0) return true;
+    }
+
+    return false;
+}
+
+bool ExactOctreeSdf::hasAddressableIndices() const
+{
+    constexpr uint64_t MAX_ARRAY_INDEX = std::numeric_limits<uint32_t>::max();
+    if(!hasSegmentedIndices())
+    {
+        return OctreeNode::fitsIndex(0, mOctreeData.size(), OctreeNode::CHILDREN_INDEX_MASK) &&
+               OctreeNode::fitsIndex(0, mTrianglesSets.size(), MAX_ARRAY_INDEX) &&
+               OctreeNode::fitsIndex(0, mTrianglesMasks.size(), MAX_ARRAY_INDEX);
+    }
+
+    // The local index 0 of each subtree is its start grid node, the rest of its nodes are stored after its offset
+    for(size_t i=0; i < mSubtreeOffsets.size(); i++)
+    {
+        const SubtreeOffsets& offsets = mSubtreeOffsets[i];
+        const bool isLast = i + 1 == mSubtreeOffsets.size();
+        const uint64_t nodesEnd = (isLast) ? mOctreeData.size() - 1 : mSubtreeOffsets[i + 1].nodes;
+        const uint64_t setsEnd = (isLast) ? mTrianglesSets.size() : mSubtreeOffsets[i + 1].trianglesSets;
+        const uint64_t masksEnd = (isLast) ? mTrianglesMasks.size() : mSubtreeOffsets[i + 1].trianglesMasks;
+        if(!OctreeNode::fitsIndex(0, nodesEnd - offsets.nodes + 1, OctreeNode::CHILDREN_INDEX_MASK) ||
+           !OctreeNode::fitsIndex(0, setsEnd - offsets.trianglesSets, MAX_ARRAY_INDEX) ||
+           !OctreeNode::fitsIndex(0, masksEnd - offsets.trianglesMasks, MAX_ARRAY_INDEX))
         {
-            uint32_t i=0;
-            uint8_t code = mask[b];
-            for(; i < 8; i++, idx++)
-            {
-                if(code & 0b10000000) 
-                {
-                    outputTriangles[newTriangles++] = inputTriangles[idx];
-                }
-                code = code << 1;
-            }
+            return false;
         }
+    }
 
-        numTriangles = newTriangles;
+    return true;
+}
 
-        std::swap(outputTriangles, inputTriangles);
+std::array<std::vector<uint32_t>, 2>& ExactOctreeSdf::getTrianglesCache() const
+{
+    thread_local std::array<std::vector<uint32_t>, 2> trianglesCache;
+    const uint32_t cacheSize = glm::max(mMaxTrianglesEncodedInLeafs, mMaxTrianglesInLeafs);
+    if(trianglesCache[0].size() < cacheSize)
+    {
+        trianglesCache[0].resize(cacheSize);
+        trianglesCache[1].resize(cacheSize);
+    }
+    return trianglesCache;
+}
+
+inline uint32_t roundFloat(float a)
+{
+    return (a > 0.5f) ? 1 : 0;
+}
+
+// Traversal of the nodes stored with two 32-bit fields
+struct ExactOctreeSdf::WideNodesCursor
+{
+    WideNodesCursor(const ExactOctreeSdf& sdf, uint32_t startIndex)
+    {
+        const SubtreeOffsets offsets = sdf.getSubtreeOffsets(startIndex);
+        octreeData = sdf.mOctreeData.data();
+        nodes = octreeData + offsets.nodes;
+        node = octreeData + startIndex;
+        trianglesSets = sdf.mTrianglesSets.data() + offsets.trianglesSets;
+        trianglesMasks = sdf.mTrianglesMasks.data() + offsets.trianglesMasks;
+    }
+
+    inline bool isLeaf() const { return node->isLeaf(); }
+    inline void goToChild(uint32_t childIdx) { node = nodes + node->getChildrenIndex() + childIdx; }
+    inline uint32_t getTrianglesIndex() const { return node->trianglesArrayIndex; }
+    inline uint64_t getNodePosition() const { return static_cast<uint64_t>(node - octreeData); }
+
+    const OctreeNode* octreeData;
+    const OctreeNode* nodes;
+    const OctreeNode* node;
+    const uint32_t* trianglesSets;
+    const uint8_t* trianglesMasks;
+};
+
+// Traversal of the nodes stored with the compact encoding
+struct ExactOctreeSdf::CompactNodesCursor
+{
+    CompactNodesCursor(const ExactOctreeSdf& sdf, uint32_t startIndex)
+        : nodes(sdf.mCompactNodes.data()),
+          farValues(sdf.mCompactFarValues.data()),
+          position(startIndex),
+          trianglesSets(sdf.mTrianglesSets.data()),
+          trianglesMasks(sdf.mTrianglesMasks.data())
+    {}
+
+    inline bool isLeaf() const { return nodes[position] & COMPACT_LEAF_MASK; }
+
+    inline uint64_t getValue() const
+    {
+        const uint32_t word = nodes[position];
+        return (word & COMPACT_FAR_MASK) ? farValues[word & COMPACT_VALUE_MASK] : (word & COMPACT_VALUE_MASK);
+    }
+
+    inline uint64_t getChildrenPosition() const
+    {
+        const uint32_t word = nodes[position];
+        return (word & COMPACT_FAR_MASK) ? farValues[word & COMPACT_VALUE_MASK] : position + (word & COMPACT_VALUE_MASK);
+    }
+
+    inline void goToChild(uint32_t childIdx) { position = getChildrenPosition() + childIdx; }
+
+    // The inner nodes store their triangles index just before their children
+    inline uint32_t getTrianglesIndex() const
+    {
+        return (isLeaf()) ? static_cast<uint32_t>(getValue()) : nodes[getChildrenPosition() - 1];
+    }
+
+    inline uint64_t getNodePosition() const { return position; }
+
+    const uint32_t* nodes;
+    const uint64_t* farValues;
+    uint64_t position;
+    const uint32_t* trianglesSets;
+    const uint8_t* trianglesMasks;
+};
+
+uint32_t ExactOctreeSdf::decodeTrianglesSet(const uint32_t* trianglesSet, uint32_t numTriangles, 
+                                            const uint8_t* mask, uint32_t* outTriangles) const
+{
+    uint32_t newTriangles = 0;
+    uint32_t bIdx = 0;
+    for(uint32_t t=0; t < numTriangles; t++, bIdx += mBitsPerIndex)
+    {
+        if(mask != nullptr && !(mask[t >> 3] & (0b10000000 >> (t & 0b0111)))) continue;
+
+        uint32_t idx = bIdx >> 5;
+        uint32_t bit = bIdx & 0b0011111;
+        outTriangles[newTriangles++] = ((trianglesSet[idx] << bit) >> (32-mBitsPerIndex)) |
+                                       static_cast<uint32_t>(static_cast<uint64_t>(trianglesSet[idx + 1]) >> (64 - (bit + mBitsPerIndex)));
     }
 
+    return newTriangles;
+}
+
+uint32_t ExactOctreeSdf::findNearestTriangle(glm::vec3 sample, const uint32_t* triangles, uint32_t numTriangles) const
+{
+    float minDist = INFINITY;
+    uint32_t minIndex = INVALID_TRIANGLE;
     for(uint32_t t=0; t < numTriangles; t++)
     {
-        const uint32_t tIndex = inputTriangles[t];
-        const float dist = TriangleUtils::getSqDistPointAndTriangle(sample, mTrianglesData[tIndex]);
+        const uint32_t tIndex = triangles[t];
+        const float dist = getSqDistToTriangle(sample, tIndex);
         if(dist < minDist)
         {
             minIndex = tIndex;
@@ -175,10 +478,68 @@ float ExactOctreeSdf::getDistance(glm::vec3 sample) const
         }
     }
 
-    return TriangleUtils::getSignedDistPointAndTriangle(sample, mTrianglesData[minIndex]);
+    return minIndex;
 }
 
-float ExactOctreeSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+template<typename NodesCursor>
+float ExactOctreeSdf::queryDistance(glm::vec3 sample) const
+{
+    const glm::ivec3 startArrayPos = glm::floor((sample - mBox.min) / mStartGridCellSize);
+    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
+       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
+       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        return glm::max(mBox.getDistance(sample), mFarFieldProxy.getDistance(sample));
+    }
+
+    uint32_t numTriangles, depth, maskBitsDecoded;
+    const uint32_t* triangles = queryLeafTriangles<NodesCursor>(sample, numTriangles, depth, maskBitsDecoded);
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(depth - mStartDepth + 1, depth, numTriangles, maskBitsDecoded);
+
+    // The leaves without triangles have no surface to measure the distance to
+    const uint32_t nearestTriangle = findNearestTriangle(sample, triangles, numTriangles);
+    if(nearestTriangle == INVALID_TRIANGLE) return getEmptyLeafDistance(depth);
+
+    return getSignedDistToTriangle(sample, nearestTriangle);
+}
+
+template<typename NodesCursor>
+float ExactOctreeSdf::queryDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    const glm::ivec3 startArrayPos = glm::floor((sample - mBox.min) / mStartGridCellSize);
+    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
+       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
+       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        const float boxDist = mBox.getDistance(sample, outGradient);
+        glm::vec3 proxyGradient;
+        const float proxyDist = mFarFieldProxy.getDistance(sample, proxyGradient);
+        if(proxyDist > boxDist)
+        {
+            outGradient = proxyGradient;
+            return proxyDist;
+        }
+        return boxDist;
+    }
+
+    uint32_t numTriangles, depth, maskBitsDecoded;
+    const uint32_t* triangles = queryLeafTriangles<NodesCursor>(sample, numTriangles, depth, maskBitsDecoded);
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(depth - mStartDepth + 1, depth, numTriangles, maskBitsDecoded);
+
+    const uint32_t nearestTriangle = findNearestTriangle(sample, triangles, numTriangles);
+    if(nearestTriangle == INVALID_TRIANGLE)
+    {
+        outGradient = glm::vec3(0.0f);
+        return getEmptyLeafDistance(depth);
+    }
+
+    return getSignedDistToTriangle(sample, nearestTriangle, outGradient);
+}
+
+template<typename NodesCursor>
+bool ExactOctreeSdf::queryLeafPath(glm::vec3 sample, LeafPath& outPath, std::vector<const uint8_t*>& outMasks) const
 {
     glm::vec3 fracPart = (sample - mBox.min) / mStartGridCellSize;
     glm::ivec3 startArrayPos = glm::floor(fracPart);
@@ -188,136 +549,276 @@ float ExactOctreeSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) cons
        startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
        startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
     {
-        return mBox.getDistance(sample) + glm::sqrt(3.0f) * mBox.getSize().x;
+        return false;
     }
 
-    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
-
-    float minDist = INFINITY;
-    uint32_t minIndex = 0;
+    NodesCursor cursor(*this, startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x);
     uint32_t depth = mStartDepth;
 
-    while(!currentNode->isLeaf() && depth < mBitEncodingStartDepth)
+    while(!cursor.isLeaf() && depth < mBitEncodingStartDepth)
     {
         const uint32_t childIdx = (roundFloat(fracPart.z) << 2) + 
                                   (roundFloat(fracPart.y) << 1) + 
                                    roundFloat(fracPart.x);
 
-        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        cursor.goToChild(childIdx);
         fracPart = glm::fract(2.0f * fracPart);
         depth++;
     }
 
-    if(currentNode->isLeaf())
-    {
-        uint32_t leafIndex = currentNode->trianglesArrayIndex;
-        const uint32_t numTriangles = mTrianglesSets[leafIndex++];
+    outPath.trianglesSet = cursor.trianglesSets + cursor.getTrianglesIndex();
+    outPath.masksStart = outMasks.size();
 
-        uint32_t bIdx = 0;
-        for(uint32_t t=0; t < numTriangles; t++, bIdx += mBitsPerIndex)
-        {
-            uint32_t idx = bIdx >> 5;
-            uint32_t bit = bIdx & 0b0011111;
-            const uint32_t tIndex = ((mTrianglesSets[leafIndex + idx] << bit) >> (32-mBitsPerIndex)) |
-                                static_cast<uint32_t>(static_cast<uint64_t>(mTrianglesSets[leafIndex + idx + 1]) >> (64 - (bit + mBitsPerIndex)));
+    // The nodes below the set store the masks filtering it
+    while(!cursor.isLeaf())
+    {
+        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) + 
+                                  (roundFloat(fracPart.y) << 1) + 
+                                   roundFloat(fracPart.x);
 
-            const float dist = TriangleUtils::getSqDistPointAndTriangle(sample, mTrianglesData[tIndex]);
-            if(dist < minDist)
-            {
-                minIndex = tIndex;
-                minDist = dist;
-            }
-        }
+        cursor.goToChild(childIdx);
+        fracPart = glm::fract(2.0f * fracPart);
+        depth++;
 
-        return TriangleUtils::getSignedDistPointAndTriangle(sample, mTrianglesData[minIndex], outGradient);
+        outMasks.push_back(cursor.trianglesMasks + cursor.getTrianglesIndex());
     }
 
+    outPath.leafPosition = cursor.getNodePosition();
+    outPath.depth = depth;
+    outPath.numMasks = static_cast<uint32_t>(outMasks.size() - outPath.masksStart);
+    return true;
+}
 
-    uint32_t setIndex = currentNode->trianglesArrayIndex;
+const uint32_t* ExactOctreeSdf::decodeLeafTriangles(const LeafPath& path, const uint8_t* const* masks,
+                                                    uint32_t& outNumTriangles, uint32_t& outMaskBitsDecoded) const
+{
+    std::array<std::vector<uint32_t>, 2>& trianglesCache = getTrianglesCache();
+    uint32_t* inputTriangles = trianglesCache[0].data();
+    uint32_t numTriangles = path.trianglesSet[0];
+    outMaskBitsDecoded = 0;
 
-    // Pass to next child
+    if(path.numMasks == 0)
     {
-    const uint32_t childIdx = (roundFloat(fracPart.z) << 2) + 
-                                  (roundFloat(fracPart.y) << 1) + 
-                                   roundFloat(fracPart.x);
+        decodeTrianglesSet(path.trianglesSet + 1, numTriangles, nullptr, inputTriangles);
 
-    currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
-    fracPart = glm::fract(2.0f * fracPart);
+        outNumTriangles = numTriangles;
+        return inputTriangles;
     }
 
-    uint32_t numTriangles = mTrianglesSets[setIndex++];
-    uint32_t* inputTriangles = mTrianglesCache[0].data();
+    // The set is decoded filtered by the mask of the first child
+    outMaskBitsDecoded += 8 * ((numTriangles + 7) >> 3);
+    numTriangles = decodeTrianglesSet(path.trianglesSet + 1, numTriangles, masks[0], inputTriangles);
+
+    uint32_t* outputTriangles = trianglesCache[1].data();
+    for(uint32_t m=1; m < path.numMasks; m++)
     {
-        const uint8_t* mask = mTrianglesMasks.data() + currentNode->trianglesArrayIndex;
+        const uint8_t* mask = masks[m];
+        outMaskBitsDecoded += 8 * ((numTriangles + 7) >> 3);
 
         uint32_t newTriangles = 0;
-        uint32_t t = 0;
-        uint32_t bIdx = 0;
-        for(uint32_t b=0; t < numTriangles; b++)
+        uint32_t idx = 0;
+        for(uint32_t b=0; idx < numTriangles; b++)
         {
-            uint32_t i=0;
             uint8_t code = mask[b];
-            for(; i < 8; i++, t++, bIdx += mBitsPerIndex)
+            for(uint32_t i=0; i < 8; i++, idx++)
             {
                 if(code & 0b10000000) 
                 {
-                    uint32_t idx = bIdx >> 5;
-                    uint32_t bit = bIdx & 0b0011111;
-                    inputTriangles[newTriangles++] = ((mTrianglesSets[setIndex + idx] << bit) >> (32-mBitsPerIndex)) |
-                                                     static_cast<uint32_t>(static_cast<uint64_t>(mTrianglesSets[setIndex + idx + 1]) >> (64 - (bit + mBitsPerIndex)));;
+                    outputTriangles[newTriangles++] = inputTriangles[idx];
                 }
                 code = code << 1;
             }
         }
 
         numTriangles = newTriangles;
+
+        std::swap(outputTriangles, inputTriangles);
     }
 
-    uint32_t* outputTriangles = mTrianglesCache[1].data();
-    while(!currentNode->isLeaf())
+    outNumTriangles = numTriangles;
+    return inputTriangles;
+}
+
+template<typename NodesCursor>
+const uint32_t* ExactOctreeSdf::queryLeafTriangles(glm::vec3 sample, uint32_t& outNumTriangles,
+                                                   uint32_t& outDepth, uint32_t& outMaskBitsDecoded) const
+{
+    thread_local std::vector<const uint8_t*> masks;
+    masks.clear();
+
+    LeafPath path;
+    queryLeafPath<NodesCursor>(sample, path, masks);
+
+    outDepth = path.depth;
+    return decodeLeafTriangles(path, masks.data(), outNumTriangles, outMaskBitsDecoded);
+}
+
+template<typename NodesCursor>
+void ExactOctreeSdf::countNodesPerDepth(NodesCursor cursor, uint32_t depth, MemoryUsage& usage) const
+{
+    usage.nodesPerDepth[depth]++;
+    if(cursor.isLeaf())
     {
-        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) + 
-                                  (roundFloat(fracPart.y) << 1) + 
-                                   roundFloat(fracPart.x);
+        usage.leavesPerDepth[depth]++;
+        return;
+    }
 
-        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
-        fracPart = glm::fract(2.0f * fracPart);
+    for(uint32_t c=0; c < 8; c++)
+    {
+        NodesCursor child = cursor;
+        child.goToChild(c);
+        countNodesPerDepth(child, depth + 1, usage);
+    }
+}
+
+SdfFunction::MemoryUsage ExactOctreeSdf::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    if(mUseCompactNodes)
+    {
+        usage.addArray("compact nodes", mCompactNodes);
+        usage.addArray("compact far values", mCompactFarValues);
+    }
+    else
+    {
+        usage.addArray("nodes", mOctreeData);
+        usage.addArray("subtree offsets", mSubtreeOffsets);
+    }
 
-        const uint8_t* mask = mTrianglesMasks.data() + currentNode->trianglesArrayIndex;
+    usage.addArray("triangle sets", mTrianglesSets);
+    usage.addArray("triangle masks", mTrianglesMasks);
+    if(mUseCompactTriangles) usage.addArray("compact triangle data", mCompactTrianglesData);
+    else usage.addArray("triangle data", mTrianglesData);
 
-        uint32_t newTriangles = 0;
-        uint32_t idx = 0;
-        for(uint32_t b=0; idx < numTriangles; b++)
+    // Each thread querying the structure allocates its own cache
+    usage.addArray("triangles cache per thread", 
+                   2 * glm::max(mMaxTrianglesEncodedInLeafs, mMaxTrianglesInLeafs) * sizeof(uint32_t));
+
+    usage.nodesPerDepth.assign(mMaxDepth + 1, 0);
+    usage.leavesPerDepth.assign(mMaxDepth + 1, 0);
+    const uint32_t numStartNodes = static_cast<uint32_t>(mStartGridXY * mStartGridSize);
+    for(uint32_t i=0; i < numStartNodes; i++)
+    {
+        if(mUseCompactNodes) countNodesPerDepth(CompactNodesCursor(*this, i), mStartDepth, usage);
+        else countNodesPerDepth(WideNodesCursor(*this, i), mStartDepth, usage);
+    }
+
+    return usage;
+}
+
+float ExactOctreeSdf::getEmptyLeafDistance(uint32_t depth) const
+{
+    return std::ldexp(mStartGridCellSize, -static_cast<int>(depth - mStartDepth));
+}
+
+float ExactOctreeSdf::getDistance(glm::vec3 sample) const
+{
+    return (mUseCompactNodes) ? queryDistance<CompactNodesCursor>(sample) 
+                              : queryDistance<WideNodesCursor>(sample);
+}
+
+float ExactOctreeSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    return (mUseCompactNodes) ? queryDistance<CompactNodesCursor>(sample, outGradient) 
+                              : queryDistance<WideNodesCursor>(sample, outGradient);
+}
+
+bool ExactOctreeSdf::getLeafPath(glm::vec3 sample, LeafPath& outPath, std::vector<const uint8_t*>& outMasks) const
+{
+    return (mUseCompactNodes) ? queryLeafPath<CompactNodesCursor>(sample, outPath, outMasks) 
+                              : queryLeafPath<WideNodesCursor>(sample, outPath, outMasks);
+}
+
+void ExactOctreeSdf::getDistances(const glm::vec3* samples, float* outDistances, size_t numSamples) const
+{
+    // Number of samples evaluated together against each triangle of a leaf
+    constexpr uint32_t TILE_SIZE = 32;
+
+    // Group the samples by leaf, keeping the path of each one to decode the leaf triangles without traversing the octree again
+    thread_local std::vector<std::pair<LeafPath, size_t>> leafSamples; // (leaf path, sample index)
+    thread_local std::vector<const uint8_t*> leafMasks;
+    leafSamples.clear();
+    leafSamples.reserve(numSamples);
+    leafMasks.clear();
+    LeafPath path;
+    for(size_t s=0; s < numSamples; s++)
+    {
+        if(getLeafPath(samples[s], path, leafMasks)) leafSamples.push_back(std::make_pair(path, s));
+        else outDistances[s] = getDistance(samples[s]);
+    }
+
+    std::sort(leafSamples.begin(), leafSamples.end(), 
+              [](const std::pair<LeafPath, size_t>& a, const std::pair<LeafPath, size_t>& b) 
+              { 
+                  return (a.first.leafPosition != b.first.leafPosition) ? a.first.leafPosition < b.first.leafPosition 
+                                                                        : a.second < b.second; 
+              });
+
+    std::array<glm::vec3, TILE_SIZE> tileSamples;
+    std::array<float, TILE_SIZE> minDist;
+    std::array<uint32_t, TILE_SIZE> minIndex;
+    TriangleUtils::TriangleData decodedTriangle;
+
+    const bool recordStats = mQueryStats.isEnabled();
+    size_t start = 0;
+    while(start < leafSamples.size())
+    {
+        size_t end = start + 1;
+        while(end < leafSamples.size() && leafSamples[end].first.leafPosition == leafSamples[start].first.leafPosition) end++;
+
+        // All the samples of the group share the same triangles
+        const LeafPath& groupPath = leafSamples[start].first;
+        const uint32_t depth = groupPath.depth;
+        uint32_t numTriangles, maskBitsDecoded;
+        const uint32_t* triangles = decodeLeafTriangles(groupPath, leafMasks.data() + groupPath.masksStart, 
+                                                        numTriangles, maskBitsDecoded);
+
+        if(recordStats)
         {
-            uint32_t i=0;
-            uint8_t code = mask[b];
-            for(; i < 8; i++, idx++)
+            for(size_t s=start; s < end; s++)
             {
-                if(code & 0b10000000) 
-                {
-                    outputTriangles[newTriangles++] = inputTriangles[idx];
-                }
-                code = code << 1;
+                mQueryStats.recordQuery(depth - mStartDepth + 1, depth, numTriangles, (s == start) ? maskBitsDecoded : 0);
             }
         }
 
-        numTriangles = newTriangles;
+        for(size_t tileStart=start; tileStart < end; tileStart += TILE_SIZE)
+        {
+            const uint32_t tileSize = static_cast<uint32_t>(std::min(static_cast<size_t>(TILE_SIZE), end - tileStart));
+            for(uint32_t p=0; p < tileSize; p++)
+            {
+                tileSamples[p] = samples[leafSamples[tileStart + p].second];
+                minDist[p] = INFINITY;
+                minIndex[p] = INVALID_TRIANGLE;
+            }
 
-        std::swap(outputTriangles, inputTriangles);
-    }
+            // Each triangle is loaded once and evaluated against all the tile samples
+            for(uint32_t t=0; t < numTriangles; t++)
+            {
+                const uint32_t tIndex = triangles[t];
+                // The compact triangles are decoded once for all the tile samples
+                const TriangleUtils::TriangleData& triangle = (mUseCompactTriangles) 
+                                                              ? (decodedTriangle = mCompactTrianglesData[tIndex].toTriangleData())
+                                                              : mTrianglesData[tIndex];
+                for(uint32_t p=0; p < tileSize; p++)
+                {
+                    const float dist = TriangleUtils::getSqDistPointAndTriangle(tileSamples[p], triangle);
+                    if(dist < minDist[p])
+                    {
+                        minIndex[p] = tIndex;
+                        minDist[p] = dist;
+                    }
+                }
+            }
 
-    for(uint32_t t=0; t < numTriangles; t++)
-    {
-        const uint32_t tIndex = inputTriangles[t];
-        const float dist = TriangleUtils::getSqDistPointAndTriangle(sample, mTrianglesData[tIndex]);
-        if(dist < minDist)
-        {
-            minIndex = tIndex;
-            minDist = dist;
+            for(uint32_t p=0; p < tileSize; p++)
+            {
+                outDistances[leafSamples[tileStart + p].second] = (minIndex[p] == INVALID_TRIANGLE) ? getEmptyLeafDistance(depth)
+                                                                  : getSignedDistToTriangle(tileSamples[p], minIndex[p]);
+            }
         }
-    }
 
-    return TriangleUtils::getSignedDistPointAndTriangle(sample, mTrianglesData[minIndex], outGradient);
+        start = end;
+    }
 }
 
 std::vector<uint32_t> ExactOctreeSdf::evalNode(uint32_t nodeIndex, uint32_t depth, 
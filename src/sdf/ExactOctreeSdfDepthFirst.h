@@ -29,7 +29,8 @@ struct DepthFirstNodeInfoExactOctree
 }
 
 template<typename TrianglesInfluenceStrategy>
-void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t maxDepth,
+void ExactOctreeSdf::initOctree(const Mesh& mesh, const std::vector<TriangleUtils::TriangleData>& trianglesData, 
+                                uint32_t startDepth, uint32_t maxDepth,
                                 uint32_t minTrianglesPerNode, uint32_t numThreads)
 {
     using namespace internal;
@@ -67,7 +68,6 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
 
     mMinTrianglesInLeafs = minTrianglesPerNode;
 
-    std::vector<TriangleUtils::TriangleData>& trianglesData = mTrianglesData;
     const uint32_t startOctreeDepth = glm::min(startDepth, START_OCTREE_DEPTH);
 
     uint32_t bitEncodingStartDepth = maxDepth - BIT_ENCODING_DEPTH;
@@ -158,9 +158,9 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
     mMaxTrianglesEncodedInLeafs = 0;
 
     auto processNode = [&mesh, &trianglesData] (const NodeInfo& node, ThreadContext& tContext, 
-                                                std::vector<OctreeNode>& outputOctree,
-                                                std::vector<uint32_t>& outputTrianglesSets,
-                                                std::vector<uint8_t>& outputTrianglesMasks)
+                                                auto& outputOctree,
+                                                auto& outputTrianglesSets,
+                                                auto& outputTrianglesMasks)
     {
         const std::array<glm::vec3, 19> nodeSamplePoints =
         {
@@ -251,9 +251,9 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
 
             for(uint32_t c=0; c < 8; c++)
             {
-                uint32_t arrayStartIndex = outputTrianglesMasks.size();
                 const uint32_t numTriangles = nodeTriangles.size();
                 const uint32_t numBytes = (numTriangles + 7) / 8;
+                uint32_t arrayStartIndex = outputTrianglesMasks.size();
                 outputTrianglesMasks.resize(outputTrianglesMasks.size() + numBytes);
 
                 octreeNodesChildren[c].trianglesArrayIndex = arrayStartIndex;
@@ -265,9 +265,9 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
 
             if(node.depth == tContext.bitEncodingStartDepth)
             {
-                uint32_t arrayStartIndex = outputTrianglesSets.size();
                 const uint32_t numTriangles = nodeTriangles.size();
                 const uint32_t arraySize = (numTriangles * tContext.bitsPerIndex + 31)/32;
+                uint32_t arrayStartIndex = outputTrianglesSets.size();
                 outputTrianglesSets.resize(outputTrianglesSets.size() + arraySize + 2);
 
                 octreeNode->trianglesArrayIndex = arrayStartIndex;
@@ -452,9 +452,9 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
 
             if(node.depth <= tContext.bitEncodingStartDepth)
             {
-                uint32_t arrayStartIndex = outputTrianglesSets.size();
                 const uint32_t numTriangles = nodeTriangles.size();
                 const uint32_t arraySize = (numTriangles * tContext.bitsPerIndex + 31)/32;
+                uint32_t arrayStartIndex = outputTrianglesSets.size();
                 outputTrianglesSets.resize(outputTrianglesSets.size() + arraySize + 2);
 
                 octreeNode->trianglesArrayIndex = arrayStartIndex;
@@ -579,43 +579,77 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
         }
 
         // Merge all the subtrees
+        // If the merged arrays cannot be addressed with the nodes indices, each subtree keeps its own indices
+        // and its offsets are stored in the start grid
+        uint64_t totalNodes = voxlesPerAxis * voxlesPerAxis * voxlesPerAxis;
+        uint64_t totalTrianglesSets = mTrianglesSets.size();
+        uint64_t totalTrianglesMasks = mTrianglesMasks.size();
+        for(OctreeDataWithPadding& subOctree : subOctrees)
+        {
+            totalNodes += subOctree.octreeData.size() - 1;
+            totalTrianglesSets += subOctree.trianglesSets.size();
+            totalTrianglesMasks += subOctree.trianglesMasks.size();
+        }
+
+        const bool useSegmentedIndices = totalNodes > OctreeNode::CHILDREN_INDEX_MASK ||
+                                         totalTrianglesSets > std::numeric_limits<uint32_t>::max() ||
+                                         totalTrianglesMasks > std::numeric_limits<uint32_t>::max();
+        if(useSegmentedIndices)
+        {
+            SPDLOG_INFO("The octree arrays exceed the node indices, using segmented indices");
+            mSubtreeOffsets.resize(subOctrees.size());
+        }
+
+        mOctreeData.reserve(totalNodes);
+        mTrianglesSets.reserve(totalTrianglesSets);
+        mTrianglesMasks.reserve(totalTrianglesMasks);
         mOctreeData.resize(voxlesPerAxis * voxlesPerAxis * voxlesPerAxis);
         for(uint32_t i=0; i < subOctrees.size(); i++)
         {
             std::vector<OctreeNode>& octreeData = subOctrees[i].octreeData;
 
-            const uint32_t startIndex = mOctreeData.size();
-            const uint32_t startTrianglesSetsIndex = mTrianglesSets.size();
-            const uint32_t startTrianglesMasksIndex = mTrianglesMasks.size();
-            
-            // Add start index to the subtree
-            std::function<void(OctreeNode&, uint32_t)> vistNode;
-            vistNode = [&](OctreeNode& node, uint32_t depth)
+            if(useSegmentedIndices)
+            {
+                // The first node of the subtree is moved to the start grid, so the children indices are shifted by one
+                mSubtreeOffsets[i].nodes = mOctreeData.size() - 1;
+                mSubtreeOffsets[i].trianglesSets = mTrianglesSets.size();
+                mSubtreeOffsets[i].trianglesMasks = mTrianglesMasks.size();
+            }
+            else
             {
-                // Iterate children
-                if(!node.isLeaf())
+                const uint32_t startIndex = mOctreeData.size();
+                const uint32_t startTrianglesSetsIndex = mTrianglesSets.size();
+                const uint32_t startTrianglesMasksIndex = mTrianglesMasks.size();
+                
+                // Add start index to the subtree
+                std::function<void(OctreeNode&, uint32_t)> vistNode;
+                vistNode = [&](OctreeNode& node, uint32_t depth)
                 {
-                    for(uint32_t i = 0; i < 8; i++)
+                    // Iterate children
+                    if(!node.isLeaf())
                     {
-                        vistNode(octreeData[node.getChildrenIndex() + i], depth + 1);
-                    }
+                        for(uint32_t i = 0; i < 8; i++)
+                        {
+                            vistNode(octreeData[node.getChildrenIndex() + i], depth + 1);
+                        }
 
-                    // Update node index
-                    node.setValues(false, node.getChildrenIndex() + startIndex - 1);
-                }
+                        // Update node index
+                        node.setValues(false, node.getChildrenIndex() + startIndex - 1);
+                    }
 
-                if(depth > mainThread.bitEncodingStartDepth)
-                {
-                    node.trianglesArrayIndex += startTrianglesMasksIndex;
-                }
-                else if(node.isLeaf() || 
-                        depth == mainThread.bitEncodingStartDepth)
-                {
-                    node.trianglesArrayIndex += startTrianglesSetsIndex;
-                }                
-            };
+                    if(depth > mainThread.bitEncodingStartDepth)
+                    {
+                        node.trianglesArrayIndex += startTrianglesMasksIndex;
+                    }
+                    else if(node.isLeaf() || 
+                            depth == mainThread.bitEncodingStartDepth)
+                    {
+                        node.trianglesArrayIndex += startTrianglesSetsIndex;
+                    }                
+                };
 
-            vistNode(octreeData[0], mainThread.startOctreeDepth);
+                vistNode(octreeData[0], mainThread.startOctreeDepth);
+            }
 
             // Move the fist node to the correct start grid position
             mOctreeData[i] = octreeData[0];
@@ -624,6 +658,9 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
             mOctreeData.insert(mOctreeData.end(), octreeData.begin() + 1, octreeData.end());
             mTrianglesSets.insert(mTrianglesSets.end(), subOctrees[i].trianglesSets.begin(), subOctrees[i].trianglesSets.end());
             mTrianglesMasks.insert(mTrianglesMasks.end(), subOctrees[i].trianglesMasks.begin(), subOctrees[i].trianglesMasks.end());
+
+            // Free the subtree to reduce the peak memory of the merge
+            subOctrees[i] = OctreeDataWithPadding();
         }
 
         mMaxTrianglesEncodedInLeafs = 0.0f;
@@ -654,7 +691,7 @@ void ExactOctreeSdf::initOctree(const Mesh& mesh, uint32_t startDepth, uint32_t
         #endif
     }
     #endif
-	
+
 #ifdef SDFLIB_PRINT_STATISTICS
     SPDLOG_INFO("Used an octree of max depth {}", maxDepth);
     for(uint32_t d=0; d < maxDepth+1; d++)
@@ -0,0 +1,287 @@
+#include "SdfLib/IOctreeSdf.h"
+#include "SdfLib/utils/Compression.h"
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+#ifdef OPENMP_AVAILABLE
+#include <omp.h>
+#endif
+
+namespace sdflib
+{
+namespace
+{
+    // Type of each node record of the chunks node stream
+    enum NodeRecord : uint8_t
+    {
+        NEW_INNER = 0, // Followed by the records of its 8 children
+        SHARED_INNER = 1, // Followed by the distance to its children array
+        NEW_LEAF = 2, // Its coefficients are the next ones of the coefficients stream
+        SHARED_LEAF = 3, // Followed by the distance to its coefficients
+        EMPTY_LEAF = 4 // Leaf without coefficients
+    };
+    constexpr uint8_t RECORD_MARK_FLAG = 0x80;
+    constexpr uint32_t BYTES_PER_ELEMENT = sizeof(IOctreeSdf::OctreeNode);
+}
+
+bool IOctreeSdf::encodeOctreeChunks(uint32_t numCoefficients, std::vector<std::vector<uint8_t>>& outChunks) const
+{
+    if(hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The compressed format is not supported by octrees with segmented indices");
+        return false;
+    }
+
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+    outChunks.resize(startGridNumNodes);
+    std::atomic<uint64_t> totalBytes(0);
+    // The subtrees shared between start cells are expanded in each chunk, so the decoded array can be larger than the octree
+    std::atomic<uint64_t> decodedSize(startGridNumNodes);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int c=0; c < static_cast<int>(startGridNumNodes); c++)
+    {
+        std::vector<uint8_t> nodeStream;
+        std::vector<uint32_t> coefficients;
+        // Maps the arrays of the octree to their position in the chunk
+        std::unordered_map<uint32_t, uint64_t> arraysPositions;
+        uint64_t chunkSize = 0;
+
+        std::function<void(const OctreeNode&)> encodeNode;
+        encodeNode = [&](const OctreeNode& node)
+        {
+            const uint8_t markFlag = (node.isMarked()) ? RECORD_MARK_FLAG : 0;
+            const uint32_t index = node.getChildrenIndex();
+            const uint32_t arraySize = (node.isLeaf()) ? numCoefficients : 8;
+
+            if(node.isLeaf() && static_cast<uint64_t>(index) + numCoefficients > mOctreeData.size())
+            {
+                nodeStream.push_back(NodeRecord::EMPTY_LEAF | markFlag);
+                return;
+            }
+
+            auto it = arraysPositions.find(index);
+            if(it != arraysPositions.end())
+            {
+                nodeStream.push_back(((node.isLeaf()) ? NodeRecord::SHARED_LEAF : NodeRecord::SHARED_INNER) | markFlag);
+                Compression::writeVarint(chunkSize - it->second, nodeStream);
+                return;
+            }
+
+            arraysPositions[index] = chunkSize;
+            chunkSize += arraySize;
+            nodeStream.push_back(((node.isLeaf()) ? NodeRecord::NEW_LEAF : NodeRecord::NEW_INNER) | markFlag);
+            if(node.isLeaf())
+            {
+                for(uint32_t i=0; i < numCoefficients; i++) coefficients.push_back(mOctreeData[index + i].childrenIndex);
+            }
+            else
+            {
+                for(uint32_t i=0; i < 8; i++) encodeNode(mOctreeData[index + i]);
+            }
+        };
+
+        encodeNode(mOctreeData[c]);
+
+        std::vector<uint8_t>& chunk = outChunks[c];
+        chunk.clear();
+        Compression::writeVarint(chunkSize, chunk);
+
+        std::vector<uint8_t> block;
+        Compression::writeVarint(nodeStream.size(), chunk);
+        Compression::encodeBytes(nodeStream.data(), nodeStream.size(), block);
+        Compression::writeVarint(block.size(), chunk);
+        chunk.insert(chunk.end(), block.begin(), block.end());
+
+        // The planes of the floats bytes are coded separately, the signs and exponents compress much better than the mantissas
+        std::vector<uint8_t> planes(coefficients.size() * BYTES_PER_ELEMENT);
+        Compression::splitBytePlanes(reinterpret_cast<const uint8_t*>(coefficients.data()), coefficients.size(), BYTES_PER_ELEMENT, planes.data());
+        Compression::writeVarint(coefficients.size(), chunk);
+        for(uint32_t p=0; p < BYTES_PER_ELEMENT; p++)
+        {
+            block.clear();
+            Compression::encodeBytes(planes.data() + p * coefficients.size(), coefficients.size(), block);
+            Compression::writeVarint(block.size(), chunk);
+            chunk.insert(chunk.end(), block.begin(), block.end());
+        }
+
+        chunk.shrink_to_fit();
+        totalBytes += chunk.size();
+        decodedSize += chunkSize;
+    }
+
+    if(!OctreeNode::fitsIndex(0, decodedSize.load()))
+    {
+        SPDLOG_ERROR("The decoded octree array would exceed the maximum node index ({}), the octree has not been compressed", 
+                     OctreeNode::CHILDREN_INDEX_MASK);
+        outChunks.clear();
+        return false;
+    }
+
+    SPDLOG_INFO("Octree compressed from {}MB to {}MB in {} chunks",
+                mOctreeData.size() * sizeof(OctreeNode) / 1048576.0f, totalBytes.load() / 1048576.0f, startGridNumNodes);
+    return true;
+}
+
+bool IOctreeSdf::decodeOctreeChunks(uint32_t numCoefficients, const std::vector<std::vector<uint8_t>>& chunks)
+{
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+    if(chunks.size() != startGridNumNodes)
+    {
+        SPDLOG_ERROR("The number of chunks does not match the start grid");
+        return false;
+    }
+
+    // The chunks sizes give the position of each chunk in the array, so they can be decoded at the same time
+    std::vector<uint64_t> chunksStart(startGridNumNodes + 1);
+    chunksStart[0] = startGridNumNodes;
+    for(uint32_t c=0; c < startGridNumNodes; c++)
+    {
+        size_t position = 0;
+        uint64_t chunkSize;
+        if(!Compression::readVarint(chunks[c].data(), chunks[c].size(), position, chunkSize))
+        {
+            SPDLOG_ERROR("The chunk {} is corrupted", c);
+            return false;
+        }
+        chunksStart[c + 1] = chunksStart[c] + chunkSize;
+    }
+
+    if(!OctreeNode::fitsIndex(0, chunksStart.back()))
+    {
+        SPDLOG_ERROR("The decoded octree array cannot be addressed with the nodes indices");
+        return false;
+    }
+
+    mStartCellOffsets.clear();
+    mOctreeData.resize(chunksStart.back());
+
+    std::atomic<bool> valid(true);
+    #pragma omp parallel for schedule(dynamic)
+    for(int c=0; c < static_cast<int>(startGridNumNodes); c++)
+    {
+        const std::vector<uint8_t>& chunk = chunks[c];
+        const uint64_t chunkStart = chunksStart[c];
+        const uint64_t chunkSize = chunksStart[c + 1] - chunkStart;
+        size_t position = 0;
+        uint64_t value;
+
+        auto readBlock = [&](size_t size, uint8_t* outData)
+        {
+            uint64_t blockSize;
+            if(!Compression::readVarint(chunk.data(), chunk.size(), position, blockSize) ||
+               blockSize > chunk.size() - position) return false;
+            if(!Compression::decodeBytes(chunk.data() + position, blockSize, outData, size)) return false;
+            position += blockSize;
+            return true;
+        };
+
+        // Chunk size, already read
+        Compression::readVarint(chunk.data(), chunk.size(), position, value);
+
+        uint64_t nodeStreamSize;
+        if(!Compression::readVarint(chunk.data(), chunk.size(), position, nodeStreamSize)) { valid = false; continue; }
+        std::vector<uint8_t> nodeStream(nodeStreamSize);
+        if(!readBlock(nodeStream.size(), nodeStream.data())) { valid = false; continue; }
+
+        uint64_t numCoefficientsWords;
+        if(!Compression::readVarint(chunk.data(), chunk.size(), position, numCoefficientsWords)) { valid = false; continue; }
+        std::vector<uint8_t> planes(numCoefficientsWords * BYTES_PER_ELEMENT);
+        bool planesValid = true;
+        for(uint32_t p=0; p < BYTES_PER_ELEMENT && planesValid; p++)
+        {
+            planesValid = readBlock(numCoefficientsWords, planes.data() + p * numCoefficientsWords);
+        }
+        if(!planesValid) { valid = false; continue; }
+
+        std::vector<uint32_t> coefficients(numCoefficientsWords);
+        Compression::mergeBytePlanes(planes.data(), numCoefficientsWords, BYTES_PER_ELEMENT, reinterpret_cast<uint8_t*>(coefficients.data()));
+
+        // Rebuilds the subtree in the same order that it was encoded
+        size_t nodePosition = 0;
+        size_t coefficientsPosition = 0;
+        uint64_t usedSize = 0;
+        std::function<bool(uint64_t)> decodeNode;
+        decodeNode = [&](uint64_t nodeIndex) -> bool
+        {
+            if(nodePosition >= nodeStream.size()) return false;
+            const uint8_t record = nodeStream[nodePosition++];
+            const uint8_t type = record & ~RECORD_MARK_FLAG;
+            OctreeNode& node = mOctreeData[nodeIndex];
+
+            switch(type)
+            {
+                case NodeRecord::NEW_INNER:
+                case NodeRecord::NEW_LEAF:
+                {
+                    const bool isLeaf = type == NodeRecord::NEW_LEAF;
+                    const uint64_t arrayPosition = usedSize;
+                    usedSize += (isLeaf) ? numCoefficients : 8;
+                    if(usedSize > chunkSize) return false;
+                    node.setValues(isLeaf, static_cast<uint32_t>(chunkStart + arrayPosition));
+
+                    if(isLeaf)
+                    {
+                        if(coefficientsPosition + numCoefficients > coefficients.size()) return false;
+                        std::memcpy(&mOctreeData[chunkStart + arrayPosition], &coefficients[coefficientsPosition], numCoefficients * sizeof(uint32_t));
+                        coefficientsPosition += numCoefficients;
+                    }
+                    else
+                    {
+                        for(uint32_t i=0; i < 8; i++)
+                        {
+                            if(!decodeNode(chunkStart + arrayPosition + i)) return false;
+                        }
+                    }
+                    break;
+                }
+                case NodeRecord::SHARED_INNER:
+                case NodeRecord::SHARED_LEAF:
+                {
+                    uint64_t distance;
+                    if(!Compression::readVarint(nodeStream.data(), nodeStream.size(), nodePosition, distance) ||
+                       distance == 0 || distance > usedSize) return false;
+                    node.setValues(type == NodeRecord::SHARED_LEAF, static_cast<uint32_t>(chunkStart + usedSize - distance));
+                    break;
+                }
+                case NodeRecord::EMPTY_LEAF:
+                    node.setValues(true, OctreeNode::CHILDREN_INDEX_MASK);
+                    break;
+                default:
+                    return false;
+            }
+
+            if(record & RECORD_MARK_FLAG) mOctreeData[nodeIndex].markNode();
+            return true;
+        };
+
+        if(!decodeNode(c) || usedSize != chunkSize || coefficientsPosition != coefficients.size()) valid = false;
+    }
+
+    if(!valid)
+    {
+        SPDLOG_ERROR("The compressed octree is corrupted");
+        mOctreeData.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool IOctreeSdf::hasAddressableIndices() const
+{
+    if(!hasSegmentedIndices()) return OctreeNode::fitsIndex(0, mOctreeData.size());
+
+    // The local index 0 of each subtree is its start grid node, the rest are stored after its offset
+    for(size_t i=0; i < mStartCellOffsets.size(); i++)
+    {
+        const uint64_t end = (i + 1 < mStartCellOffsets.size()) ? mStartCellOffsets[i + 1] : mOctreeData.size() - 1;
+        if(!OctreeNode::fitsIndex(0, end - mStartCellOffsets[i] + 1)) return false;
+    }
+
+    return true;
+}
+}
@@ -0,0 +1,301 @@
+#include "SdfLib/MixedOctreeSdf.h"
+
+#include <functional>
+#include <limits>
+
+namespace sdflib
+{
+std::unique_ptr<MixedOctreeSdf> MixedOctreeSdf::fromOctrees(const TOctreeSdf<TriLinearInterpolation>& linearOctree,
+                                                            const TOctreeSdf<TriCubicInterpolation>& cubicOctree)
+{
+    if(linearOctree.hasSegmentedIndices() || cubicOctree.hasSegmentedIndices())
+    {
+        SPDLOG_ERROR("The mixed octree is not supported by octrees with segmented indices");
+        return std::unique_ptr<MixedOctreeSdf>();
+    }
+
+    if(linearOctree.hasSdfOnlyAtSurface() || cubicOctree.hasSdfOnlyAtSurface())
+    {
+        SPDLOG_ERROR("The mixed octree needs octrees storing the distance field in all the box");
+        return std::unique_ptr<MixedOctreeSdf>();
+    }
+
+    const BoundingBox& box = linearOctree.getGridBoundingBox();
+    if(linearOctree.getStartGridSize() != cubicOctree.getStartGridSize() ||
+       box.min != cubicOctree.getGridBoundingBox().min || box.max != cubicOctree.getGridBoundingBox().max)
+    {
+        SPDLOG_ERROR("The octrees must cover the same area with the same start grid");
+        return std::unique_ptr<MixedOctreeSdf>();
+    }
+
+    std::unique_ptr<MixedOctreeSdf> obj(new MixedOctreeSdf());
+    obj->mBox = box;
+    obj->mValueRange = glm::max(linearOctree.getOctreeValueRange(), cubicOctree.getOctreeValueRange());
+    obj->mMinBorderValue = glm::min(linearOctree.getOctreeMinBorderValue(), cubicOctree.getOctreeMinBorderValue());
+    obj->mFarFieldProxy = cubicOctree.getFarFieldProxy();
+    obj->mStartGridSize = linearOctree.getStartGridSize().x;
+    obj->mStartGridXY = obj->mStartGridSize * obj->mStartGridSize;
+    obj->mStartGridCellSize = obj->mBox.getSize().x / static_cast<float>(obj->mStartGridSize);
+    obj->mMaxDepth = glm::max(linearOctree.getOctreeMaxDepth(), cubicOctree.getOctreeMaxDepth());
+    obj->mSdfOnlyAySurface = false;
+
+    const LargeArray<OctreeNode>& linearData = linearOctree.getOctreeData();
+    const LargeArray<OctreeNode>& cubicData = cubicOctree.getOctreeData();
+    const uint32_t startGridNumNodes = obj->mStartGridSize * obj->mStartGridXY;
+
+    // Number of array elements needed by the subtree of each node, computed once per node
+    constexpr uint64_t UNKNOWN_COST = std::numeric_limits<uint64_t>::max();
+    std::vector<uint64_t> linearCosts(linearData.size(), UNKNOWN_COST);
+    std::vector<uint64_t> cubicCosts(cubicData.size(), UNKNOWN_COST);
+    std::function<uint64_t(const LargeArray<OctreeNode>&, std::vector<uint64_t>&, uint32_t, uint32_t)> getSubtreeCost;
+    getSubtreeCost = [&](const LargeArray<OctreeNode>& data, std::vector<uint64_t>& costs,
+                         uint32_t numCoefficients, uint32_t index) -> uint64_t
+    {
+        if(costs[index] != UNKNOWN_COST) return costs[index];
+
+        const OctreeNode node = data[index];
+        uint64_t cost = numCoefficients;
+        if(!node.isLeaf())
+        {
+            cost = 8;
+            for(uint32_t i=0; i < 8; i++) cost += getSubtreeCost(data, costs, numCoefficients, node.getChildrenIndex() + i);
+        }
+        costs[index] = cost;
+        return cost;
+    };
+
+    auto getLinearCost = [&](uint32_t index)
+    {
+        return getSubtreeCost(linearData, linearCosts, TriLinearInterpolation::NUM_COEFFICIENTS, index);
+    };
+    auto getCubicCost = [&](uint32_t index)
+    {
+        return getSubtreeCost(cubicData, cubicCosts, TriCubicInterpolation::NUM_COEFFICIENTS, index);
+    };
+
+    obj->mOctreeData.assign(startGridNumNodes, OctreeNode::getLeafNode());
+
+    // Copies a subtree of one of the octrees
+    std::function<void(const LargeArray<OctreeNode>&, uint32_t, uint32_t, uint32_t, bool)> copySubtree;
+    copySubtree = [&](const LargeArray<OctreeNode>& data, uint32_t oldIndex, uint32_t newIndex,
+                      uint32_t numCoefficients, bool isCubic)
+    {
+        const OctreeNode node = data[oldIndex];
+        if(!node.isLeaf())
+        {
+            const uint32_t childrenIndex = static_cast<uint32_t>(obj->mOctreeData.size());
+            obj->mOctreeData.resize(obj->mOctreeData.size() + 8);
+            obj->mOctreeData[newIndex].setValues(false, childrenIndex);
+            for(uint32_t i=0; i < 8; i++)
+            {
+                copySubtree(data, node.getChildrenIndex() + i, childrenIndex + i, numCoefficients, isCubic);
+            }
+        }
+        else
+        {
+            const uint32_t valuesIndex = static_cast<uint32_t>(obj->mOctreeData.size());
+            obj->mOctreeData.insert(obj->mOctreeData.end(), data.begin() + node.getChildrenIndex(),
+                                    data.begin() + node.getChildrenIndex() + numCoefficients);
+            obj->mOctreeData[newIndex].setValues(true, valuesIndex);
+            if(isCubic)
+            {
+                obj->mOctreeData[newIndex].markNode();
+                obj->mNumCubicLeaves++;
+            }
+            else obj->mNumLinearLeaves++;
+        }
+    };
+
+    // If both nodes are subdivided, merging their children is never worse than taking one of the subtrees.
+    // Otherwise, the cheapest subtree is taken, the trilinear one in case of a tie because its queries are faster.
+    std::function<void(uint32_t, uint32_t, uint32_t)> mergeNodes;
+    mergeNodes = [&](uint32_t linearIndex, uint32_t cubicIndex, uint32_t newIndex)
+    {
+        const OctreeNode linearNode = linearData[linearIndex];
+        const OctreeNode cubicNode = cubicData[cubicIndex];
+        if(!linearNode.isLeaf() && !cubicNode.isLeaf())
+        {
+            const uint32_t childrenIndex = static_cast<uint32_t>(obj->mOctreeData.size());
+            obj->mOctreeData.resize(obj->mOctreeData.size() + 8);
+            obj->mOctreeData[newIndex].setValues(false, childrenIndex);
+            for(uint32_t i=0; i < 8; i++)
+            {
+                mergeNodes(linearNode.getChildrenIndex() + i, cubicNode.getChildrenIndex() + i, childrenIndex + i);
+            }
+        }
+        else if(getLinearCost(linearIndex) <= getCubicCost(cubicIndex))
+        {
+            copySubtree(linearData, linearIndex, newIndex, TriLinearInterpolation::NUM_COEFFICIENTS, false);
+        }
+        else
+        {
+            copySubtree(cubicData, cubicIndex, newIndex, TriCubicInterpolation::NUM_COEFFICIENTS, true);
+        }
+    };
+
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        mergeNodes(i, i, i);
+    }
+
+    if(!obj->hasAddressableIndices())
+    {
+        SPDLOG_ERROR("The mixed octree array cannot be addressed with the nodes indices");
+        return std::unique_ptr<MixedOctreeSdf>();
+    }
+
+    obj->mOctreeData.shrink_to_fit();
+    SPDLOG_INFO("Mixed octree of {}MB from a trilinear octree of {}MB and a tricubic octree of {}MB, {} trilinear and {} tricubic leaves",
+                obj->mOctreeData.size() * sizeof(OctreeNode) / 1048576.0f,
+                linearData.size() * sizeof(OctreeNode) / 1048576.0f,
+                cubicData.size() * sizeof(OctreeNode) / 1048576.0f,
+                obj->mNumLinearLeaves, obj->mNumCubicLeaves);
+
+    return obj;
+}
+
+SdfFunction::MemoryUsage MixedOctreeSdf::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.nodesPerDepth.assign(mMaxDepth + 1, 0);
+    usage.leavesPerDepth.assign(mMaxDepth + 1, 0);
+
+    uint64_t numNodes = 0;
+    std::function<void(const OctreeNode&, uint32_t)> vistNode;
+    vistNode = [&](const OctreeNode& node, uint32_t depth)
+    {
+        usage.nodesPerDepth[depth]++;
+        if(node.isLeaf())
+        {
+            usage.leavesPerDepth[depth]++;
+            return;
+        }
+
+        numNodes += 8;
+        for(uint32_t i = 0; i < 8; i++)
+        {
+            vistNode(mOctreeData[node.getChildrenIndex() + i], depth + 1);
+        }
+    };
+
+    const uint32_t startDepth = glm::round(glm::log2(static_cast<float>(mStartGridSize)));
+    const uint32_t startGridNumNodes = mStartGridSize * mStartGridXY;
+    for(uint32_t i=0; i < startGridNumNodes; i++)
+    {
+        vistNode(mOctreeData[i], startDepth);
+    }
+
+    usage.addArray("nodes", (startGridNumNodes + numNodes) * sizeof(OctreeNode));
+    usage.addArray("trilinear coefficients", static_cast<size_t>(mNumLinearLeaves) * TriLinearInterpolation::NUM_COEFFICIENTS * sizeof(float));
+    usage.addArray("tricubic coefficients", static_cast<size_t>(mNumCubicLeaves) * TriCubicInterpolation::NUM_COEFFICIENTS * sizeof(float));
+    return usage;
+}
+
+float MixedOctreeSdf::getDistance(glm::vec3 sample) const
+{
+    auto roundFloat = [](float a) -> uint32_t
+    {
+        return (a >= 0.5f) ? 1 : 0;
+    };
+
+    glm::vec3 fracPart = (sample - mBox.min) / mStartGridCellSize;
+    glm::ivec3 startArrayPos = glm::floor(fracPart);
+    fracPart = glm::fract(fracPart);
+
+    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
+       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
+       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        return glm::max(mBox.getDistance(sample) + mMinBorderValue, mFarFieldProxy.getDistance(sample));
+    }
+
+    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+    uint32_t levels = 0;
+
+    while(!currentNode->isLeaf())
+    {
+        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) +
+                                  (roundFloat(fracPart.y) << 1) +
+                                   roundFloat(fracPart.x);
+
+        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        fracPart = glm::fract(2.0f * fracPart);
+        levels++;
+    }
+
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(levels + 1, glm::findMSB(mStartGridSize) + levels);
+
+    const OctreeNode* leafValues = &mOctreeData[currentNode->getChildrenIndex()];
+    if(currentNode->isMarked())
+    {
+        auto& values = *reinterpret_cast<const std::array<float, TriCubicInterpolation::NUM_COEFFICIENTS>*>(leafValues);
+        return TriCubicInterpolation::interpolateValue(values, fracPart);
+    }
+    else
+    {
+        auto& values = *reinterpret_cast<const std::array<float, TriLinearInterpolation::NUM_COEFFICIENTS>*>(leafValues);
+        return TriLinearInterpolation::interpolateValue(values, fracPart);
+    }
+}
+
+float MixedOctreeSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    auto roundFloat = [](float a) -> uint32_t
+    {
+        return (a >= 0.5f) ? 1 : 0;
+    };
+
+    glm::vec3 fracPart = (sample - mBox.min) / mStartGridCellSize;
+    glm::ivec3 startArrayPos = glm::floor(fracPart);
+    fracPart = glm::fract(fracPart);
+
+    if(startArrayPos.x < 0 || startArrayPos.x >= mStartGridSize ||
+       startArrayPos.y < 0 || startArrayPos.y >= mStartGridSize ||
+       startArrayPos.z < 0 || startArrayPos.z >= mStartGridSize)
+    {
+        if(mQueryStats.isEnabled()) mQueryStats.recordOutOfBox();
+        const float boxDist = mBox.getDistance(sample, outGradient) + mMinBorderValue;
+        glm::vec3 proxyGradient;
+        const float proxyDist = mFarFieldProxy.getDistance(sample, proxyGradient);
+        if(proxyDist > boxDist)
+        {
+            outGradient = proxyGradient;
+            return proxyDist;
+        }
+        return boxDist;
+    }
+
+    const OctreeNode* currentNode = &mOctreeData[startArrayPos.z * mStartGridXY + startArrayPos.y * mStartGridSize + startArrayPos.x];
+    uint32_t levels = 0;
+
+    while(!currentNode->isLeaf())
+    {
+        const uint32_t childIdx = (roundFloat(fracPart.z) << 2) +
+                                  (roundFloat(fracPart.y) << 1) +
+                                   roundFloat(fracPart.x);
+
+        currentNode = &mOctreeData[currentNode->getChildrenIndex() + childIdx];
+        fracPart = glm::fract(2.0f * fracPart);
+        levels++;
+    }
+
+    if(mQueryStats.isEnabled()) mQueryStats.recordQuery(levels + 1, glm::findMSB(mStartGridSize) + levels);
+
+    const OctreeNode* leafValues = &mOctreeData[currentNode->getChildrenIndex()];
+    if(currentNode->isMarked())
+    {
+        auto& values = *reinterpret_cast<const std::array<float, TriCubicInterpolation::NUM_COEFFICIENTS>*>(leafValues);
+        const float distance = TriCubicInterpolation::interpolateValueAndGradient(values, fracPart, outGradient);
+        outGradient = glm::normalize(outGradient);
+        return distance;
+    }
+    else
+    {
+        auto& values = *reinterpret_cast<const std::array<float, TriLinearInterpolation::NUM_COEFFICIENTS>*>(leafValues);
+        const float distance = TriLinearInterpolation::interpolateValueAndGradient(values, fracPart, outGradient);
+        outGradient = glm::normalize(outGradient);
+        return distance;
+    }
+}
+}
@@ -1,14 +1,186 @@
 #include "SdfLib/SdfFunction.h"
 
 #include "SdfLib/UniformGridSdf.h"
+#include "SdfLib/BrickMapSdf.h"
+#include "SdfLib/SparseUniformGridSdf.h"
 #include "SdfLib/OctreeSdf.h"
+#include "SdfLib/QuantizedOctreeSdf.h"
+#include "SdfLib/MortonOctreeSdf.h"
 #include "SdfLib/ExactOctreeSdf.h"
+#include "SdfLib/MixedOctreeSdf.h"
+#include "SdfLib/SdfSequence.h"
 #include "SdfLib/InterpolationMethods.h"
+#include "SdfLib/utils/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
 namespace sdflib
 {
-bool SdfFunction::saveToFile(const std::string& outputPath)
+namespace
+{
+    // Number of samples evaluated together by an asynchronous query task.
+    // It keeps the input and output arrays of a chunk inside the L1 cache.
+    constexpr size_t ASYNC_QUERY_CHUNK_SIZE = 1024;
+
+    struct AsyncQueryJob
+    {
+        std::promise<void> promise;
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<uint32_t> remainingTasks{0};
+        std::mutex exceptionMutex;
+        std::exception_ptr exception;
+    };
+}
+
+void SdfFunction::getDistances(const glm::vec3* samples, float* outDistances, size_t numSamples) const
+{
+    for(size_t i=0; i < numSamples; i++)
+    {
+        outDistances[i] = getDistance(samples[i]);
+    }
+}
+
+std::future<void> SdfFunction::getDistancesAsync(const glm::vec3* samples, float* outDistances, size_t numSamples,
+                                                 glm::vec3* outGradients) const
+{
+    std::shared_ptr<AsyncQueryJob> job = std::make_shared<AsyncQueryJob>();
+    std::future<void> future = job->promise.get_future();
+    if(numSamples == 0)
+    {
+        job->promise.set_value();
+        return future;
+    }
+
+    ThreadPool& pool = ThreadPool::getGlobalPool();
+    const size_t numChunks = (numSamples + ASYNC_QUERY_CHUNK_SIZE - 1) / ASYNC_QUERY_CHUNK_SIZE;
+    const uint32_t numTasks = static_cast<uint32_t>(std::min(numChunks, static_cast<size_t>(pool.getNumThreads())));
+    job->remainingTasks = numTasks;
+
+    // Each task takes chunks until the batch is finished
+    for(uint32_t t=0; t < numTasks; t++)
+    {
+        pool.submit([this, job, samples, outDistances, outGradients, numSamples, numChunks] ()
+        {
+            try
+            {
+                for(size_t c = job->nextChunk.fetch_add(1); c < numChunks; c = job->nextChunk.fetch_add(1))
+                {
+                    const size_t start = c * ASYNC_QUERY_CHUNK_SIZE;
+                    const size_t end = std::min(numSamples, start + ASYNC_QUERY_CHUNK_SIZE);
+                    if(outGradients != nullptr)
+                    {
+                        for(size_t i=start; i < end; i++)
+                        {
+                            outDistances[i] = getDistance(samples[i], outGradients[i]);
+                        }
+                    }
+                    else
+                    {
+                        getDistances(samples + start, outDistances + start, end - start);
+                    }
+                }
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(job->exceptionMutex);
+                if(!job->exception) job->exception = std::current_exception();
+                job->nextChunk = numChunks; // Stop the other tasks
+            }
+
+            if(job->remainingTasks.fetch_sub(1) == 1)
+            {
+                if(job->exception) job->promise.set_exception(job->exception);
+                else job->promise.set_value();
+            }
+        });
+    }
+
+    return future;
+}
+
+std::future<void> SdfFunction::getDistancesAsync(const std::vector<glm::vec3>& samples, std::vector<float>& outDistances) const
+{
+    outDistances.resize(samples.size());
+    return getDistancesAsync(samples.data(), outDistances.data(), samples.size());
+}
+
+namespace
+{
+    // Written before the format. The files saved without it store the structures with the layout of their version 0.
+    constexpr uint32_t FILE_TAG = 0x46445353;
+
+    // The versioned structures store their version in the archive, except in the files saved without the file tag
+    template<typename Sdf>
+    std::unique_ptr<SdfFunction> loadVersionedStructure(cereal::PortableBinaryInputArchive& archive, bool hasFileTag)
+    {
+        std::unique_ptr<Sdf> obj(new Sdf());
+        if(hasFileTag) archive(*obj);
+        else obj->load(archive, 0);
+        return obj;
+    }
+
+    template<typename Octree>
+    bool saveCompressedOctree(const Octree& octree, const std::string& outputPath)
+    {
+        // The file is only created once the octree has been encoded
+        std::vector<std::vector<uint8_t>> chunks;
+        if(!octree.encodeCompressed(chunks)) return false;
+
+        std::ofstream os(outputPath, std::ios::out | std::ios::binary);
+        if(!os.is_open())
+        {
+            SPDLOG_ERROR("Cannot open file {}", outputPath);
+            return false;
+        }
+        cereal::PortableBinaryOutputArchive archive(os);
+
+        SdfFunction::SdfFormat format = SdfFunction::SdfFormat::COMPRESSED_OCTREE;
+        SdfFunction::SdfFormat octreeFormat = octree.getFormat();
+        archive(FILE_TAG, format, octreeFormat);
+        octree.saveCompressed(archive, chunks);
+        return true;
+    }
+
+    template<typename Octree>
+    std::unique_ptr<SdfFunction> loadCompressedOctree(cereal::PortableBinaryInputArchive& archive)
+    {
+        std::unique_ptr<Octree> obj(new Octree());
+        if(!obj->loadCompressed(archive)) return std::unique_ptr<SdfFunction>();
+        return obj;
+    }
+}
+
+bool SdfFunction::saveToFile(const std::string& outputPath, bool compress)
 {
+    if(!isValid())
+    {
+        SPDLOG_ERROR("The structure has not been built correctly, it cannot be saved");
+        return false;
+    }
+
+    SdfFormat format = getFormat();
+
+    if(compress)
+    {
+        if(format == SdfFormat::TRILINEAR_OCTREE)
+        {
+            return saveCompressedOctree(*reinterpret_cast<TOctreeSdf<TriLinearInterpolation>*>(this), outputPath);
+        }
+        else if(format == SdfFormat::TRICUBIC_OCTREE)
+        {
+            return saveCompressedOctree(*reinterpret_cast<TOctreeSdf<TriCubicInterpolation>*>(this), outputPath);
+        }
+        else if(format == SdfFormat::TRIQUADRATIC_OCTREE)
+        {
+            return saveCompressedOctree(*reinterpret_cast<TOctreeSdf<TriQuadraticInterpolation>*>(this), outputPath);
+        }
+
+        SPDLOG_ERROR("The compressed format is only supported by the octrees");
+        return false;
+    }
+
     std::ofstream os(outputPath, std::ios::out | std::ios::binary);
     if(!os.is_open())
     {
@@ -16,7 +188,7 @@ bool SdfFunction::saveToFile(const std::string& outputPath)
         return false;
     }
     cereal::PortableBinaryOutputArchive archive(os);
-    SdfFormat format = getFormat();
+    archive(FILE_TAG);
 
     if(format == SdfFormat::GRID)
     {
@@ -38,6 +210,61 @@ bool SdfFunction::saveToFile(const std::string& outputPath)
         archive(format);
         archive(*reinterpret_cast<ExactOctreeSdf*>(this));
     }
+    else if(format == SdfFormat::TRILINEAR_QUANTIZED_OCTREE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TQuantizedOctreeSdf<TriLinearInterpolation>*>(this));
+    }
+    else if(format == SdfFormat::TRICUBIC_QUANTIZED_OCTREE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TQuantizedOctreeSdf<TriCubicInterpolation>*>(this));
+    }
+    else if(format == SdfFormat::TRILINEAR_MORTON_OCTREE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TMortonOctreeSdf<TriLinearInterpolation>*>(this));
+    }
+    else if(format == SdfFormat::TRICUBIC_MORTON_OCTREE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TMortonOctreeSdf<TriCubicInterpolation>*>(this));
+    }
+    else if(format == SdfFormat::BRICK_MAP)
+    {
+        archive(format);
+        archive(*reinterpret_cast<BrickMapSdf*>(this));
+    }
+    else if(format == SdfFormat::SPARSE_GRID)
+    {
+        archive(format);
+        archive(*reinterpret_cast<SparseUniformGridSdf*>(this));
+    }
+    else if(format == SdfFormat::TRIQUADRATIC_OCTREE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TOctreeSdf<TriQuadraticInterpolation>*>(this));
+    }
+    else if(format == SdfFormat::MIXED_OCTREE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<MixedOctreeSdf*>(this));
+    }
+    else if(format == SdfFormat::TRILINEAR_SEQUENCE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TSdfSequence<TriLinearInterpolation>*>(this));
+    }
+    else if(format == SdfFormat::TRICUBIC_SEQUENCE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TSdfSequence<TriCubicInterpolation>*>(this));
+    }
+    else if(format == SdfFormat::TRIQUADRATIC_SEQUENCE)
+    {
+        archive(format);
+        archive(*reinterpret_cast<TSdfSequence<TriQuadraticInterpolation>*>(this));
+    }
     else
     {
         SPDLOG_ERROR("Unknown format to save");
@@ -56,33 +283,103 @@ std::unique_ptr<SdfFunction> SdfFunction::loadFromFile(const std::string& inputP
         return std::unique_ptr<SdfFunction>();
     }
     cereal::PortableBinaryInputArchive archive(is);
-    SdfFunction::SdfFormat format = SdfFunction::SdfFormat::NONE;
-    archive(format);
+    uint32_t fileTag = 0;
+    archive(fileTag);
+
+    const bool hasFileTag = fileTag == FILE_TAG;
+    SdfFunction::SdfFormat format = static_cast<SdfFunction::SdfFormat>(fileTag);
+    if(hasFileTag) archive(format);
 
     if(format == SdfFormat::GRID)
     {
-        std::unique_ptr<UniformGridSdf> obj(new UniformGridSdf());
+        return loadVersionedStructure<UniformGridSdf>(archive, hasFileTag);
+    }
+    else if(format == SdfFormat::TRILINEAR_OCTREE)
+    {
+        return loadVersionedStructure<TOctreeSdf<TriLinearInterpolation>>(archive, hasFileTag);
+    }
+    else if(format == SdfFormat::TRICUBIC_OCTREE)
+    {
+        return loadVersionedStructure<TOctreeSdf<TriCubicInterpolation>>(archive, hasFileTag);
+    }
+    else if(format == SdfFormat::EXACT_OCTREE)
+    {
+        return loadVersionedStructure<ExactOctreeSdf>(archive, hasFileTag);
+    }
+    else if(format == SdfFormat::TRILINEAR_QUANTIZED_OCTREE)
+    {
+        std::unique_ptr<TQuantizedOctreeSdf<TriLinearInterpolation>> obj(new TQuantizedOctreeSdf<TriLinearInterpolation>());
         archive(*obj);
         return obj;
     }
-    else if(format == SdfFormat::TRILINEAR_OCTREE)
+    else if(format == SdfFormat::TRICUBIC_QUANTIZED_OCTREE)
     {
-        std::unique_ptr<TOctreeSdf<TriLinearInterpolation>> obj(new TOctreeSdf<TriLinearInterpolation>());
+        std::unique_ptr<TQuantizedOctreeSdf<TriCubicInterpolation>> obj(new TQuantizedOctreeSdf<TriCubicInterpolation>());
         archive(*obj);
         return obj;
     }
-    else if(format == SdfFormat::TRICUBIC_OCTREE)
+    else if(format == SdfFormat::TRILINEAR_MORTON_OCTREE)
     {
-        std::unique_ptr<TOctreeSdf<TriCubicInterpolation>> obj(new TOctreeSdf<TriCubicInterpolation>());
+        std::unique_ptr<TMortonOctreeSdf<TriLinearInterpolation>> obj(new TMortonOctreeSdf<TriLinearInterpolation>());
         archive(*obj);
         return obj;
     }
-    else if(format == SdfFormat::EXACT_OCTREE)
+    else if(format == SdfFormat::TRICUBIC_MORTON_OCTREE)
     {
-        std::unique_ptr<ExactOctreeSdf> obj(new ExactOctreeSdf());
+        std::unique_ptr<TMortonOctreeSdf<TriCubicInterpolation>> obj(new TMortonOctreeSdf<TriCubicInterpolation>());
         archive(*obj);
         return obj;
     }
+    else if(format == SdfFormat::BRICK_MAP)
+    {
+        std::unique_ptr<BrickMapSdf> obj(new BrickMapSdf());
+        archive(*obj);
+        return obj;
+    }
+    else if(format == SdfFormat::SPARSE_GRID)
+    {
+        std::unique_ptr<SparseUniformGridSdf> obj(new SparseUniformGridSdf());
+        archive(*obj);
+        return obj;
+    }
+    else if(format == SdfFormat::TRIQUADRATIC_OCTREE)
+    {
+        return loadVersionedStructure<TOctreeSdf<TriQuadraticInterpolation>>(archive, hasFileTag);
+    }
+    else if(format == SdfFormat::MIXED_OCTREE)
+    {
+        std::unique_ptr<MixedOctreeSdf> obj(new MixedOctreeSdf());
+        archive(*obj);
+        return obj;
+    }
+    else if(format == SdfFormat::TRILINEAR_SEQUENCE)
+    {
+        std::unique_ptr<TSdfSequence<TriLinearInterpolation>> obj(new TSdfSequence<TriLinearInterpolation>());
+        archive(*obj);
+        return obj;
+    }
+    else if(format == SdfFormat::TRICUBIC_SEQUENCE)
+    {
+        std::unique_ptr<TSdfSequence<TriCubicInterpolation>> obj(new TSdfSequence<TriCubicInterpolation>());
+        archive(*obj);
+        return obj;
+    }
+    else if(format == SdfFormat::TRIQUADRATIC_SEQUENCE)
+    {
+        std::unique_ptr<TSdfSequence<TriQuadraticInterpolation>> obj(new TSdfSequence<TriQuadraticInterpolation>());
+        archive(*obj);
+        return obj;
+    }
+    else if(format == SdfFormat::COMPRESSED_OCTREE)
+    {
+        archive(format);
+        if(format == SdfFormat::TRILINEAR_OCTREE) return loadCompressedOctree<TOctreeSdf<TriLinearInterpolation>>(archive);
+        else if(format == SdfFormat::TRICUBIC_OCTREE) return loadCompressedOctree<TOctreeSdf<TriCubicInterpolation>>(archive);
+        else if(format == SdfFormat::TRIQUADRATIC_OCTREE) return loadCompressedOctree<TOctreeSdf<TriQuadraticInterpolation>>(archive);
+
+        SPDLOG_ERROR("Unknown compressed octree format");
+        return std::unique_ptr<SdfFunction>();
+    }
     else
     {
         SPDLOG_ERROR("Unknown file format");
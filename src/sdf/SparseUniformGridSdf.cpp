@@ -0,0 +1,257 @@
+#include "SdfLib/SparseUniformGridSdf.h"
+#include "SdfLib/InterpolationMethods.h"
+#include "sdf/BlockGridUtils.h"
+
+#include <algorithm>
+#include <functional>
+
+#ifdef OPENMP_AVAILABLE
+#include <omp.h>
+#endif
+
+namespace sdflib
+{
+SparseUniformGridSdf::SparseUniformGridSdf(const Mesh& mesh, BoundingBox box, float cellSize, float bandWidth, uint32_t numThreads)
+{
+    if(!(cellSize > 0.0f))
+    {
+        SPDLOG_ERROR("The cell size of the sparse grid must be positive");
+        return;
+    }
+
+    // The exact octree is used to evaluate the samples
+    std::unique_ptr<ExactOctreeSdf> exactSdf = internal::buildBlocksSampler(mesh, box, cellSize * static_cast<float>(BLOCK_SIZE), 9u, numThreads);
+    if(exactSdf == nullptr)
+    {
+        SPDLOG_ERROR("The octree used to sample the blocks could not be built");
+        return;
+    }
+
+    initFromSdf(*exactSdf, box, cellSize, bandWidth, numThreads);
+}
+
+SparseUniformGridSdf::SparseUniformGridSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float bandWidth, uint32_t numThreads)
+{
+    initFromSdf(sdf, box, cellSize, bandWidth, numThreads);
+}
+
+void SparseUniformGridSdf::initFromSdf(const SdfFunction& sdf, BoundingBox box, float cellSize, float bandWidth, uint32_t numThreads)
+{
+    if(!(cellSize > 0.0f))
+    {
+        SPDLOG_ERROR("The cell size of the sparse grid must be positive");
+        return;
+    }
+
+    numThreads = glm::max(numThreads, 1u);
+    mCellSize = cellSize;
+    mBandWidth = bandWidth;
+
+    // The cells need two samples per axis, even if the box is flat
+    mGridSize = glm::max(glm::ivec3(glm::ceil((box.max - box.min) / cellSize)) + glm::ivec3(1), glm::ivec3(2));
+    mNumBlocks = (mGridSize + glm::ivec3(BLOCK_SIZE - 1)) / glm::ivec3(BLOCK_SIZE);
+    mBox.min = box.min;
+    mBox.max = box.min + mCellSize * glm::vec3(mGridSize - 1);
+    SPDLOG_INFO("Sparse uniform grid size: {}, {}, {}", mGridSize.x, mGridSize.y, mGridSize.z);
+
+    if(glm::any(glm::greaterThanEqual(mNumBlocks, glm::ivec3(1 << BITS_PER_AXIS))))
+    {
+        SPDLOG_ERROR("The grid is too big to be indexed");
+        return;
+    }
+
+    mBlockSigns.resize(static_cast<size_t>(mNumBlocks.x) * mNumBlocks.y * mNumBlocks.z, 0);
+    auto getBlockIndex = [&](glm::ivec3 blockPos)
+    {
+        return static_cast<size_t>(blockPos.z) * mNumBlocks.x * mNumBlocks.y + static_cast<size_t>(blockPos.y) * mNumBlocks.x + blockPos.x;
+    };
+
+    // Each thread stores the blocks it finds near the surface
+    std::vector<std::vector<uint64_t>> threadKeys(numThreads);
+    std::vector<std::vector<float>> threadSamples(numThreads);
+
+    // Recursive subdivision of the blocks area, the regions far from the surface are not sampled
+    const float blockLength = mCellSize * static_cast<float>(BLOCK_SIZE);
+    std::function<void(glm::ivec3, int, uint32_t)> processRegion;
+    processRegion = [&](glm::ivec3 regionMin, int regionSize, uint32_t threadId)
+    {
+        const glm::ivec3 regionMax = glm::min(regionMin + glm::ivec3(regionSize), mNumBlocks);
+        const float centerDist = sdf.getDistance(mBox.min + blockLength * (glm::vec3(regionMin) + 0.5f * static_cast<float>(regionSize)));
+        const uint8_t sign = (centerDist < 0.0f) ? 1 : 0;
+
+        if(internal::isRegionOutsideBand(centerDist, blockLength * static_cast<float>(regionSize), mBandWidth))
+        {
+            for(int k=regionMin.z; k < regionMax.z; k++)
+                for(int j=regionMin.y; j < regionMax.y; j++)
+                    for(int i=regionMin.x; i < regionMax.x; i++)
+                        mBlockSigns[getBlockIndex(glm::ivec3(i, j, k))] = sign;
+            return;
+        }
+
+        if(regionSize > 1)
+        {
+            const int childSize = regionSize / 2;
+            for(uint32_t c=0; c < 8; c++)
+            {
+                const glm::ivec3 childMin = regionMin + childSize * glm::ivec3(c & 1, (c >> 1) & 1, c >> 2);
+                if(glm::all(glm::lessThan(childMin, mNumBlocks)))
+                {
+                    processRegion(childMin, childSize, threadId);
+                }
+            }
+            return;
+        }
+
+        // Sample the block
+        mBlockSigns[getBlockIndex(regionMin)] = sign;
+        std::array<float, BLOCK_NUM_SAMPLES> samples;
+        bool insideBand = false;
+        const glm::vec3 blockStart = mBox.min + blockLength * glm::vec3(regionMin);
+        for(uint32_t k=0; k < BLOCK_SIZE; k++)
+        {
+            for(uint32_t j=0; j < BLOCK_SIZE; j++)
+            {
+                for(uint32_t i=0; i < BLOCK_SIZE; i++)
+                {
+                    const float dist = sdf.getDistance(blockStart + mCellSize * glm::vec3(i, j, k));
+                    insideBand = insideBand || glm::abs(dist) <= mBandWidth;
+                    samples[k * BLOCK_SIZE * BLOCK_SIZE + j * BLOCK_SIZE + i] = glm::clamp(dist, -mBandWidth, mBandWidth);
+                }
+            }
+        }
+
+        if(insideBand)
+        {
+            threadKeys[threadId].push_back(getBlockKey(regionMin));
+            threadSamples[threadId].insert(threadSamples[threadId].end(), samples.begin(), samples.end());
+        }
+    };
+
+    // The top regions are processed in parallel
+    constexpr int TOP_REGION_SIZE = 8;
+    const glm::ivec3 numTopRegions = (mNumBlocks + glm::ivec3(TOP_REGION_SIZE - 1)) / TOP_REGION_SIZE;
+    const int numRegions = numTopRegions.x * numTopRegions.y * numTopRegions.z;
+
+#ifdef OPENMP_AVAILABLE
+    omp_set_dynamic(0);
+    omp_set_num_threads(numThreads);
+#endif
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int r=0; r < numRegions; r++)
+    {
+#ifdef OPENMP_AVAILABLE
+        const uint32_t threadId = omp_get_thread_num();
+#else
+        const uint32_t threadId = 0;
+#endif
+        const glm::ivec3 regionPos(r % numTopRegions.x, (r / numTopRegions.x) % numTopRegions.y, r / (numTopRegions.x * numTopRegions.y));
+        processRegion(TOP_REGION_SIZE * regionPos, TOP_REGION_SIZE, threadId);
+    }
+
+    // Join the blocks and build the hash table
+    size_t numStoredBlocks = 0;
+    for(const std::vector<uint64_t>& keys : threadKeys) numStoredBlocks += keys.size();
+
+    uint32_t tableSize = 16;
+    while(tableSize < 2 * numStoredBlocks) tableSize <<= 1;
+    mTableMask = tableSize - 1;
+    mTableKeys.assign(tableSize, EMPTY_KEY);
+    mTableBlocks.assign(tableSize, 0);
+
+    mBlocks.resize(numStoredBlocks * BLOCK_NUM_SAMPLES);
+    uint32_t blockIndex = 0;
+    for(uint32_t t=0; t < numThreads; t++)
+    {
+        for(uint32_t b=0; b < threadKeys[t].size(); b++)
+        {
+            uint32_t slot = getTableSlot(threadKeys[t][b]);
+            while(mTableKeys[slot] != EMPTY_KEY) slot = (slot + 1) & mTableMask;
+            mTableKeys[slot] = threadKeys[t][b];
+            mTableBlocks[slot] = blockIndex;
+
+            std::copy(threadSamples[t].begin() + static_cast<size_t>(b) * BLOCK_NUM_SAMPLES,
+                      threadSamples[t].begin() + static_cast<size_t>(b + 1) * BLOCK_NUM_SAMPLES,
+                      mBlocks.begin() + static_cast<size_t>(blockIndex) * BLOCK_NUM_SAMPLES);
+            blockIndex++;
+        }
+        threadKeys[t] = std::vector<uint64_t>();
+        threadSamples[t] = std::vector<float>();
+    }
+
+    SPDLOG_INFO("Stored blocks: {} of {}", numStoredBlocks, mBlockSigns.size());
+}
+
+inline const float* SparseUniformGridSdf::findBlock(glm::ivec3 blockPos) const
+{
+    const uint64_t key = getBlockKey(blockPos);
+    for(uint32_t slot = getTableSlot(key); mTableKeys[slot] != EMPTY_KEY; slot = (slot + 1) & mTableMask)
+    {
+        if(mTableKeys[slot] == key) return &mBlocks[static_cast<size_t>(mTableBlocks[slot]) * BLOCK_NUM_SAMPLES];
+    }
+    return nullptr;
+}
+
+inline float SparseUniformGridSdf::getSample(glm::ivec3 samplePos) const
+{
+    const glm::ivec3 blockPos = samplePos / static_cast<int>(BLOCK_SIZE);
+    const float* block = findBlock(blockPos);
+    if(block == nullptr)
+    {
+        const size_t blockIndex = static_cast<size_t>(blockPos.z) * mNumBlocks.x * mNumBlocks.y + static_cast<size_t>(blockPos.y) * mNumBlocks.x + blockPos.x;
+        return (mBlockSigns[blockIndex]) ? -mBandWidth : mBandWidth;
+    }
+
+    const glm::ivec3 localPos = samplePos - static_cast<int>(BLOCK_SIZE) * blockPos;
+    return block[localPos.z * BLOCK_SIZE * BLOCK_SIZE + localPos.y * BLOCK_SIZE + localPos.x];
+}
+
+inline void SparseUniformGridSdf::getCellValues(glm::vec3 sample, std::array<float, 8>& outValues, glm::vec3& outFracPart) const
+{
+    const glm::vec3 pos = (sample - mBox.min) / mCellSize;
+    const glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(pos)), glm::ivec3(0), mGridSize - 2);
+    outFracPart = pos - glm::vec3(cell);
+
+    const glm::ivec3 localPos = cell % static_cast<int>(BLOCK_SIZE);
+    if(glm::all(glm::lessThan(localPos, glm::ivec3(BLOCK_SIZE - 1))))
+    {
+        // All the cell samples are in the same block
+        const glm::ivec3 blockPos = cell / static_cast<int>(BLOCK_SIZE);
+        const float* block = findBlock(blockPos);
+        if(block == nullptr)
+        {
+            const size_t blockIndex = static_cast<size_t>(blockPos.z) * mNumBlocks.x * mNumBlocks.y + static_cast<size_t>(blockPos.y) * mNumBlocks.x + blockPos.x;
+            outValues.fill((mBlockSigns[blockIndex]) ? -mBandWidth : mBandWidth);
+            return;
+        }
+
+        const float* values = block + localPos.z * BLOCK_SIZE * BLOCK_SIZE + localPos.y * BLOCK_SIZE + localPos.x;
+        for(uint32_t i=0; i < 8; i++)
+        {
+            outValues[i] = values[(i >> 2) * BLOCK_SIZE * BLOCK_SIZE + ((i >> 1) & 1) * BLOCK_SIZE + (i & 1)];
+        }
+    }
+    else
+    {
+        for(uint32_t i=0; i < 8; i++)
+        {
+            outValues[i] = getSample(cell + glm::ivec3(i & 1, (i >> 1) & 1, i >> 2));
+        }
+    }
+}
+
+float SparseUniformGridSdf::getDistance(glm::vec3 sample) const
+{
+    return internal::getGridDistance(sample, mBox, [&](glm::vec3 insideSample, std::array<float, 8>& values, glm::vec3& fracPart)
+    {
+        getCellValues(insideSample, values, fracPart);
+    });
+}
+
+float SparseUniformGridSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) const
+{
+    return internal::getGridDistance(sample, outGradient, mBox, [&](glm::vec3 insideSample, std::array<float, 8>& values, glm::vec3& fracPart)
+    {
+        getCellValues(insideSample, values, fracPart);
+    });
+}
+}
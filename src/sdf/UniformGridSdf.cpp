@@ -1,10 +1,15 @@
 #include "SdfLib/UniformGridSdf.h"
 #include "SdfLib/utils/TriangleUtils.h"
 #include "SdfLib/utils/UsefullSerializations.h"
+#include "SdfLib/InterpolationMethods.h"
 
 #include <iostream>
 #include <spdlog/spdlog.h>
 
+#ifdef OPENMP_AVAILABLE
+#include <omp.h>
+#endif
+
 namespace sdflib
 {
 UniformGridSdf::UniformGridSdf(const Mesh& mesh, BoundingBox box, uint32_t depth, 
@@ -116,4 +121,143 @@ float UniformGridSdf::getDistance(glm::vec3 sample, glm::vec3& outGradient) cons
     // TODO
     return 0.0f;
 }
+
+void UniformGridSdf::buildMipChain(uint32_t numLevels, uint32_t numThreads)
+{
+#ifdef OPENMP_AVAILABLE
+    omp_set_dynamic(0);
+    omp_set_num_threads(glm::max(numThreads, 1u));
+#endif
+
+    mMipGridSizes.clear();
+    mMipGrids.clear();
+
+    // Halves the resolution along one axis. The coarse value p takes the minimum of the finer values
+    // from 2p-2 to 2p+2, which are all the values of the coarse cells touching it.
+    auto minFilterAxis = [](const std::vector<float>& src, glm::ivec3 srcSize, int axis,
+                            std::vector<float>& dst, glm::ivec3& dstSize)
+    {
+        dstSize = srcSize;
+        dstSize[axis] = srcSize[axis] / 2 + 1;
+        dst.resize(dstSize.x * dstSize.y * dstSize.z);
+
+        const glm::ivec3 srcStride(1, srcSize.x, srcSize.x * srcSize.y);
+        const int numValues = static_cast<int>(dst.size());
+        #pragma omp parallel for schedule(static)
+        for(int i=0; i < numValues; i++)
+        {
+            const glm::ivec3 pos(i % dstSize.x, (i / dstSize.x) % dstSize.y, i / (dstSize.x * dstSize.y));
+            glm::ivec3 srcPos = pos;
+            srcPos[axis] = 0;
+            const int srcStart = srcPos.x * srcStride.x + srcPos.y * srcStride.y + srcPos.z * srcStride.z;
+
+            const int first = glm::max(2 * pos[axis] - 2, 0);
+            const int last = glm::min(2 * pos[axis] + 2, srcSize[axis] - 1);
+            float minValue = INFINITY;
+            for(int a=first; a <= last; a++)
+            {
+                minValue = glm::min(minValue, src[srcStart + a * srcStride[axis]]);
+            }
+            dst[i] = minValue;
+        }
+    };
+
+    std::vector<float> tempX;
+    std::vector<float> tempY;
+    for(uint32_t l=0; l < numLevels; l++)
+    {
+        const std::vector<float>& srcGrid = (l == 0) ? mGrid : mMipGrids.back();
+        const glm::ivec3 srcSize = (l == 0) ? mGridSize : mMipGridSizes.back();
+        if(srcSize.x < 5 || srcSize.y < 5 || srcSize.z < 5) break;
+
+        glm::ivec3 sizeX, sizeY, sizeZ;
+        std::vector<float> dstGrid;
+        minFilterAxis(srcGrid, srcSize, 0, tempX, sizeX);
+        minFilterAxis(tempX, sizeX, 1, tempY, sizeY);
+        minFilterAxis(tempY, sizeY, 2, dstGrid, sizeZ);
+
+        mMipGridSizes.push_back(sizeZ);
+        mMipGrids.push_back(std::move(dstGrid));
+    }
+
+    SPDLOG_INFO("Uniform grid mip chain with {} coarse levels", mMipGrids.size());
+}
+
+uint32_t UniformGridSdf::getMipLevelForFootprint(float footprint) const
+{
+    uint32_t level = 0;
+    while(level + 1 < getNumMipLevels() && getMipCellSize(level + 1) <= footprint) level++;
+    return level;
+}
+
+float UniformGridSdf::interpolateGrid(const std::vector<float>& grid, glm::ivec3 gridSize, float cellSize, glm::vec3 sample) const
+{
+    glm::vec3 fracPart = (sample - mBox.min) / cellSize;
+    const glm::ivec3 arrayPos = glm::clamp(glm::ivec3(glm::floor(fracPart)), glm::ivec3(0), gridSize - 2);
+    fracPart = glm::clamp(fracPart - glm::vec3(arrayPos), glm::vec3(0.0f), glm::vec3(1.0f));
+
+    const int gridXY = gridSize.x * gridSize.y;
+    const int index = arrayPos.z * gridXY + arrayPos.y * gridSize.x + arrayPos.x;
+    std::array<float, 8> values;
+    values[0] = grid[index];
+    values[1] = grid[index + 1];
+    values[2] = grid[index + gridSize.x];
+    values[3] = grid[index + gridSize.x + 1];
+    values[4] = grid[index + gridXY];
+    values[5] = grid[index + gridXY + 1];
+    values[6] = grid[index + gridXY + gridSize.x];
+    values[7] = grid[index + gridXY + gridSize.x + 1];
+
+    return TriLinearInterpolation::interpolateValue(values, fracPart);
+}
+
+float UniformGridSdf::getDistanceConservative(glm::vec3 sample, uint32_t level) const
+{
+    level = glm::min(level, getNumMipLevels() - 1);
+
+    // The distance field changes at most one unit per unit of distance
+    const glm::vec3 insideSample = glm::clamp(sample, mBox.min, mBox.max);
+    const float outsideDist = glm::length(sample - insideSample);
+
+    const float distance = (level == 0) ? interpolateGrid(mGrid, mGridSize, mCellSize, insideSample)
+                                        : interpolateGrid(mMipGrids[level - 1], mMipGridSizes[level - 1], getMipCellSize(level), insideSample);
+    return distance - outsideDist;
+}
+
+bool UniformGridSdf::rayMarch(glm::vec3 origin, glm::vec3 direction, float maxDistance, float& outDistance,
+                              float epsilon, uint32_t maxSteps, uint32_t* outNumSteps) const
+{
+    const uint32_t maxLevel = getNumMipLevels() - 1;
+    uint32_t level = maxLevel;
+    float t = 0.0f;
+    uint32_t step = 0;
+    bool hit = false;
+
+    for(; step < maxSteps && t <= maxDistance; step++)
+    {
+        const float dist = getDistanceConservative(origin + t * direction, level);
+
+        // Near the surface of a coarse level, the finer levels give a longer step
+        if(level > 0 && dist < getMipCellSize(level))
+        {
+            level--;
+            continue;
+        }
+
+        if(level == 0 && dist < epsilon)
+        {
+            hit = true;
+            break;
+        }
+
+        t += dist;
+
+        // Far from the surface, the coarser levels are cheaper and skip the empty space as well
+        if(level < maxLevel && dist > 2.0f * getMipCellSize(level + 1)) level++;
+    }
+
+    if(outNumSteps != nullptr) *outNumSteps = step;
+    outDistance = t;
+    return hit;
+}
 }
\ No newline at end of file
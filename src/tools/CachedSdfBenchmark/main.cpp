@@ -0,0 +1,117 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+#include "SdfLib/SdfFunction.h"
+#include "SdfLib/CachedSdf.h"
+#include "SdfLib/utils/Timer.h"
+
+using namespace sdflib;
+
+// Returns the time per query in microseconds
+float runQueries(const SdfFunction& sdf, const std::vector<glm::vec3>& samples, std::vector<float>& outDistances)
+{
+    outDistances.resize(samples.size());
+    Timer timer; timer.start();
+    for(uint32_t s=0; s < samples.size(); s++)
+    {
+        outDistances[s] = sdf.getDistance(samples[s]);
+    }
+    return (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(samples.size());
+}
+
+int main(int argc, char** argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Compares the queries of a structure with the same queries through the cache", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> sdfPathArg(parser, "sdf_path", "Sdf path");
+    args::ValueFlag<uint32_t> numSamplesArg(parser, "num_samples", "Number of samples of the stream", {'s', "num_samples"});
+    args::ValueFlag<float> quantumArg(parser, "quantum", "Size of the grid used to quantize the samples, by default a quarter of the smallest cell", {'q', "quantum"});
+    args::ValueFlag<uint32_t> numEntriesArg(parser, "num_entries", "Minimum number of entries of the cache", {"num_entries"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    std::unique_ptr<SdfFunction> loadedSdf = SdfFunction::loadFromFile(args::get(sdfPathArg));
+    if(loadedSdf == nullptr) return 1;
+    std::shared_ptr<SdfFunction> sdf(std::move(loadedSdf));
+
+    const uint32_t numSamples = (numSamplesArg) ? args::get(numSamplesArg) : 1000000;
+    const uint32_t numEntries = (numEntriesArg) ? args::get(numEntriesArg) : 1 << 20;
+    const BoundingBox box = sdf->getSampleArea();
+
+    float quantum = 1e-3f * box.getSize().x;
+    if(quantumArg) quantum = args::get(quantumArg);
+    else if(sdf->getMinCellSize() > 0.0f) quantum = 0.25f * sdf->getMinCellSize();
+    SPDLOG_INFO("Quantum: {}, smallest cell of the structure: {}", quantum, sdf->getMinCellSize());
+
+    // Small steps along random segments like a ray marcher, each segment is traversed twice
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    auto getRandomPoint = [&]() -> glm::vec3
+    {
+        return box.min + glm::vec3(dis(gen), dis(gen), dis(gen)) * box.getSize();
+    };
+
+    std::vector<glm::vec3> samples;
+    samples.reserve(numSamples);
+    const float stepSize = box.getSize().x / 1024.0f;
+    while(samples.size() < numSamples)
+    {
+        const glm::vec3 start = getRandomPoint();
+        const glm::vec3 dir = glm::normalize(getRandomPoint() - start);
+        for(uint32_t pass=0; pass < 2; pass++)
+        {
+            glm::vec3 p = start;
+            for(uint32_t i=0; i < 128 && samples.size() < numSamples; i++)
+            {
+                p = glm::clamp(p + stepSize * dir, box.min, box.max);
+                samples.push_back(p);
+            }
+        }
+    }
+
+    std::vector<float> directDist;
+    const float directTime = runQueries(*sdf, samples, directDist);
+    SPDLOG_INFO("Direct queries: {}us per query", directTime);
+
+    CachedSdf cachedSdf(sdf, quantum, numEntries);
+    std::vector<float> coldDist, warmDist;
+    const float coldTime = runQueries(cachedSdf, samples, coldDist);
+    SPDLOG_INFO("Cached queries, empty cache: {}us per query, hit rate {}", coldTime, cachedSdf.getHitRate());
+
+    cachedSdf.resetHitRate();
+    const float warmTime = runQueries(cachedSdf, samples, warmDist);
+    SPDLOG_INFO("Cached queries, filled cache: {}us per query, hit rate {}", warmTime, cachedSdf.getHitRate());
+
+    // The snapped samples are at most sqrt(3)/2 * quantum away from the queried ones, that is the error without
+    // the gradient correction. The corrected hits should stay well below it except where the gradient is not continuous.
+    const float maxExpectedError = 0.5f * glm::sqrt(3.0f) * quantum;
+    float maxError = 0.0f;
+    double meanError = 0.0;
+    uint32_t numOverBound = 0;
+    for(uint32_t s=0; s < samples.size(); s++)
+    {
+        const float error = glm::max(glm::abs(coldDist[s] - directDist[s]), glm::abs(warmDist[s] - directDist[s]));
+        maxError = glm::max(maxError, error);
+        meanError += static_cast<double>(error);
+        if(error > maxExpectedError) numOverBound++;
+    }
+
+    SPDLOG_INFO("Cached distances error: max {}, mean {}, snapping error {}", maxError, meanError / static_cast<double>(samples.size()), maxExpectedError);
+    SPDLOG_INFO("{} queries have an error greater than the snapping error", numOverBound);
+
+    return 0;
+}
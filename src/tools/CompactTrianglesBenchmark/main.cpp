@@ -0,0 +1,111 @@
+#include <random>
+#include <vector>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+#include "SdfLib/SdfFunction.h"
+#include "SdfLib/ExactOctreeSdf.h"
+#include "SdfLib/utils/Timer.h"
+
+using namespace sdflib;
+
+struct StreamResult
+{
+    float singleTime;
+    float batchTime;
+    std::vector<float> distances;
+};
+
+StreamResult runStream(const ExactOctreeSdf& octree, const std::vector<glm::vec3>& samples)
+{
+    StreamResult result;
+    result.distances.resize(samples.size());
+
+    Timer timer; timer.start();
+    for(uint32_t s=0; s < samples.size(); s++)
+    {
+        result.distances[s] = octree.getDistance(samples[s]);
+    }
+    result.singleTime = (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(samples.size());
+
+    std::vector<float> batchDistances(samples.size());
+    timer.start();
+    octree.getDistances(samples.data(), batchDistances.data(), samples.size());
+    result.batchTime = (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(samples.size());
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Compares the memory and the query time of the exact octree using the full and the compact triangles or nodes encoding", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> sdfPathArg(parser, "sdf_path", "Exact octree sdf path");
+    args::ValueFlag<uint32_t> numSamplesArg(parser, "num_samples", "Number of samples", {'s', "num_samples"});
+    args::Flag nodesArg(parser, "nodes", "Compare the nodes encodings instead of the triangles encodings", {"nodes"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    std::unique_ptr<SdfFunction> sdf = SdfFunction::loadFromFile(args::get(sdfPathArg));
+    if(sdf == nullptr) return 1;
+
+    if(sdf->getFormat() != SdfFunction::SdfFormat::EXACT_OCTREE)
+    {
+        SPDLOG_ERROR("The benchmark only supports the exact octree format");
+        return 1;
+    }
+
+    ExactOctreeSdf& octree = *reinterpret_cast<ExactOctreeSdf*>(sdf.get());
+    const bool compareNodes = args::get(nodesArg);
+    if((compareNodes) ? octree.hasCompactNodes() : octree.hasCompactTrianglesData())
+    {
+        SPDLOG_ERROR("The exact octree must be stored with the full {} encoding", (compareNodes) ? "nodes" : "triangles");
+        return 1;
+    }
+
+    const uint32_t numSamples = (numSamplesArg) ? args::get(numSamplesArg) : 1000000;
+    const BoundingBox box = octree.getSampleArea();
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    std::vector<glm::vec3> samples(numSamples);
+    std::generate(samples.begin(), samples.end(), [&]()
+    {
+        return box.min + glm::vec3(dis(gen), dis(gen), dis(gen)) * box.getSize();
+    });
+
+    const size_t fullMemory = (compareNodes) ? octree.getOctreeNodesMemory() : octree.getTrianglesDataMemory();
+    StreamResult full = runStream(octree, samples);
+
+    if(compareNodes) octree.compactOctreeNodes();
+    else octree.compactTrianglesData();
+    const size_t compactMemory = (compareNodes) ? octree.getOctreeNodesMemory() : octree.getTrianglesDataMemory();
+    StreamResult compact = runStream(octree, samples);
+
+    float maxDiff = 0.0f;
+    uint32_t signChanges = 0;
+    for(uint32_t s=0; s < numSamples; s++)
+    {
+        maxDiff = glm::max(maxDiff, glm::abs(glm::abs(full.distances[s]) - glm::abs(compact.distances[s])));
+        if((full.distances[s] < 0.0f) != (compact.distances[s] < 0.0f)) signChanges++;
+    }
+
+    const char* encodingName = (compareNodes) ? "nodes" : "triangles";
+    SPDLOG_INFO("Full {}: {}MB, {}us per query, {}us per batched query", 
+                encodingName, fullMemory / 1048576.0f, full.singleTime, full.batchTime);
+    SPDLOG_INFO("Compact {}: {}MB, {}us per query, {}us per batched query", 
+                encodingName, compactMemory / 1048576.0f, compact.singleTime, compact.batchTime);
+    SPDLOG_INFO("Max distance difference {}, {} sign changes", maxDiff, signChanges);
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <random>
+#include <vector>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+#include "SdfLib/RealSdf.h"
+#include "SdfLib/OctreeSdf.h"
+#include "SdfLib/ExactOctreeSdf.h"
+#include "SdfLib/QuantizedOctreeSdf.h"
+#include "SdfLib/MortonOctreeSdf.h"
+#include "SdfLib/MixedOctreeSdf.h"
+#include "SdfLib/utils/Mesh.h"
+#include "SdfLib/utils/FarFieldProxy.h"
+#include "SdfLib/utils/Timer.h"
+
+using namespace sdflib;
+
+int main(int argc, char** argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Checks that the far-field proxy is a lower bound of the mesh distance and that the structures use it outside their box", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> modelPathArg(parser, "model_path", "Mesh model path");
+    args::ValueFlag<uint32_t> numSamplesArg(parser, "num_samples", "Number of samples outside the mesh bounding box", {'s', "num_samples"});
+    args::ValueFlag<uint32_t> depthArg(parser, "depth", "Max depth of the structures checked outside their box", {'d', "depth"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    Mesh mesh(args::get(modelPathArg));
+    const BoundingBox meshBox = mesh.getBoundingBox();
+    const glm::vec3 meshSize = meshBox.getSize();
+    const float maxSize = glm::max(glm::max(meshSize.x, meshSize.y), meshSize.z);
+
+    FarFieldProxy proxy(mesh);
+    RealSdf realSdf(mesh);
+
+    // Sample points outside the mesh bounding box, up to two model sizes away
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<float> dis(-2.5f, 2.5f);
+    const uint32_t numSamples = (numSamplesArg) ? args::get(numSamplesArg) : 10000;
+    std::vector<glm::vec3> samples;
+    samples.reserve(numSamples);
+    while(samples.size() < numSamples)
+    {
+        const glm::vec3 p = meshBox.getCenter() + maxSize * glm::vec3(dis(gen), dis(gen), dis(gen));
+        if(meshBox.getDistance(p) > 0.0f) samples.push_back(p);
+    }
+
+    Timer timer; timer.start();
+    std::vector<float> proxyDist(numSamples);
+    for(uint32_t i=0; i < numSamples; i++)
+    {
+        proxyDist[i] = proxy.getDistance(samples[i]);
+    }
+    const float proxyTime = timer.getElapsedMicroseconds() / static_cast<float>(numSamples);
+
+    uint32_t numViolations = 0;
+    float proxyRatio = 0.0f;
+    float boxRatio = 0.0f;
+    for(uint32_t i=0; i < numSamples; i++)
+    {
+        const float dist = glm::abs(realSdf.getDistance(samples[i]));
+        if(proxyDist[i] > dist + 1e-5f * maxSize)
+        {
+            numViolations++;
+            SPDLOG_ERROR("Bound violated at ({}, {}, {}): proxy {} > distance {}", 
+                         samples[i].x, samples[i].y, samples[i].z, proxyDist[i], dist);
+        }
+
+        proxyRatio += proxyDist[i] / dist;
+        boxRatio += meshBox.getDistance(samples[i]) / dist;
+    }
+
+    SPDLOG_INFO("Proxy query time: {}us", proxyTime);
+    SPDLOG_INFO("Mean proxy bound / distance: {}", proxyRatio / static_cast<float>(numSamples));
+    SPDLOG_INFO("Mean mesh box bound / distance: {}", boxRatio / static_cast<float>(numSamples));
+    SPDLOG_INFO("Bound violations: {}", numViolations);
+
+    // The structures must return the maximum of the box bound and the proxy bound outside their box
+    BoundingBox box = meshBox;
+    box.addMargin(0.1f * maxSize);
+    const uint32_t depth = (depthArg) ? args::get(depthArg) : 5;
+    TOctreeSdf<TriLinearInterpolation> linearOctree(mesh, box, depth, 3);
+    TOctreeSdf<TriCubicInterpolation> cubicOctree(mesh, box, depth, 3);
+    ExactOctreeSdf exactOctree(mesh, box, depth, 3, 32);
+    // The quantization error is not relevant outside the box
+    std::unique_ptr<QuantizedOctreeSdf> quantizedOctree = QuantizedOctreeSdf::fromOctree(linearOctree, QuantizedOctreeSdf::QUANTIZED_16BIT, INFINITY);
+    std::unique_ptr<MortonOctreeSdf> mortonOctree = MortonOctreeSdf::fromOctree(linearOctree);
+    std::unique_ptr<MixedOctreeSdf> mixedOctree = MixedOctreeSdf::fromOctrees(linearOctree, cubicOctree);
+
+    uint32_t numMismatches = 0;
+    auto checkOutOfBoxQueries = [&](const std::string& name, const SdfFunction* sdf, const BoundingBox& sdfBox, 
+                                    float borderValue, const FarFieldProxy& sdfProxy)
+    {
+        if(sdf == nullptr)
+        {
+            SPDLOG_ERROR("{} could not be built", name);
+            numMismatches++;
+            return;
+        }
+
+        const uint32_t numStructureSamples = 64;
+        uint32_t numProxySamples = 0;
+        for(uint32_t s=0; s < numStructureSamples;)
+        {
+            const glm::vec3 p = meshBox.getCenter() + maxSize * glm::vec3(dis(gen), dis(gen), dis(gen));
+            if(sdfBox.getDistance(p) <= 1e-3f * maxSize) continue;
+            s++;
+
+            const float boxDist = sdfBox.getDistance(p) + borderValue;
+            glm::vec3 proxyGradient;
+            const float proxyDist = sdfProxy.getDistance(p, proxyGradient);
+
+            glm::vec3 gradient;
+            const float dist = sdf->getDistance(p, gradient);
+            const float distNoGradient = sdf->getDistance(p);
+            const float expectedDist = glm::max(boxDist, proxyDist);
+            bool correct = glm::abs(dist - expectedDist) <= 1e-5f * maxSize &&
+                           glm::abs(distNoGradient - expectedDist) <= 1e-5f * maxSize;
+
+            // The gradient of the box bound is not checked, each structure computes it with its own convention
+            if(proxyDist > boxDist)
+            {
+                numProxySamples++;
+                correct = correct && glm::length(gradient - proxyGradient) <= 1e-5f;
+            }
+
+            if(!correct)
+            {
+                numMismatches++;
+                SPDLOG_ERROR("{} at ({}, {}, {}): distance {} ({}) != max(box {}, proxy {}), gradient ({}, {}, {})",
+                             name, p.x, p.y, p.z, dist, distNoGradient, boxDist, proxyDist, gradient.x, gradient.y, gradient.z);
+            }
+        }
+
+        SPDLOG_INFO("{}: {} samples outside the box, {} bounded by the proxy", name, numStructureSamples, numProxySamples);
+    };
+
+    checkOutOfBoxQueries("Trilinear octree", &linearOctree, linearOctree.getGridBoundingBox(),
+                         linearOctree.getOctreeMinBorderValue(), linearOctree.getFarFieldProxy());
+    checkOutOfBoxQueries("Tricubic octree", &cubicOctree, cubicOctree.getGridBoundingBox(),
+                         cubicOctree.getOctreeMinBorderValue(), cubicOctree.getFarFieldProxy());
+    // The exact octree does not add a border value to the box bound
+    checkOutOfBoxQueries("Exact octree", &exactOctree, exactOctree.getGridBoundingBox(),
+                         0.0f, exactOctree.getFarFieldProxy());
+    // The derived structures keep the box, the border value and the proxy of their octree
+    checkOutOfBoxQueries("Quantized octree", quantizedOctree.get(), linearOctree.getGridBoundingBox(),
+                         linearOctree.getOctreeMinBorderValue(), linearOctree.getFarFieldProxy());
+    checkOutOfBoxQueries("Morton octree", mortonOctree.get(), linearOctree.getGridBoundingBox(),
+                         linearOctree.getOctreeMinBorderValue(), linearOctree.getFarFieldProxy());
+    // The mixed octree takes the smallest border value and the proxy of the tricubic octree
+    checkOutOfBoxQueries("Mixed octree", mixedOctree.get(), cubicOctree.getGridBoundingBox(),
+                         glm::min(linearOctree.getOctreeMinBorderValue(), cubicOctree.getOctreeMinBorderValue()), 
+                         cubicOctree.getFarFieldProxy());
+
+    SPDLOG_INFO("Structure mismatches: {}", numMismatches);
+
+    return (numViolations == 0 && numMismatches == 0) ? 0 : 1;
+}
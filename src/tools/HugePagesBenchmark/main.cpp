@@ -0,0 +1,189 @@
+#include <random>
+#include <vector>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+#include "SdfLib/SdfFunction.h"
+#include "SdfLib/ExactOctreeSdf.h"
+#include "SdfLib/utils/HugePageAllocator.h"
+#include "SdfLib/utils/Timer.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+using namespace sdflib;
+
+// Counts the data TLB misses of the calling thread, if the system allows it
+class TlbMissCounter
+{
+public:
+    TlbMissCounter()
+    {
+    #ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(perf_event_attr));
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(perf_event_attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        mFd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    #endif
+    }
+
+    ~TlbMissCounter()
+    {
+    #ifdef __linux__
+        if(mFd >= 0) close(mFd);
+    #endif
+    }
+
+    bool isAvailable() const { return mFd >= 0; }
+
+    void start()
+    {
+    #ifdef __linux__
+        if(mFd < 0) return;
+        ioctl(mFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+    #endif
+    }
+
+    uint64_t stop()
+    {
+        uint64_t count = 0;
+    #ifdef __linux__
+        if(mFd < 0) return 0;
+        ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(mFd, &count, sizeof(uint64_t)) != sizeof(uint64_t)) count = 0;
+    #endif
+        return count;
+    }
+
+private:
+    int mFd = -1;
+};
+
+struct StreamResult
+{
+    float queryTime;
+    float tlbMissesPerQuery;
+    std::vector<float> distances;
+};
+
+StreamResult runStream(const ExactOctreeSdf& octree, const std::vector<glm::vec3>& samples)
+{
+    StreamResult result;
+    result.distances.resize(samples.size());
+
+    TlbMissCounter counter;
+    Timer timer;
+    counter.start();
+    timer.start();
+    for(uint32_t s=0; s < samples.size(); s++)
+    {
+        result.distances[s] = octree.getDistance(samples[s]);
+    }
+    result.queryTime = (timer.getElapsedSeconds() * 1.0e9f) / static_cast<float>(samples.size());
+    const uint64_t tlbMisses = counter.stop();
+    result.tlbMissesPerQuery = (counter.isAvailable()) ? static_cast<float>(tlbMisses) / static_cast<float>(samples.size()) : -1.0f;
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Compares the query time and the TLB misses of the exact octree allocated with and without huge pages", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> sdfPathArg(parser, "sdf_path", "Exact octree sdf path");
+    args::ValueFlag<uint32_t> numSamplesArg(parser, "num_samples", "Number of samples", {'s', "num_samples"});
+    args::Flag lockArg(parser, "lock", "Also lock the huge pages in memory", {"lock"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    const uint32_t numSamples = (numSamplesArg) ? args::get(numSamplesArg) : 1000000;
+    const LargeArrayPolicy policies[2] =
+    {
+        LargeArrayPolicy::DEFAULT,
+        (args::get(lockArg)) ? LargeArrayPolicy::HUGE_PAGES_LOCKED : LargeArrayPolicy::HUGE_PAGES
+    };
+    const char* policiesNames[2] = { "Default pages", "Huge pages" };
+
+    std::vector<glm::vec3> samples;
+    std::vector<float> referenceDistances;
+    for(uint32_t p=0; p < 2; p++)
+    {
+        // The structure is loaded again, so its arrays are allocated with the policy
+        setLargeArrayPolicy(policies[p]);
+        std::unique_ptr<SdfFunction> sdf = SdfFunction::loadFromFile(args::get(sdfPathArg));
+        if(sdf == nullptr) return 1;
+
+        if(sdf->getFormat() != SdfFunction::SdfFormat::EXACT_OCTREE)
+        {
+            SPDLOG_ERROR("The benchmark only supports the exact octree format");
+            return 1;
+        }
+
+        const ExactOctreeSdf& octree = *reinterpret_cast<ExactOctreeSdf*>(sdf.get());
+
+        // Random queries spread over the whole structure, so most of them touch a different page
+        if(samples.empty())
+        {
+            const BoundingBox box = octree.getSampleArea();
+            std::mt19937 gen(2222);
+            std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+            samples.resize(numSamples);
+            std::generate(samples.begin(), samples.end(), [&]()
+            {
+                return box.min + glm::vec3(dis(gen), dis(gen), dis(gen)) * box.getSize();
+            });
+        }
+
+        StreamResult result = runStream(octree, samples);
+
+        if(result.tlbMissesPerQuery >= 0.0f)
+        {
+            SPDLOG_INFO("{}: {}ns per query, {} dTLB misses per query", policiesNames[p], result.queryTime, result.tlbMissesPerQuery);
+        }
+        else
+        {
+            SPDLOG_INFO("{}: {}ns per query, the dTLB misses are not available", policiesNames[p], result.queryTime);
+        }
+
+        if(p == 0)
+        {
+            referenceDistances = std::move(result.distances);
+        }
+        else
+        {
+            uint32_t numDifferences = 0;
+            for(uint32_t s=0; s < numSamples; s++)
+            {
+                if(referenceDistances[s] != result.distances[s]) numDifferences++;
+            }
+            SPDLOG_INFO("{} different results", numDifferences);
+        }
+    }
+
+    setLargeArrayPolicy(LargeArrayPolicy::DEFAULT);
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <random>
+#include <vector>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <memory>
+
+#include "SdfLib/OctreeSdf.h"
+#include "SdfLib/ExactOctreeSdf.h"
+#include "SdfLib/MixedOctreeSdf.h"
+#include "SdfLib/utils/Mesh.h"
+#include "SdfLib/utils/Timer.h"
+
+using namespace sdflib;
+
+struct BenchmarkConfig
+{
+    BoundingBox box;
+    uint32_t depth;
+    uint32_t startDepth;
+    IOctreeSdf::TerminationRule terminationRule;
+    IOctreeSdf::TerminationRuleParams terminationRuleParams;
+    uint32_t numThreads;
+};
+
+void printResults(const std::string& name, const SdfFunction& sdf, float buildTime,
+                  const std::vector<glm::vec3>& samples, const std::vector<float>& exactDistances)
+{
+    Timer timer;
+    std::vector<float> distances(samples.size());
+    timer.start();
+    for(uint32_t s=0; s < samples.size(); s++)
+    {
+        distances[s] = sdf.getDistance(samples[s]);
+    }
+    const float queryTime = (timer.getElapsedSeconds() * 1.0e9f) / static_cast<float>(samples.size());
+
+    double rmse = 0.0;
+    float maxError = 0.0f;
+    for(uint32_t s=0; s < samples.size(); s++)
+    {
+        const float error = glm::abs(distances[s] - exactDistances[s]);
+        rmse += static_cast<double>(error * error);
+        maxError = glm::max(maxError, error);
+    }
+    rmse = glm::sqrt(rmse / static_cast<double>(samples.size()));
+
+    const SdfFunction::MemoryUsage memoryUsage = sdf.getMemoryUsage();
+    uint64_t numLeaves = 0;
+    for(uint64_t leaves : memoryUsage.leavesPerDepth) numLeaves += leaves;
+
+    SPDLOG_INFO("{}: {}MB, {} leaves, built in {}s, {}ns per query, RMSE {}, max error {}",
+                name, memoryUsage.getTotalBytes() / 1048576.0f, numLeaves, buildTime, queryTime, rmse, maxError);
+}
+
+template<typename InterpolationMethod>
+std::unique_ptr<TOctreeSdf<InterpolationMethod>> runBenchmark(const std::string& name, const Mesh& mesh, const BenchmarkConfig& config,
+                                                              const std::vector<glm::vec3>& samples, const std::vector<float>& exactDistances)
+{
+    Timer timer; timer.start();
+    std::unique_ptr<TOctreeSdf<InterpolationMethod>> octree(new TOctreeSdf<InterpolationMethod>(
+                                           mesh, config.box, config.depth, config.startDepth,
+                                           config.terminationRule, config.terminationRuleParams,
+                                           IOctreeSdf::InitAlgorithm::CONTINUITY, config.numThreads));
+    const float buildTime = timer.getElapsedSeconds();
+
+    printResults(name, *octree, buildTime, samples, exactDistances);
+    return octree;
+}
+
+int main(int argc, char** argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Compares the memory, the build time and the query time of the octree interpolation methods built with the same error threshold", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> modelPathArg(parser, "model_path", "The model path");
+    args::ValueFlag<uint32_t> depthArg(parser, "depth", "The octree max depth", {'d', "depth"});
+    args::ValueFlag<uint32_t> startDepthArg(parser, "start_depth", "The octree start depth", {"start_depth"});
+    args::ValueFlag<float> terminationThresholdArg(parser, "termination_threshold", "The error threshold of the trapezoidal termination rule", {"termination_threshold"});
+    args::ValueFlag<uint32_t> numSamplesArg(parser, "num_samples", "Number of samples", {'s', "num_samples"});
+    args::ValueFlag<uint32_t> numThreadsArg(parser, "num_threads", "Number of threads used in the construction", {"num_threads"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    Mesh mesh(args::get(modelPathArg));
+    BoundingBox box = mesh.getBoundingBox();
+    const glm::vec3 modelBBSize = box.getSize();
+    box.addMargin(0.2f * glm::max(glm::max(modelBBSize.x, modelBBSize.y), modelBBSize.z));
+
+    // All the methods are built with the same termination threshold, so they reach a similar error
+    BenchmarkConfig config;
+    config.box = box;
+    config.depth = (depthArg) ? args::get(depthArg) : 8;
+    config.startDepth = (startDepthArg) ? args::get(startDepthArg) : 1;
+    config.terminationRule = IOctreeSdf::TerminationRule::TRAPEZOIDAL_RULE;
+    config.terminationRuleParams = IOctreeSdf::TerminationRuleParams::setTrapezoidalRuleParams(
+                                        (terminationThresholdArg) ? args::get(terminationThresholdArg) : 1e-3f);
+    config.numThreads = (numThreadsArg) ? args::get(numThreadsArg) : 1;
+
+    const uint32_t numSamples = (numSamplesArg) ? args::get(numSamplesArg) : 1000000;
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    std::vector<glm::vec3> samples(numSamples);
+    std::generate(samples.begin(), samples.end(), [&]()
+    {
+        return box.min + glm::vec3(dis(gen), dis(gen), dis(gen)) * box.getSize();
+    });
+
+    ExactOctreeSdf exactSdf(mesh, box, config.depth, config.startDepth, 32, config.numThreads);
+    std::vector<float> exactDistances(numSamples);
+    for(uint32_t s=0; s < numSamples; s++)
+    {
+        exactDistances[s] = exactSdf.getDistance(samples[s]);
+    }
+
+    auto linearOctree = runBenchmark<TriLinearInterpolation>("Trilinear", mesh, config, samples, exactDistances);
+    runBenchmark<TriQuadraticInterpolation>("Triquadratic", mesh, config, samples, exactDistances);
+    auto cubicOctree = runBenchmark<TriCubicInterpolation>("Tricubic", mesh, config, samples, exactDistances);
+
+    // The build time of the mixed octree only includes the merge of the other two octrees
+    Timer timer; timer.start();
+    std::unique_ptr<MixedOctreeSdf> mixedOctree = MixedOctreeSdf::fromOctrees(*linearOctree, *cubicOctree);
+    const float mergeTime = timer.getElapsedSeconds();
+    if(mixedOctree != nullptr)
+    {
+        printResults("Mixed", *mixedOctree, mergeTime, samples, exactDistances);
+    }
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include <random>
+#include <vector>
+#include <list>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+#include "SdfLib/SdfFunction.h"
+#include "SdfLib/OctreeSdf.h"
+#include "SdfLib/MortonOctreeSdf.h"
+#include "SdfLib/utils/Timer.h"
+
+using namespace sdflib;
+
+// Set-associative LRU cache with lines of 64 bytes
+class CacheSimulator
+{
+public:
+    CacheSimulator(uint32_t sizeInBytes, uint32_t numWays)
+        : mNumWays(numWays),
+          mNumSets(sizeInBytes / (64 * numWays)),
+          mSets(mNumSets)
+    {}
+
+    void access(const void* address, uint32_t numBytes)
+    {
+        const uint64_t firstLine = reinterpret_cast<uint64_t>(address) >> 6;
+        const uint64_t lastLine = (reinterpret_cast<uint64_t>(address) + numBytes - 1) >> 6;
+        for(uint64_t line = firstLine; line <= lastLine; line++)
+        {
+            std::list<uint64_t>& set = mSets[line % mNumSets];
+            auto it = std::find(set.begin(), set.end(), line);
+            mNumAccesses++;
+            if(it != set.end())
+            {
+                set.erase(it);
+            }
+            else
+            {
+                mNumMisses++;
+                if(set.size() == mNumWays) set.pop_back();
+            }
+            set.push_front(line);
+        }
+    }
+
+    float getMissRate() const { return static_cast<float>(mNumMisses) / static_cast<float>(std::max(mNumAccesses, uint64_t(1))); }
+    uint64_t getNumMisses() const { return mNumMisses; }
+
+private:
+    uint32_t mNumWays;
+    uint32_t mNumSets;
+    std::vector<std::list<uint64_t>> mSets;
+    uint64_t mNumAccesses = 0;
+    uint64_t mNumMisses = 0;
+};
+
+// Replicates the octree query traversal registering the memory accessed
+template<typename InterpolationMethod>
+void traceQuery(const TOctreeSdf<InterpolationMethod>& octree, glm::vec3 sample, CacheSimulator& l1, CacheSimulator& l2)
+{
+    const LargeArray<IOctreeSdf::OctreeNode>& data = octree.getOctreeData();
+    const BoundingBox& box = octree.getGridBoundingBox();
+    const int startGridSize = octree.getStartGridSize().x;
+    const float cellSize = box.getSize().x / static_cast<float>(startGridSize);
+
+    auto access = [&](const void* address, uint32_t numBytes)
+    {
+        l1.access(address, numBytes);
+        l2.access(address, numBytes);
+    };
+
+    glm::vec3 fracPart = (sample - box.min) / cellSize;
+    glm::ivec3 startArrayPos = glm::floor(fracPart);
+    fracPart = glm::fract(fracPart);
+    if(glm::any(glm::lessThan(startArrayPos, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(startArrayPos, glm::ivec3(startGridSize)))) return;
+
+    const IOctreeSdf::OctreeNode* currentNode = &data[startArrayPos.z * startGridSize * startGridSize + startArrayPos.y * startGridSize + startArrayPos.x];
+    access(currentNode, sizeof(IOctreeSdf::OctreeNode));
+    while(!currentNode->isLeaf())
+    {
+        const uint32_t childIdx = ((fracPart.z >= 0.5f) ? 4 : 0) + ((fracPart.y >= 0.5f) ? 2 : 0) + ((fracPart.x >= 0.5f) ? 1 : 0);
+        currentNode = &data[currentNode->getChildrenIndex() + childIdx];
+        access(currentNode, sizeof(IOctreeSdf::OctreeNode));
+        fracPart = glm::fract(2.0f * fracPart);
+    }
+
+    if(currentNode->getChildrenIndex() < data.size())
+    {
+        access(&data[currentNode->getChildrenIndex()], InterpolationMethod::NUM_COEFFICIENTS * sizeof(float));
+    }
+}
+
+template<typename InterpolationMethod>
+void runStream(const std::string& name, const TOctreeSdf<InterpolationMethod>& octree, const std::vector<glm::vec3>& samples, std::vector<float>& outDistances)
+{
+    CacheSimulator l1(32 * 1024, 8);
+    CacheSimulator l2(1024 * 1024, 16);
+    for(const glm::vec3& sample : samples)
+    {
+        traceQuery(octree, sample, l1, l2);
+    }
+
+    outDistances.resize(samples.size());
+    Timer timer; timer.start();
+    for(uint32_t s=0; s < samples.size(); s++)
+    {
+        outDistances[s] = octree.getDistance(samples[s]);
+    }
+    const float timePerQuery = (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(samples.size());
+
+    SPDLOG_INFO("{}: {}us per query, L1 miss rate {}, L2 miss rate {}", name, timePerQuery, l1.getMissRate(), l2.getMissRate());
+}
+
+template<typename InterpolationMethod>
+void runBenchmark(TOctreeSdf<InterpolationMethod>& octree, uint32_t numSamples, uint32_t hotLevels)
+{
+    const BoundingBox box = octree.getSampleArea();
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    auto getRandomPoint = [&]() -> glm::vec3
+    {
+        return box.min + glm::vec3(dis(gen), dis(gen), dis(gen)) * box.getSize();
+    };
+
+    // Random stream
+    std::vector<glm::vec3> randomSamples(numSamples);
+    std::generate(randomSamples.begin(), randomSamples.end(), getRandomPoint);
+
+    // Coherent stream, small steps along random segments like a ray marcher
+    std::vector<glm::vec3> coherentSamples;
+    coherentSamples.reserve(numSamples);
+    const float stepSize = box.getSize().x / 1024.0f;
+    while(coherentSamples.size() < numSamples)
+    {
+        glm::vec3 p = getRandomPoint();
+        const glm::vec3 dir = glm::normalize(getRandomPoint() - p);
+        for(uint32_t i=0; i < 256 && coherentSamples.size() < numSamples; i++)
+        {
+            p = glm::clamp(p + stepSize * dir, box.min, box.max - glm::vec3(1e-5f));
+            coherentSamples.push_back(p);
+        }
+    }
+
+    std::vector<float> randomDist, coherentDist;
+    runStream("Original layout random", octree, randomSamples, randomDist);
+    runStream("Original layout coherent", octree, coherentSamples, coherentDist);
+
+    const size_t oldSize = octree.getOctreeData().size();
+    Timer timer; timer.start();
+    if(!octree.relayoutOctreeData(hotLevels)) return;
+    SPDLOG_INFO("Relayout time: {}s", timer.getElapsedSeconds());
+    SPDLOG_INFO("Octree size: {}MB -> {}MB",
+                oldSize * sizeof(IOctreeSdf::OctreeNode) / 1048576.0f,
+                octree.getOctreeData().size() * sizeof(IOctreeSdf::OctreeNode) / 1048576.0f);
+
+    std::vector<float> newRandomDist, newCoherentDist;
+    runStream("New layout random", octree, randomSamples, newRandomDist);
+    runStream("New layout coherent", octree, coherentSamples, newCoherentDist);
+
+    if(newRandomDist != randomDist || newCoherentDist != coherentDist)
+    {
+        SPDLOG_ERROR("The relayout octree returns different distances");
+    }
+
+    // Same streams using the pointerless representation
+    std::unique_ptr<TMortonOctreeSdf<InterpolationMethod>> mortonOctree = TMortonOctreeSdf<InterpolationMethod>::fromOctree(octree);
+    if(mortonOctree == nullptr) return;
+
+    auto runMortonStream = [&](const std::string& name, const std::vector<glm::vec3>& samples, const std::vector<float>& octreeDist)
+    {
+        std::vector<float> distances(samples.size());
+        Timer timer; timer.start();
+        for(uint32_t s=0; s < samples.size(); s++)
+        {
+            distances[s] = mortonOctree->getDistance(samples[s]);
+        }
+        const float timePerQuery = (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(samples.size());
+
+        float maxDiff = 0.0f;
+        for(uint32_t s=0; s < samples.size(); s++) maxDiff = glm::max(maxDiff, glm::abs(distances[s] - octreeDist[s]));
+        SPDLOG_INFO("{}: {}us per query, max difference with the octree {}", name, timePerQuery, maxDiff);
+    };
+
+    runMortonStream("Morton random", randomSamples, randomDist);
+    runMortonStream("Morton coherent", coherentSamples, coherentDist);
+}
+
+int main(int argc, char** argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Compares the cache behaviour of the octree before and after the node relayout", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> sdfPathArg(parser, "sdf_path", "Octree sdf path");
+    args::ValueFlag<uint32_t> numSamplesArg(parser, "num_samples", "Number of samples of each stream", {'s', "num_samples"});
+    args::ValueFlag<uint32_t> hotLevelsArg(parser, "hot_levels", "Number of levels packed in breadth-first order", {"hot_levels"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    std::unique_ptr<SdfFunction> sdf = SdfFunction::loadFromFile(args::get(sdfPathArg));
+    if(sdf == nullptr) return 1;
+
+    const uint32_t numSamples = (numSamplesArg) ? args::get(numSamplesArg) : 1000000;
+    const uint32_t hotLevels = (hotLevelsArg) ? args::get(hotLevelsArg) : 2;
+
+    if(sdf->getFormat() == SdfFunction::SdfFormat::TRILINEAR_OCTREE)
+    {
+        runBenchmark(*reinterpret_cast<TOctreeSdf<TriLinearInterpolation>*>(sdf.get()), numSamples, hotLevels);
+    }
+    else if(sdf->getFormat() == SdfFunction::SdfFormat::TRICUBIC_OCTREE)
+    {
+        runBenchmark(*reinterpret_cast<TOctreeSdf<TriCubicInterpolation>*>(sdf.get()), numSamples, hotLevels);
+    }
+    else
+    {
+        SPDLOG_ERROR("The benchmark only supports octree formats");
+        return 1;
+    }
+
+    return 0;
+}
@@ -5,10 +5,39 @@
 #include <algorithm>
 
 #include "SdfLib/SdfFunction.h"
+#include "SdfLib/OctreeSdf.h"
+#include "SdfLib/ExactOctreeSdf.h"
 #include "SdfLib/utils/Timer.h"
 
 using namespace sdflib;
 
+void setQueryStatsEnabled(SdfFunction* sdf, bool enabled)
+{
+    if(IOctreeSdf* octreeSdf = dynamic_cast<IOctreeSdf*>(sdf)) octreeSdf->setQueryStatsEnabled(enabled);
+    else if(ExactOctreeSdf* exactSdf = dynamic_cast<ExactOctreeSdf*>(sdf)) exactSdf->setQueryStatsEnabled(enabled);
+}
+
+void printQueryStats(const std::string& name, SdfFunction* sdf)
+{
+    QueryStats stats;
+    if(IOctreeSdf* octreeSdf = dynamic_cast<IOctreeSdf*>(sdf)) stats = octreeSdf->getQueryStats();
+    else if(ExactOctreeSdf* exactSdf = dynamic_cast<ExactOctreeSdf*>(sdf)) stats = exactSdf->getQueryStats();
+    else return;
+
+    const double numQueries = static_cast<double>(std::max(stats.numQueries, uint64_t(1)));
+    SPDLOG_INFO("{} queries: {}, out of box: {}", name, stats.numQueries, stats.numOutOfBoxQueries);
+    SPDLOG_INFO("{} nodes visited per query: {}", name, static_cast<double>(stats.nodesVisited) / numQueries);
+    SPDLOG_INFO("{} triangles evaluated per query: {}", name, static_cast<double>(stats.trianglesEvaluated) / numQueries);
+    SPDLOG_INFO("{} mask bits decoded per query: {}", name, static_cast<double>(stats.maskBitsDecoded) / numQueries);
+    for(uint32_t d=0; d < QueryStats::MAX_DEPTH; d++)
+    {
+        if(stats.leafDepthHistogram[d] > 0)
+        {
+            SPDLOG_INFO("{} leaves at depth {}: {}", name, d, stats.leafDepthHistogram[d]);
+        }
+    }
+}
+
 int main(int argc, char** argv)
 {
     #ifdef SDFLIB_PRINT_STATISTICS
@@ -22,6 +51,7 @@ int main(int argc, char** argv)
     args::Positional<std::string> sdfPathArg(parser, "sdf_path", "Sdf path");
     args::Positional<std::string> exactSdfPathArg(parser, "exact_sdf_path", "Exact sdf path");
     args::Positional<uint32_t> millionsOfSamplesArg(parser, "num_samples_in_millions", "Number of samples to made in millions");
+    args::Flag queryStatsArg(parser, "query_stats", "Record and print the query counters of the structures", {"query_stats"});
     
     try
     {
@@ -41,6 +71,12 @@ int main(int argc, char** argv)
 
 	SPDLOG_INFO("Models Loaded");
 
+    if(queryStatsArg)
+    {
+        setQueryStatsEnabled(sdf.get(), true);
+        setQueryStatsEnabled(exactSdf.get(), true);
+    }
+
     const uint32_t numSamples = 1000000 * ((millionsOfSamplesArg) ? args::get(millionsOfSamplesArg) : 1);
     std::vector<glm::vec3> samples(numSamples);
     
@@ -74,6 +110,22 @@ int main(int argc, char** argv)
     float exactSdfTimePerSample = (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(numSamples);
 	SPDLOG_INFO("Exact Sdf us per query: {}", exactSdfTimePerSample, timer.getElapsedSeconds());
 
+    // Same queries using the library thread pool
+    std::vector<float> asyncSdfDist;
+    timer.start();
+    sdf->getDistancesAsync(samples, asyncSdfDist).wait();
+    SPDLOG_INFO("Sdf async us per query: {}", (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(numSamples));
+
+    std::vector<float> asyncExactSdfDist;
+    timer.start();
+    exactSdf->getDistancesAsync(samples, asyncExactSdfDist).wait();
+    SPDLOG_INFO("Exact Sdf async us per query: {}", (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(numSamples));
+
+    if(asyncSdfDist != sdfDist || asyncExactSdfDist != exactSdfDist)
+    {
+        SPDLOG_ERROR("The asynchronous queries do not match the sequential ones");
+    }
+
     // Calculate error
 
     auto pow2 = [](float a) { return a * a; };
@@ -93,4 +145,10 @@ int main(int argc, char** argv)
     SPDLOG_INFO("RMSE: {}", rmseError);
     SPDLOG_INFO("MAE: {}", maeError);
     SPDLOG_INFO("Max error: {}", maxError);
+
+    if(queryStatsArg)
+    {
+        printQueryStats("Sdf", sdf.get());
+        printQueryStats("Exact Sdf", exactSdf.get());
+    }
 }
\ No newline at end of file
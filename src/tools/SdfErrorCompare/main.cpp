@@ -315,10 +315,7 @@ int main(int argc, char** argv)
 #ifdef TEST_EXACT_OCTREE_SDF
     std::vector<float> exactSdfDist(numSamples);
     timer.start();
-    for(uint32_t s=0; s < numSamples; s++)
-    {
-        exactSdfDist[s] = exactSdf->getDistance(samples[s]);
-    }
+    exactSdf->getDistances(samples.data(), exactSdfDist.data(), numSamples);
     float exactSdfTimePerSample = (timer.getElapsedSeconds() * 1.0e6f) / static_cast<float>(numSamples);
 	SPDLOG_INFO("Exact Sdf us per query: {}", exactSdfTimePerSample, timer.getElapsedSeconds());
     SPDLOG_INFO("Exact Sdf: {}s", timer.getElapsedSeconds());
@@ -3,8 +3,13 @@
 #include <algorithm>
 #include <optional>
 #include "SdfLib/UniformGridSdf.h"
+#include "SdfLib/BrickMapSdf.h"
+#include "SdfLib/SparseUniformGridSdf.h"
 #include "SdfLib/RealSdf.h"
 #include "SdfLib/OctreeSdf.h"
+#include "SdfLib/QuantizedOctreeSdf.h"
+#include "SdfLib/MortonOctreeSdf.h"
+#include "SdfLib/MixedOctreeSdf.h"
 #include "SdfLib/ExactOctreeSdf.h"
 #include "SdfLib/utils/Mesh.h"
 #include <iostream>
@@ -12,9 +17,14 @@
 #include <args.hxx>
 #include "SdfLib/utils/TriangleUtils.h"
 #include "SdfLib/utils/Timer.h"
+#include "SdfLib/utils/HugePageAllocator.h"
 #include <spdlog/spdlog.h>
 #include <glm/gtc/matrix_transform.hpp>
 
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
 using namespace sdflib;
 
 std::optional<IOctreeSdf::TerminationRule> parseTerminationRule(const std::string& terminationRuleStr)
@@ -61,6 +71,37 @@ std::optional<IOctreeSdf::InitAlgorithm> parseInitAlgorithm(const std::string& i
     return std::optional<IOctreeSdf::InitAlgorithm>(initAlgorithm);
 }
 
+template<typename InterpolationMethod>
+SdfFunction* quantizeOctreeSdf(TOctreeSdf<InterpolationMethod>* octree, const std::string& encodingStr, float maxError)
+{
+    typedef TQuantizedOctreeSdf<InterpolationMethod> MyQuantizedOctree;
+    std::unique_ptr<TOctreeSdf<InterpolationMethod>> octreePtr(octree);
+    std::optional<typename MyQuantizedOctree::CoefficientsEncoding> encoding = MyQuantizedOctree::stringToCoefficientsEncoding(encodingStr);
+    if(!encoding)
+    {
+        std::cerr << encodingStr << " is not a valid coefficients encoding" << std::endl;
+        return nullptr;
+    }
+
+    return MyQuantizedOctree::fromOctree(*octreePtr, encoding.value(), maxError).release();
+}
+
+SdfFunction* convertToMortonOctreeSdf(SdfFunction* sdf)
+{
+    std::unique_ptr<SdfFunction> sdfPtr(sdf);
+    if(sdf->getFormat() == SdfFunction::SdfFormat::TRILINEAR_OCTREE)
+    {
+        return TMortonOctreeSdf<TriLinearInterpolation>::fromOctree(*reinterpret_cast<TOctreeSdf<TriLinearInterpolation>*>(sdf)).release();
+    }
+    else if(sdf->getFormat() == SdfFunction::SdfFormat::TRICUBIC_OCTREE)
+    {
+        return TMortonOctreeSdf<TriCubicInterpolation>::fromOctree(*reinterpret_cast<TOctreeSdf<TriCubicInterpolation>*>(sdf)).release();
+    }
+
+    std::cerr << "Only the octree formats can be converted to a morton octree" << std::endl;
+    return nullptr;
+}
+
 template<typename... Args>
 SdfFunction* createOctreeSdf(const std::string& interpolationMethod,
                              const Mesh& mesh,
@@ -70,7 +111,10 @@ SdfFunction* createOctreeSdf(const std::string& interpolationMethod,
                              const std::string& terminationRuleStr,
                              args::ValueFlag<float>& p1, args::ValueFlag<float>& p2,
                              const std::string& initAlgorithmStr,
-                             uint32_t numThreads)
+                             uint32_t numThreads,
+                             bool relayout,
+                             bool compress,
+                             const std::string& quantization)
 {
     
     std::optional<IOctreeSdf::TerminationRule> terminationRule = parseTerminationRule(terminationRuleStr);
@@ -80,12 +124,46 @@ SdfFunction* createOctreeSdf(const std::string& interpolationMethod,
     if(interpolationMethod == "trilinear")
     {
         typedef TOctreeSdf<TriLinearInterpolation> MyOctree;    
-        return new MyOctree(mesh, box, depth, startDepth, terminationRule.value(), terminationRuleParams, initAlgorithm.value(), numThreads);
+        MyOctree* octree = new MyOctree(mesh, box, depth, startDepth, terminationRule.value(), terminationRuleParams, initAlgorithm.value(), numThreads);
+        if(compress) octree->compressOctreeData();
+        if(relayout) octree->relayoutOctreeData();
+        if(!quantization.empty()) return quantizeOctreeSdf(octree, quantization, terminationRuleParams[0]);
+        return octree;
     }
     else if(interpolationMethod == "tricubic")
     {
         typedef TOctreeSdf<TriCubicInterpolation> MyOctree;
-        return new MyOctree(mesh, box, depth, startDepth, terminationRule.value(), terminationRuleParams, initAlgorithm.value(), numThreads);
+        MyOctree* octree = new MyOctree(mesh, box, depth, startDepth, terminationRule.value(), terminationRuleParams, initAlgorithm.value(), numThreads);
+        if(compress) octree->compressOctreeData();
+        if(relayout) octree->relayoutOctreeData();
+        if(!quantization.empty()) return quantizeOctreeSdf(octree, quantization, terminationRuleParams[0]);
+        return octree;
+    }
+    else if(interpolationMethod == "triquadratic")
+    {
+        typedef TOctreeSdf<TriQuadraticInterpolation> MyOctree;
+        MyOctree* octree = new MyOctree(mesh, box, depth, startDepth, terminationRule.value(), terminationRuleParams, initAlgorithm.value(), numThreads);
+        if(compress) octree->compressOctreeData();
+        if(relayout) octree->relayoutOctreeData();
+        if(!quantization.empty())
+        {
+            std::cerr << "The quantization only supports the trilinear and tricubic interpolations" << std::endl;
+            delete octree;
+            return nullptr;
+        }
+        return octree;
+    }
+    else if(interpolationMethod == "mixed")
+    {
+        // Both octrees are built with the same error threshold and each leaf takes the cheapest one
+        if(compress || !quantization.empty())
+        {
+            std::cerr << "The mixed interpolation does not support the compression or the quantization" << std::endl;
+            return nullptr;
+        }
+        TOctreeSdf<TriLinearInterpolation> linearOctree(mesh, box, depth, startDepth, terminationRule.value(), terminationRuleParams, initAlgorithm.value(), numThreads);
+        TOctreeSdf<TriCubicInterpolation> cubicOctree(mesh, box, depth, startDepth, terminationRule.value(), terminationRuleParams, initAlgorithm.value(), numThreads);
+        return MixedOctreeSdf::fromOctrees(linearOctree, cubicOctree).release();
     }
     else
     {
@@ -115,15 +193,24 @@ int main(int argc, char** argv)
 	args::ValueFlag<std::string> terminationRuleArg(parser, "termination_rule", "The heuristic used to decide if one node has to be subdivided. It supports: trapezoidal_rule, isosurface, by_distance_rule", {"termination_rule"});
     args::ValueFlag<float> terminationThresholdArg(parser, "termination_threshold", "Octree generation termination threshold", {"termination_threshold"});
     args::ValueFlag<float> terminationThresholdByDistanceArg(parser, "termination_threshold_by_distance", "Octree generation termination threshold by distance. Only supported when the termination rule is by_distance_rule", {"termination_threshold_by_distance"});
+    args::ValueFlag<float> narrowBandArg(parser, "narrow_band", "The sparse grid and the brick map only store the samples near the surface with distances lower than this value", {"narrow_band"});
     args::ValueFlag<uint32_t> minTrianglesPerNodeArg(parser, "min_triangles_per_node", "The minimum acceptable number of triangles per leaf in the octree", {"min_triangles_per_node"});
-    args::ValueFlag<std::string> interpolationMethodArg(parser, "interpolation", "The distance interpolation method. It supports: trilinear, tricubic", {"interpolation"});
+    args::ValueFlag<std::string> interpolationMethodArg(parser, "interpolation", "The distance interpolation method. It supports: trilinear, triquadratic, tricubic, mixed", {"interpolation"});
 
-	args::ValueFlag<std::string> sdfFormatArg(parser, "sdf_format", "It supports two formats: octree, grid, exact_octree", {"sdf_format"});
+	args::ValueFlag<std::string> sdfFormatArg(parser, "sdf_format", "It supports the formats: octree, morton_octree, grid, sparse_grid, brick_map, exact_octree", {"sdf_format"});
     args::ValueFlag<std::string> octreeAlgorithmArg(parser, "algorithm", "Select the algoirthm to generate the octree. It supports: uniform, no_continuity, continuity", {"algorithm"});
     args::Flag normalizeBBArg(parser, "normalize_model", "Normalize the model coordinates", {'n', "normalize"});
     args::ValueFlag<float> bbMarginArg(parser, "bb_margin", "Percentage of margin added between the structure BB and the model BB", {"bb_margin"});
 
     args::ValueFlag<uint32_t> numThreadsArg(parser, "num_threads", "Set the application maximum number of threads", {"num_threads"});
+    args::Flag relayoutArg(parser, "relayout", "Reorder the octree nodes to improve the query cache usage. Only supported by the octree format", {"relayout"});
+    args::Flag compressArg(parser, "compress", "Share the identical leaves and subtrees of the octree. Only supported by the octree format", {"compress"});
+    args::ValueFlag<std::string> quantizeArg(parser, "quantize", "Compress the octree leaves coefficients. It supports: fp16, 16bit, 8bit. The quantization error must be lower than the termination threshold", {"quantize"});
+    args::Flag compressedFileArg(parser, "compressed_file", "Store the file entropy coded, it is decoded in parallel when loaded. Only supported by the octree format", {"compressed_file"});
+    args::Flag compactTrianglesArg(parser, "compact_triangles", "Store the triangles using the compact encoding. Only supported by the exact_octree format", {"compact_triangles"});
+    args::Flag compactNodesArg(parser, "compact_nodes", "Store the nodes using the compact encoding. Only supported by the exact_octree format", {"compact_nodes"});
+    args::Flag hugePagesArg(parser, "huge_pages", "Allocate the structure arrays using huge pages. Only supported by the exact_octree format", {"huge_pages"});
+    args::ValueFlag<uint32_t> mipLevelsArg(parser, "mip_levels", "Number of conservative coarse levels used to skip the empty space. Only supported by the grid format", {"mip_levels"});
 
     try
     {
@@ -182,9 +269,36 @@ int main(int argc, char** argv)
         sdfFunc = std::unique_ptr<UniformGridSdf>((cellSizeArg) ? 
                     new UniformGridSdf(mesh, box, args::get(cellSizeArg), UniformGridSdf::InitAlgorithm::OCTREE) :
                     new UniformGridSdf(mesh, box, (depthArg) ? args::get(depthArg) : 6, UniformGridSdf::InitAlgorithm::OCTREE));
-        
+
+        if(mipLevelsArg)
+        {
+            reinterpret_cast<UniformGridSdf*>(sdfFunc.get())->buildMipChain(args::get(mipLevelsArg), (numThreadsArg) ? args::get(numThreadsArg) : 1);
+        }
+    }
+    else if(sdfFormat == "sparse_grid")
+    {
+        timer.start();
+        const float cellSize = (cellSizeArg) ? args::get(cellSizeArg) : 
+                               glm::max(glm::max(box.getSize().x, box.getSize().y), box.getSize().z) / static_cast<float>(1 << ((depthArg) ? args::get(depthArg) : 8));
+        sdfFunc = std::unique_ptr<SparseUniformGridSdf>(new SparseUniformGridSdf(
+            mesh, box, cellSize,
+            (narrowBandArg) ? args::get(narrowBandArg) : 4.0f * cellSize,
+            (numThreadsArg) ? args::get(numThreadsArg) : 1
+        ));
+    }
+    else if(sdfFormat == "brick_map")
+    {
+        timer.start();
+        const float cellSize = (cellSizeArg) ? args::get(cellSizeArg) : 
+                               glm::max(glm::max(box.getSize().x, box.getSize().y), box.getSize().z) / 256.0f;
+        sdfFunc = std::unique_ptr<BrickMapSdf>(new BrickMapSdf(
+            mesh, box, cellSize,
+            (narrowBandArg) ? args::get(narrowBandArg) : 4.0f * cellSize,
+            (terminationThresholdArg) ? args::get(terminationThresholdArg) : INFINITY,
+            (numThreadsArg) ? args::get(numThreadsArg) : 1
+        ));
     }
-    else if(sdfFormat == "octree")
+    else if(sdfFormat == "octree" || sdfFormat == "morton_octree")
     {
         timer.start();
         sdfFunc = std::unique_ptr<SdfFunction>(createOctreeSdf(
@@ -195,21 +309,33 @@ int main(int argc, char** argv)
             (terminationRuleArg) ? args::get(terminationRuleArg) : "trapezoidal_rule", 
             terminationThresholdArg, terminationThresholdByDistanceArg,
             (octreeAlgorithmArg) ? args::get(octreeAlgorithmArg) : "continuity",
-            (numThreadsArg) ? args::get(numThreadsArg) : 1
+            (numThreadsArg) ? args::get(numThreadsArg) : 1,
+            args::get(relayoutArg),
+            args::get(compressArg),
+            (quantizeArg) ? args::get(quantizeArg) : ""
         ));
 
+        if(sdfFunc != nullptr && sdfFormat == "morton_octree")
+        {
+            sdfFunc = std::unique_ptr<SdfFunction>(convertToMortonOctreeSdf(sdfFunc.release()));
+        }
+
         if(sdfFunc == nullptr) return 1;
     }
     else if(sdfFormat == "exact_octree")
     {
+        if(hugePagesArg) setLargeArrayPolicy(LargeArrayPolicy::HUGE_PAGES);
         timer.start();
         sdfFunc = std::unique_ptr<ExactOctreeSdf>(new ExactOctreeSdf(
             mesh, box,
             (depthArg) ? args::get(depthArg) : 5,
             (startDepthArg) ? args::get(startDepthArg) : 1,
             (minTrianglesPerNodeArg) ? args::get(minTrianglesPerNodeArg) : 32,
-            (numThreadsArg) ? args::get(numThreadsArg) : 1
+            (numThreadsArg) ? args::get(numThreadsArg) : 1,
+            args::get(compactTrianglesArg)
         ));
+
+        if(compactNodesArg) static_cast<ExactOctreeSdf*>(sdfFunc.get())->compactOctreeNodes();
     }
     else
     {
@@ -217,7 +343,31 @@ int main(int argc, char** argv)
     }
 
     SPDLOG_INFO("Computation time {}s", timer.getElapsedSeconds());
+#ifdef __linux__
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        SPDLOG_INFO("Peak memory usage {}MB", static_cast<float>(usage.ru_maxrss) / 1024.0f);
+    }
+#endif
+
+    if(sdfFunc == nullptr || !sdfFunc->isValid())
+    {
+        SPDLOG_ERROR("The structure could not be built");
+        return 1;
+    }
+
+    const SdfFunction::MemoryUsage memoryUsage = sdfFunc->getMemoryUsage();
+    for(const SdfFunction::MemoryUsage::Array& array : memoryUsage.arrays)
+    {
+        SPDLOG_INFO("Memory of {}: {}MB", array.name, static_cast<float>(array.numBytes) / 1048576.0f);
+    }
+    for(size_t d=0; d < memoryUsage.nodesPerDepth.size(); d++)
+    {
+        if(memoryUsage.nodesPerDepth[d] == 0) continue;
+        SPDLOG_INFO("Depth {}: {} nodes, {} leaves", d, memoryUsage.nodesPerDepth[d], memoryUsage.leavesPerDepth[d]);
+    }
     
     SPDLOG_INFO("Saving the model");
-    sdfFunc->saveToFile(outputPath);
+    sdfFunc->saveToFile(outputPath, args::get(compressedFileArg));
 }
\ No newline at end of file
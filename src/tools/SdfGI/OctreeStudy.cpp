@@ -84,7 +84,7 @@ int main(int argc, char **argv)
             timeResults.insert({{maxDepth, startDepth}, duration});
 
             SceneOctree scene(mesh, config);
-            auto size = scene.getShaderOctreeData().size() * sizeof(ShaderOctreeNode) * 1e-6;
+            auto size = scene.getShaderOctreeMemory() * 1e-6;
 
             sizeResults.insert({{maxDepth, startDepth}, size});
 
@@ -95,7 +95,6 @@ SceneOctree::SceneOctree(const sdflib::Mesh &mesh, RenderConfig config) : mRende
             assert(n->type == OctreeNode::Type::Gray);
 
             ShaderOctreeNode shaderNode{};
-            shaderNode.depth = n->depth;
             // shaderNode.min = n->center - glm::vec3(n->halfSize);
             // shaderNode.max = n->center + glm::vec3(n->halfSize);
             // shaderNode.ref = n;
@@ -236,6 +235,9 @@ void SceneOctree::renderNode(std::unique_ptr<OctreeNode> &node, const sdflib::Me
         if (node->children[i]->type == OctreeNode::Type::Gray)
             renderNode(node->children[i], mesh);
     }
+
+    // The children already have its triangles
+    node->triangles = std::vector<size_t>();
 }
 
 void SceneOctree::slowTriangleIntersectionTest(sdflib::BoundingBox bbox, const std::vector<size_t> &triangles, std::vector<size_t> &outTriangles)
@@ -279,7 +281,6 @@ uint32_t SceneOctree::generateShaderOctreeData(const OctreeNode* node)
         const auto& child = node->children[i];
 
         ShaderOctreeNode shaderNode{};
-        shaderNode.depth = child->depth;
         // shaderNode.min = child->center - glm::vec3(child->halfSize);
         // shaderNode.max = child->center + glm::vec3(child->halfSize);
         // shaderNode.ref = child.get();
@@ -296,16 +297,16 @@ uint32_t SceneOctree::generateShaderOctreeData(const OctreeNode* node)
         {
             const auto mat = child->material;
 
-            mShaderOctreeData[nodeIdx+i].color = glm::vec4(mat.albedo, 1.0f);
-            mShaderOctreeData[nodeIdx+i].materialProperties = glm::vec4(mat.roughness, mat.metallic, 0.0f, 0.0f);
+            // The black leaves point to its attributes
+            const uint32_t leafIdx = mLeafAttributes.size();
+            mLeafAttributes.push_back(ShaderLeafAttributes{
+                .color = glm::vec4(mat.albedo, 1.0f),
+                .materialProperties = glm::vec4(mat.roughness, mat.metallic, static_cast<float>(child->depth), 0.0f),
+            });
+            mShaderOctreeData[nodeIdx+i].setIndex(leafIdx);
 
             mLeafIndices.push_back(nodeIdx+i);
         }
-        else if (child->type == OctreeNode::Type::White)
-        {
-            mShaderOctreeData[nodeIdx+i].color = glm::vec4(0.0f);
-            mShaderOctreeData[nodeIdx+i].materialProperties = glm::vec4(0.0f);
-        }
         else if (child->type == OctreeNode::Type::Gray)
         {
             const uint32_t childIdx = generateShaderOctreeData(child.get());
@@ -317,4 +318,32 @@ uint32_t SceneOctree::generateShaderOctreeData(const OctreeNode* node)
     }
 
     return nodeIdx;
-}
\ No newline at end of file
+}
+
+uint32_t SceneOctree::getLeafIndex(glm::vec3 gridPoint) const
+{
+    const glm::ivec3 startGridSize(std::exp2(mRenderConfig.startDepth));
+    glm::vec3 fracPart = gridPoint * glm::vec3(startGridSize);
+    const glm::ivec3 arrayPos = glm::floor(fracPart);
+
+    if (glm::any(glm::lessThan(arrayPos, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(arrayPos, startGridSize)))
+        return INVALID_LEAF;
+
+    fracPart = glm::fract(fracPart);
+
+    // Same order than the start nodes array: y, z, x
+    uint32_t idx = arrayPos.y * startGridSize.z * startGridSize.x + arrayPos.z * startGridSize.x + arrayPos.x;
+    ShaderOctreeNode node = mShaderOctreeData[idx];
+
+    while (!node.getIsLeaf())
+    {
+        const uint32_t childIdx = ((fracPart.y > 0.5f) ? 4 : 0) + 
+                                  ((fracPart.z > 0.5f) ? 2 : 0) + 
+                                  ((fracPart.x > 0.5f) ? 1 : 0);
+
+        node = mShaderOctreeData[node.getIndex() + childIdx];
+        fracPart = glm::fract(2.0f * fracPart);
+    }
+
+    return (node.getNodeType() == OctreeNode::Type::Black) ? node.getIndex() : INVALID_LEAF;
+}
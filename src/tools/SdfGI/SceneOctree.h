@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <limits>
 #include <memory>
 #include <glm/glm.hpp>
 
@@ -37,31 +38,24 @@ struct OctreeNode
 constexpr uint32_t SHADER_LEAF_MASK  = 0xC0000000; // 0x80000000;
 constexpr uint32_t SHADER_CHILD_MASK = 0x3FFFFFFF; // 0x7fffffff;
 
+// Traversal data of the scene octree nodes, the only data read until reaching a leaf
 struct ShaderOctreeNode
 {
     // 32 bits
     // - bit 31,30: node type
-    // - bit 29-0:  children idx
+    // - bit 29-0:  children idx for the gray nodes, leaf idx for the black nodes
     uint32_t data = 0; 
-    uint32_t depth = 0;
-    float _padding1[2];
-
-    glm::vec4 color{};
-    // roughness, metallic, -, -
-    glm::vec4 materialProperties{};
-
-    // radiance caching (orientations in order: -x, x, -y, y, -z, z)
-    glm::vec4 readRadiance[6]{};
-    glm::vec4 writeRadiance[6]{};
-
-    glm::vec4 invalidReadRadiance[6]{};
-    glm::vec4 invalidWriteRadiance[6]{};
 
     void setNodeType(OctreeNode::Type type)
     {
         data |= (static_cast<uint32_t>(type) << 30) & SHADER_LEAF_MASK;
     }
 
+    OctreeNode::Type getNodeType() const
+    {
+        return static_cast<OctreeNode::Type>((data & SHADER_LEAF_MASK) >> 30);
+    }
+
     bool getIsLeaf() const
     {
         return (data & SHADER_LEAF_MASK) != 0;
@@ -78,6 +72,26 @@ struct ShaderOctreeNode
     }
 };
 
+// Attributes of the black leaves, indexed by leaf
+struct ShaderLeafAttributes
+{
+    glm::vec4 color{};
+    // roughness, metallic, depth, -
+    glm::vec4 materialProperties{};
+};
+
+// Radiance caching of the black leaves, indexed by leaf.
+// It is only written by the shaders, so it is not stored in the cpu.
+struct ShaderLeafRadiance
+{
+    // orientations in order: -x, x, -y, y, -z, z
+    glm::vec4 readRadiance[6]{};
+    glm::vec4 writeRadiance[6]{};
+
+    glm::vec4 invalidReadRadiance[6]{};
+    glm::vec4 invalidWriteRadiance[6]{};
+};
+
 class SceneOctree
 {
 public:
@@ -92,15 +106,32 @@ public:
 
     [[nodiscard]] int getStartGridSize() { return std::exp2(mRenderConfig.startDepth); }
 
+    static constexpr uint32_t INVALID_LEAF = std::numeric_limits<uint32_t>::max();
+
     const std::unique_ptr<OctreeNode> &getRoot() { return mRoot; }
-    const std::vector<ShaderOctreeNode> &getShaderOctreeData() { return mShaderOctreeData; }
+    const std::vector<ShaderOctreeNode> &getShaderOctreeData() const { return mShaderOctreeData; }
+    const std::vector<ShaderLeafAttributes> &getLeafAttributes() const { return mLeafAttributes; }
+    // Node index of each black leaf
     const std::vector<uint32_t>& getLeafIndices() const { return mLeafIndices; }
+    uint32_t getNumLeaves() const { return static_cast<uint32_t>(mLeafIndices.size()); }
+
+    // Memory used by the shader arrays, including the radiance cache allocated in the gpu
+    size_t getShaderOctreeMemory() const
+    {
+        return mShaderOctreeData.size() * sizeof(ShaderOctreeNode) + 
+               mLeafAttributes.size() * (sizeof(ShaderLeafAttributes) + sizeof(ShaderLeafRadiance));
+    }
+
+    // Returns the black leaf containing the point or INVALID_LEAF
+    // The point is in the [0, 1] space of the octree, like in the shaders
+    uint32_t getLeafIndex(glm::vec3 gridPoint) const;
 
 private:
     RenderConfig mRenderConfig;
 
     std::unique_ptr<OctreeNode> mRoot;
     std::vector<ShaderOctreeNode> mShaderOctreeData;
+    std::vector<ShaderLeafAttributes> mLeafAttributes;
 
     std::vector<uint32_t> mLeafIndices{};
 
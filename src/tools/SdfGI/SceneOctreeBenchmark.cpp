@@ -0,0 +1,139 @@
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+
+#include "SdfLib/utils/Mesh.h"
+#include "SdfLib/utils/Timer.h"
+#include "SceneOctree.h"
+
+using namespace sdflib;
+
+// Node layout used before the traversal data was split from the attributes and the radiance cache
+struct FatShaderOctreeNode
+{
+    uint32_t data = 0;
+    uint32_t depth = 0;
+    float _padding1[2];
+
+    glm::vec4 color{};
+    glm::vec4 materialProperties{};
+    glm::vec4 radiance[24]{};
+};
+
+template<typename Node, typename GetData>
+uint32_t traverse(const std::vector<Node>& nodes, glm::ivec3 startGridSize, glm::vec3 gridPoint, GetData getData)
+{
+    glm::vec3 fracPart = gridPoint * glm::vec3(startGridSize);
+    const glm::ivec3 arrayPos = glm::floor(fracPart);
+    fracPart = glm::fract(fracPart);
+
+    uint32_t idx = arrayPos.y * startGridSize.z * startGridSize.x + arrayPos.z * startGridSize.x + arrayPos.x;
+    uint32_t data = getData(nodes[idx]);
+    while ((data & SHADER_LEAF_MASK) == 0)
+    {
+        const uint32_t childIdx = ((fracPart.y > 0.5f) ? 4 : 0) +
+                                  ((fracPart.z > 0.5f) ? 2 : 0) +
+                                  ((fracPart.x > 0.5f) ? 1 : 0);
+
+        idx = (data & SHADER_CHILD_MASK) + childIdx;
+        data = getData(nodes[idx]);
+        fracPart = glm::fract(2.0f * fracPart);
+    }
+
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Compares the memory and the cpu traversal time of the scene octree with the split and the fat node layouts");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> modelPathArg(parser, "model_path", "The model path");
+    args::ValueFlag<uint32_t> maxDepthArg(parser, "max_depth", "The scene octree max depth", {'d', "max_depth"});
+    args::ValueFlag<uint32_t> startDepthArg(parser, "start_depth", "The scene octree start depth", {"start_depth"});
+    args::ValueFlag<uint32_t> numSamplesArg(parser, "num_samples", "Number of samples", {'s', "num_samples"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    Mesh mesh(args::get(modelPathArg));
+    mesh.computeBoundingBox();
+
+    const auto config = SceneOctree::RenderConfig{
+        .maxDepth = static_cast<int>((maxDepthArg) ? args::get(maxDepthArg) : 8),
+        .startDepth = static_cast<int>((startDepthArg) ? args::get(startDepthArg) : 4),
+    };
+
+    Timer timer; timer.start();
+    SceneOctree scene(mesh, config);
+    SPDLOG_INFO("Scene octree generated in {}s, {} nodes and {} leaves",
+                timer.getElapsedSeconds(), scene.getShaderOctreeData().size(), scene.getNumLeaves());
+
+    // Build the fat layout from the split one
+    const std::vector<ShaderOctreeNode>& nodes = scene.getShaderOctreeData();
+    std::vector<FatShaderOctreeNode> fatNodes(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        fatNodes[i].data = nodes[i].data;
+        if (nodes[i].getNodeType() == OctreeNode::Type::Black)
+        {
+            const ShaderLeafAttributes& attributes = scene.getLeafAttributes()[nodes[i].getIndex()];
+            fatNodes[i].color = attributes.color;
+            fatNodes[i].materialProperties = attributes.materialProperties;
+        }
+    }
+
+    const uint32_t numSamples = (numSamplesArg) ? args::get(numSamplesArg) : 1000000;
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<float> dis(0.0f, 0.9999f);
+    std::vector<glm::vec3> samples(numSamples);
+    std::generate(samples.begin(), samples.end(), [&]()
+    {
+        return glm::vec3(dis(gen), dis(gen), dis(gen));
+    });
+
+    const glm::ivec3 startGridSize(scene.getStartGridSize());
+
+    // The leaf attributes are read in both layouts, so the sums must match
+    std::vector<float> splitResults(numSamples);
+    timer.start();
+    for (uint32_t s = 0; s < numSamples; ++s)
+    {
+        const uint32_t data = traverse(nodes, startGridSize, samples[s], [](const ShaderOctreeNode& n) { return n.data; });
+        splitResults[s] = ((data >> 30) == static_cast<uint32_t>(OctreeNode::Type::Black))
+                            ? scene.getLeafAttributes()[data & SHADER_CHILD_MASK].color.r : 0.0f;
+    }
+    const float splitTime = (timer.getElapsedSeconds() * 1.0e9f) / static_cast<float>(numSamples);
+
+    std::vector<float> fatResults(numSamples);
+    timer.start();
+    for (uint32_t s = 0; s < numSamples; ++s)
+    {
+        const FatShaderOctreeNode* leaf = nullptr;
+        const uint32_t data = traverse(fatNodes, startGridSize, samples[s], [&](const FatShaderOctreeNode& n) { leaf = &n; return n.data; });
+        fatResults[s] = ((data >> 30) == static_cast<uint32_t>(OctreeNode::Type::Black)) ? leaf->color.r : 0.0f;
+    }
+    const float fatTime = (timer.getElapsedSeconds() * 1.0e9f) / static_cast<float>(numSamples);
+
+    uint32_t numDifferences = 0;
+    for (uint32_t s = 0; s < numSamples; ++s)
+    {
+        if (splitResults[s] != fatResults[s]) numDifferences++;
+    }
+
+    SPDLOG_INFO("Split layout: {}MB, {}ns per traversal", scene.getShaderOctreeMemory() / 1048576.0f, splitTime);
+    SPDLOG_INFO("Fat layout: {}MB, {}ns per traversal", fatNodes.size() * sizeof(FatShaderOctreeNode) / 1048576.0f, fatTime);
+    SPDLOG_INFO("{} different results", numDifferences);
+
+    return numDifferences > 0;
+}
@@ -75,6 +75,14 @@ public:
         std::unique_ptr<SdfFunction> sdfUnique = SdfFunction::loadFromFile(mSdfPath);
         std::shared_ptr<SdfFunction> sdf = std::move(sdfUnique);
         std::shared_ptr<IOctreeSdf> octreeSdf = std::dynamic_pointer_cast<IOctreeSdf>(sdf);
+        if(octreeSdf == nullptr ||
+           (octreeSdf->getFormat() != SdfFunction::SdfFormat::TRILINEAR_OCTREE &&
+            octreeSdf->getFormat() != SdfFunction::SdfFormat::TRICUBIC_OCTREE))
+        {
+            std::cerr << "Only the trilinear and tricubic octrees are supported in this application" << std::endl;
+            exit(1);
+        }
+
         if (octreeSdf->hasSdfOnlyAtSurface())
         {
             std::cerr << "The octrees with the isosurface termination rule are not supported in this application" << std::endl;
@@ -90,10 +98,10 @@ public:
         spdlog::info("Started compiling GI shader");
         mOctreeGIShader = std::make_unique<SdfOctreeGIShader>(*octreeSdf, *mSceneOctree);
         spdlog::info("Finished compiling GI shader");
-        mCopyRadianceShader = std::make_shared<GICopyRadianceShader>(mSceneOctree, mOctreeGIShader->mSceneOctreeSSBO);
+        mCopyRadianceShader = std::make_shared<GICopyRadianceShader>(mSceneOctree, mOctreeGIShader->mSceneLeafRadianceSSBO);
 
         {
-            const auto dataSize = mSceneOctree->getShaderOctreeData().size() * sizeof(ShaderOctreeNode) * 1e-6;
+            const auto dataSize = mSceneOctree->getShaderOctreeMemory() * 1e-6;
             spdlog::info("Finished generating Scene Octree, with size {0:.2f} MB", dataSize);
         }
 
@@ -149,6 +149,12 @@ EXPORT uint32_t getOctreeDataSize(SdfFunction* sdfPointer)
 {
     if(OctreeSdf* octreeSdf = dynamic_cast<OctreeSdf*>(sdfPointer))
     {
+        // The exported indices must be global
+        if(octreeSdf->hasSegmentedIndices())
+        {
+            SPDLOG_ERROR("Octrees with segmented indices cannot be exported");
+            return 0;
+        }
         return octreeSdf->getOctreeData().size();
     }
     
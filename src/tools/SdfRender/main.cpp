@@ -34,6 +34,13 @@ public:
         std::unique_ptr<SdfFunction> sdfUnique = SdfFunction::loadFromFile(mSdfPath);
         std::shared_ptr<SdfFunction> sdf = std::move(sdfUnique);
         std::shared_ptr<IOctreeSdf> octreeSdf = std::dynamic_pointer_cast<IOctreeSdf>(sdf);
+        if(octreeSdf == nullptr ||
+           (octreeSdf->getFormat() != SdfFunction::SdfFormat::TRILINEAR_OCTREE &&
+            octreeSdf->getFormat() != SdfFunction::SdfFormat::TRICUBIC_OCTREE))
+        {
+            std::cerr << "Only the trilinear and tricubic octrees are supported in this application" << std::endl;
+            exit(1);
+        }
 
         // Load tricubic model
         std::shared_ptr<IOctreeSdf> octreeTriSdf(nullptr);
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <vector>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+
+#include "SdfLib/SdfFunction.h"
+#include "SdfLib/OctreeSdf.h"
+#include "SdfLib/SdfSequence.h"
+#include "SdfLib/utils/Timer.h"
+
+using namespace sdflib;
+
+template<typename InterpolationMethod>
+std::unique_ptr<SdfFunction> buildSequence(const std::vector<std::string>& framesPaths, uint32_t numThreads)
+{
+    std::unique_ptr<TSdfSequence<InterpolationMethod>> sequence(new TSdfSequence<InterpolationMethod>());
+    for(const std::string& framePath : framesPaths)
+    {
+        std::unique_ptr<SdfFunction> sdf = SdfFunction::loadFromFile(framePath);
+        TOctreeSdf<InterpolationMethod>* octree = dynamic_cast<TOctreeSdf<InterpolationMethod>*>(sdf.get());
+        if(octree == nullptr)
+        {
+            std::cerr << "The frame " << framePath << " is not an octree with the interpolation of the first frame" << std::endl;
+            return nullptr;
+        }
+
+        if(!sequence->addFrame(*octree, numThreads)) return nullptr;
+    }
+
+    SPDLOG_INFO("{} start grid cells shared between frames", sequence->getNumSharedCells());
+    return sequence;
+}
+
+int main(int argc, char** argv)
+{
+    #ifdef SDFLIB_PRINT_STATISTICS
+        spdlog::set_pattern("[%^%l%$] [%s:%#] %v");
+    #else
+        spdlog::set_pattern("[%^%l%$] %v");
+    #endif
+
+    args::ArgumentParser parser("SdfSequenceExporter joins the octrees of the frames of an animation in one sequence", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> outputPathArg(parser, "output_path", "Output path");
+    args::PositionalList<std::string> framesPathsArg(parser, "frames_paths", "The octrees of the frames in order");
+    args::ValueFlag<uint32_t> numThreadsArg(parser, "num_threads", "Set the application maximum number of threads", {"num_threads"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(const args::Help&)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+    catch(const args::ParseError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    const std::vector<std::string>& framesPaths = args::get(framesPathsArg);
+    if(!outputPathArg || framesPaths.empty())
+    {
+        std::cerr << "Error: The output path and at least one frame must be specified" << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    const uint32_t numThreads = (numThreadsArg) ? args::get(numThreadsArg) : 1;
+
+    // The interpolation of the sequence is given by the first frame
+    std::unique_ptr<SdfFunction> firstFrame = SdfFunction::loadFromFile(framesPaths[0]);
+    if(firstFrame == nullptr) return 1;
+    const SdfFunction::SdfFormat format = firstFrame->getFormat();
+    firstFrame.reset();
+
+    Timer timer;
+    timer.start();
+
+    std::unique_ptr<SdfFunction> sequence;
+    if(format == SdfFunction::SdfFormat::TRILINEAR_OCTREE) sequence = buildSequence<TriLinearInterpolation>(framesPaths, numThreads);
+    else if(format == SdfFunction::SdfFormat::TRICUBIC_OCTREE) sequence = buildSequence<TriCubicInterpolation>(framesPaths, numThreads);
+    else if(format == SdfFunction::SdfFormat::TRIQUADRATIC_OCTREE) sequence = buildSequence<TriQuadraticInterpolation>(framesPaths, numThreads);
+    else
+    {
+        std::cerr << "The sequences only support the trilinear, triquadratic and tricubic octrees" << std::endl;
+        return 1;
+    }
+
+    if(sequence == nullptr) return 1;
+    SPDLOG_INFO("Sequence built in {}s", timer.getElapsedSeconds());
+
+    SdfFunction::MemoryUsage memoryUsage = sequence->getMemoryUsage();
+    SPDLOG_INFO("Sequence memory: {}MB", static_cast<float>(memoryUsage.getTotalBytes()) / 1048576.0f);
+
+    SPDLOG_INFO("Saving the sequence");
+    return (sequence->saveToFile(args::get(outputPathArg))) ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <args.hxx>
+#include <spdlog/spdlog.h>
+
+#include "SdfLib/SdfFunction.h"
+#include "SdfLib/UniformGridSdf.h"
+
+using namespace sdflib;
+
+// Returns the distance along the ray to the first sample of the finest grid closer than epsilon to the surface, or INFINITY
+float denseMarch(const UniformGridSdf& grid, glm::vec3 origin, glm::vec3 direction, float maxDistance, float stepSize, float epsilon)
+{
+    for(float t=0.0f; t <= maxDistance; t += stepSize)
+    {
+        if(grid.getDistanceConservative(origin + t * direction, 0) < epsilon) return t;
+    }
+    return INFINITY;
+}
+
+int main(int argc, char** argv)
+{
+    spdlog::set_pattern("[%^%l%$] %v");
+
+    args::ArgumentParser parser("Checks that the ray marching with the mip chain of a uniform grid never passes through the surface", "");
+    args::HelpFlag help(parser, "help", "Display help menu", {'h', "help"});
+    args::Positional<std::string> sdfPathArg(parser, "sdf_path", "Uniform grid sdf path");
+    args::ValueFlag<uint32_t> numRaysArg(parser, "num_rays", "Number of rays marched", {'r', "num_rays"});
+    args::ValueFlag<uint32_t> numLevelsArg(parser, "num_levels", "Number of coarse levels built if the grid has no mip chain", {"num_levels"});
+    args::ValueFlag<float> epsilonArg(parser, "epsilon", "Distance to the surface considered a hit", {"epsilon"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch(args::Help)
+    {
+        std::cerr << parser;
+        return 0;
+    }
+
+    std::unique_ptr<SdfFunction> sdf = SdfFunction::loadFromFile(args::get(sdfPathArg));
+    if(sdf == nullptr) return 1;
+    if(sdf->getFormat() != SdfFunction::SdfFormat::GRID)
+    {
+        SPDLOG_ERROR("The test only supports uniform grids");
+        return 1;
+    }
+    UniformGridSdf& grid = *reinterpret_cast<UniformGridSdf*>(sdf.get());
+
+    if(grid.getNumMipLevels() == 1) grid.buildMipChain((numLevelsArg) ? args::get(numLevelsArg) : 8);
+    SPDLOG_INFO("Mip chain with {} levels", grid.getNumMipLevels());
+
+    const uint32_t numRays = (numRaysArg) ? args::get(numRaysArg) : 10000;
+    const float epsilon = (epsilonArg) ? args::get(epsilonArg) : 1e-4f;
+    const BoundingBox box = grid.getGridBoundingBox();
+    const float boxDiagonal = glm::length(box.getSize());
+    const float denseStep = 0.25f * grid.getGridCellSize();
+
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    auto getRandomPoint = [&]() -> glm::vec3
+    {
+        return box.min + glm::vec3(dis(gen), dis(gen), dis(gen)) * box.getSize();
+    };
+
+    // The coarse levels must be lower bounds of the finest grid
+    uint32_t numBoundErrors = 0;
+    for(uint32_t s=0; s < numRays; s++)
+    {
+        const glm::vec3 sample = getRandomPoint();
+        const float fineDist = grid.getDistanceConservative(sample, 0);
+        for(uint32_t l=1; l < grid.getNumMipLevels(); l++)
+        {
+            if(grid.getDistanceConservative(sample, l) > fineDist + 1e-5f) numBoundErrors++;
+        }
+    }
+
+    // Rays from a sphere around the grid towards random points inside it
+    uint32_t numHits = 0;
+    uint32_t numPassedThrough = 0;
+    uint32_t numStepLimit = 0;
+    uint64_t mipSteps = 0;
+    uint64_t denseSteps = 0;
+    for(uint32_t r=0; r < numRays; r++)
+    {
+        const glm::vec3 dirToCenter = glm::normalize(glm::vec3(dis(gen), dis(gen), dis(gen)) - 0.5f);
+        const glm::vec3 origin = box.getCenter() + boxDiagonal * dirToCenter;
+        const glm::vec3 direction = glm::normalize(getRandomPoint() - origin);
+        const float maxDistance = 2.0f * boxDiagonal;
+
+        float mipDist;
+        uint32_t numSteps;
+        const bool mipHit = grid.rayMarch(origin, direction, maxDistance, mipDist, epsilon, 512, &numSteps);
+        const float denseDist = denseMarch(grid, origin, direction, maxDistance, denseStep, epsilon);
+        mipSteps += numSteps;
+        denseSteps += static_cast<uint64_t>(glm::min(denseDist, maxDistance) / denseStep) + 1;
+
+        if(mipHit) numHits++;
+        if(denseDist == INFINITY) continue;
+
+        // The march can stop earlier than the dense one, but never after the first crossing
+        if(!mipHit && numSteps >= 512) numStepLimit++;
+        else if(!mipHit || mipDist > denseDist + denseStep) numPassedThrough++;
+    }
+
+    SPDLOG_INFO("Rays: {}, hits: {}, stopped by the steps limit: {}", numRays, numHits, numStepLimit);
+    SPDLOG_INFO("Mean queries per ray: mip chain {}, dense march {}",
+                static_cast<float>(mipSteps) / static_cast<float>(numRays), static_cast<float>(denseSteps) / static_cast<float>(numRays));
+
+    if(numBoundErrors > 0 || numPassedThrough > 0)
+    {
+        SPDLOG_ERROR("{} coarse values above the finest grid, {} rays passed through the surface", numBoundErrors, numPassedThrough);
+        return 1;
+    }
+
+    SPDLOG_INFO("The mip chain march is conservative");
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include "SdfLib/utils/Compression.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace sdflib
+{
+namespace Compression
+{
+namespace
+{
+    enum BlockMode : uint8_t
+    {
+        RAW = 0,
+        RANS = 1
+    };
+
+    // The frequencies of each block are normalized to add up to 2^PROB_BITS
+    constexpr uint32_t PROB_BITS = 12;
+    constexpr uint32_t PROB_SCALE = 1 << PROB_BITS;
+    // Lower bound of the coder state, it is kept in [RANS_L, RANS_L * 256)
+    constexpr uint32_t RANS_L = 1u << 23;
+
+    void normalizeFrequencies(const std::array<uint64_t, 256>& counts, size_t total, std::array<uint32_t, 256>& outFreqs)
+    {
+        uint32_t sum = 0;
+        for(uint32_t s=0; s < 256; s++)
+        {
+            outFreqs[s] = (counts[s] == 0) ? 0 : std::max<uint32_t>(1, static_cast<uint32_t>((counts[s] * PROB_SCALE) / total));
+            sum += outFreqs[s];
+        }
+
+        // The rounding error is corrected in the most frequent symbols, every present symbol keeps at least frequency 1
+        while(sum != PROB_SCALE)
+        {
+            uint32_t best = 0;
+            for(uint32_t s=1; s < 256; s++)
+            {
+                if(outFreqs[s] > outFreqs[best]) best = s;
+            }
+
+            if(sum < PROB_SCALE)
+            {
+                outFreqs[best] += PROB_SCALE - sum;
+                sum = PROB_SCALE;
+            }
+            else
+            {
+                const uint32_t decrement = std::min(sum - PROB_SCALE, outFreqs[best] - 1);
+                outFreqs[best] -= decrement;
+                sum -= decrement;
+            }
+        }
+    }
+}
+
+void writeVarint(uint64_t value, std::vector<uint8_t>& out)
+{
+    while(value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t* data, size_t dataSize, size_t& position, uint64_t& outValue)
+{
+    outValue = 0;
+    for(uint32_t shift=0; shift < 64; shift += 7)
+    {
+        if(position >= dataSize) return false;
+        const uint8_t byte = data[position++];
+        outValue |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+void splitBytePlanes(const uint8_t* data, size_t numElements, size_t elementSize, uint8_t* outPlanes)
+{
+    for(size_t b=0; b < elementSize; b++)
+    {
+        uint8_t* plane = outPlanes + b * numElements;
+        for(size_t e=0; e < numElements; e++)
+        {
+            plane[e] = data[e * elementSize + b];
+        }
+    }
+}
+
+void mergeBytePlanes(const uint8_t* planes, size_t numElements, size_t elementSize, uint8_t* outData)
+{
+    for(size_t b=0; b < elementSize; b++)
+    {
+        const uint8_t* plane = planes + b * numElements;
+        for(size_t e=0; e < numElements; e++)
+        {
+            outData[e * elementSize + b] = plane[e];
+        }
+    }
+}
+
+void encodeBytes(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+    const size_t blockStart = out.size();
+    auto writeRaw = [&]()
+    {
+        out.resize(blockStart);
+        out.push_back(BlockMode::RAW);
+        out.insert(out.end(), data, data + size);
+    };
+
+    if(size == 0)
+    {
+        writeRaw();
+        return;
+    }
+
+    std::array<uint64_t, 256> counts{};
+    for(size_t i=0; i < size; i++) counts[data[i]]++;
+
+    std::array<uint32_t, 256> freqs;
+    normalizeFrequencies(counts, size, freqs);
+    std::array<uint32_t, 256> starts;
+    uint32_t start = 0;
+    for(uint32_t s=0; s < 256; s++)
+    {
+        starts[s] = start;
+        start += freqs[s];
+    }
+
+    out.push_back(BlockMode::RANS);
+    for(uint32_t s=0; s < 256; s++) writeVarint(freqs[s], out);
+
+    // The symbols are encoded backwards, so the decoder reads them forwards.
+    // The even and odd symbols use two interleaved states, so the decoder can overlap their dependency chains.
+    std::vector<uint8_t> stream(size + size / 4 + 16);
+    uint8_t* ptr = stream.data() + stream.size();
+    const uint8_t* streamLimit = stream.data() + 8;
+    std::array<uint32_t, 2> states = { RANS_L, RANS_L };
+    for(size_t i=size; i > 0; i--)
+    {
+        uint32_t& state = states[(i - 1) & 1];
+        const uint8_t symbol = data[i - 1];
+        const uint32_t freq = freqs[symbol];
+        const uint32_t maxState = ((RANS_L >> PROB_BITS) << 8) * freq;
+        while(state >= maxState)
+        {
+            if(ptr <= streamLimit)
+            {
+                // The encoded data is bigger than the raw data
+                writeRaw();
+                return;
+            }
+            *--ptr = static_cast<uint8_t>(state & 0xff);
+            state >>= 8;
+        }
+        state = ((state / freq) << PROB_BITS) + (state % freq) + starts[symbol];
+    }
+
+    for(uint32_t s=2; s > 0; s--)
+    {
+        ptr -= 4;
+        ptr[0] = static_cast<uint8_t>(states[s - 1]);
+        ptr[1] = static_cast<uint8_t>(states[s - 1] >> 8);
+        ptr[2] = static_cast<uint8_t>(states[s - 1] >> 16);
+        ptr[3] = static_cast<uint8_t>(states[s - 1] >> 24);
+    }
+
+    const size_t streamSize = static_cast<size_t>(stream.data() + stream.size() - ptr);
+    if(out.size() - blockStart + streamSize >= size + 1)
+    {
+        writeRaw();
+        return;
+    }
+    out.insert(out.end(), ptr, ptr + streamSize);
+}
+
+bool decodeBytes(const uint8_t* data, size_t dataSize, uint8_t* outData, size_t size)
+{
+    if(dataSize == 0) return false;
+    if(data[0] == BlockMode::RAW)
+    {
+        if(dataSize != size + 1) return false;
+        std::memcpy(outData, data + 1, size);
+        return true;
+    }
+    else if(data[0] != BlockMode::RANS) return false;
+
+    size_t position = 1;
+    std::array<uint32_t, 256> freqs;
+    std::array<uint32_t, 256> starts;
+    uint32_t start = 0;
+    for(uint32_t s=0; s < 256; s++)
+    {
+        uint64_t freq;
+        if(!readVarint(data, dataSize, position, freq) || freq > PROB_SCALE - start) return false;
+        freqs[s] = static_cast<uint32_t>(freq);
+        starts[s] = start;
+        start += freqs[s];
+    }
+    if(start != PROB_SCALE) return false;
+
+    // Each slot stores everything needed to decode its symbol, so a decoding step only does one lookup
+    struct Slot
+    {
+        uint16_t freq;
+        uint16_t bias;
+        uint8_t symbol;
+    };
+    std::vector<Slot> slots(PROB_SCALE);
+    for(uint32_t s=0; s < 256; s++)
+    {
+        for(uint32_t i=0; i < freqs[s]; i++)
+        {
+            slots[starts[s] + i] = Slot{ static_cast<uint16_t>(freqs[s]), static_cast<uint16_t>(i), static_cast<uint8_t>(s) };
+        }
+    }
+
+    if(dataSize - position < 8) return false;
+    const uint8_t* ptr = data + position;
+    const uint8_t* end = data + dataSize;
+    std::array<uint32_t, 2> states;
+    for(uint32_t s=0; s < 2; s++)
+    {
+        states[s] = static_cast<uint32_t>(ptr[0]) | (static_cast<uint32_t>(ptr[1]) << 8) |
+                    (static_cast<uint32_t>(ptr[2]) << 16) | (static_cast<uint32_t>(ptr[3]) << 24);
+        ptr += 4;
+    }
+
+    constexpr uint32_t MASK = PROB_SCALE - 1;
+    auto decodeSymbol = [&](uint32_t& state, size_t i)
+    {
+        const Slot slot = slots[state & MASK];
+        outData[i] = slot.symbol;
+        state = slot.freq * (state >> PROB_BITS) + slot.bias;
+        while(state < RANS_L)
+        {
+            if(ptr >= end) return false;
+            state = (state << 8) | *ptr++;
+        }
+        return true;
+    };
+
+    size_t i = 0;
+    for(; i + 1 < size; i += 2)
+    {
+        if(!decodeSymbol(states[0], i) || !decodeSymbol(states[1], i + 1)) return false;
+    }
+    if(i < size && !decodeSymbol(states[0], i)) return false;
+
+    return true;
+}
+}
+}
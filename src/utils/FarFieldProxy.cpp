@@ -0,0 +1,34 @@
+#include "SdfLib/utils/FarFieldProxy.h"
+
+namespace sdflib
+{
+FarFieldProxy::FarFieldProxy(const Mesh& mesh)
+    : FarFieldProxy()
+{
+    for(const glm::vec3& vert : mesh.getVertices())
+    {
+        for(uint32_t i=0; i < NUM_DIRECTIONS; i++)
+        {
+            const float d = glm::dot(getDirection(i), vert);
+            mMin[i] = glm::min(mMin[i], d);
+            mMax[i] = glm::max(mMax[i], d);
+        }
+    }
+
+    if(!isValid()) return;
+
+    // Enlarge the slabs to keep the bound conservative under the rounding errors
+    float maxExtent = 0.0f;
+    for(uint32_t i=0; i < NUM_DIRECTIONS; i++)
+    {
+        maxExtent = glm::max(maxExtent, glm::max(glm::abs(mMin[i]), glm::abs(mMax[i])));
+    }
+
+    const float margin = 1e-5f * maxExtent;
+    for(uint32_t i=0; i < NUM_DIRECTIONS; i++)
+    {
+        mMin[i] -= margin;
+        mMax[i] += margin;
+    }
+}
+}
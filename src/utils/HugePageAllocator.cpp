@@ -0,0 +1,116 @@
+#include "SdfLib/utils/HugePageAllocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace sdflib
+{
+namespace
+{
+#ifdef SDFLIB_USE_HUGE_PAGES
+    std::atomic<LargeArrayPolicy> largeArrayPolicy(LargeArrayPolicy::HUGE_PAGES);
+#else
+    std::atomic<LargeArrayPolicy> largeArrayPolicy(LargeArrayPolicy::DEFAULT);
+#endif
+
+#ifndef _WIN32
+    // Locked length of each array that was locked in memory, so only those ones are unlocked when freed
+    std::mutex lockedArraysMutex;
+    std::unordered_map<void*, size_t> lockedArrays;
+#endif
+}
+
+void setLargeArrayPolicy(LargeArrayPolicy policy)
+{
+    largeArrayPolicy = policy;
+}
+
+LargeArrayPolicy getLargeArrayPolicy()
+{
+    return largeArrayPolicy;
+}
+
+namespace internal
+{
+void* allocateLargeArray(size_t numBytes)
+{
+    if(numBytes == 0) numBytes = 1;
+
+    const LargeArrayPolicy policy = largeArrayPolicy;
+    const bool useHugePages = policy != LargeArrayPolicy::DEFAULT && numBytes >= HUGE_PAGE_SIZE;
+
+#ifdef _WIN32
+    // The huge pages need special privileges on windows, only the alignment is applied
+    return _aligned_malloc(numBytes, CACHE_LINE_SIZE);
+#else
+    // Round to whole pages, so the last huge page is not shared with other allocations
+    const size_t alignment = (useHugePages) ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+    const size_t allocSize = (useHugePages) ? ((numBytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE : numBytes;
+
+    void* ptr = nullptr;
+    if(posix_memalign(&ptr, alignment, allocSize) != 0) return nullptr;
+
+    if(useHugePages)
+    {
+    #ifdef MADV_HUGEPAGE
+        if(madvise(ptr, allocSize, MADV_HUGEPAGE) != 0)
+        {
+            SPDLOG_ERROR("The transparent huge pages could not be enabled for an array of {}MB", allocSize / 1048576.0f);
+        }
+    #endif
+
+        if(policy == LargeArrayPolicy::HUGE_PAGES_LOCKED)
+        {
+            if(mlock(ptr, allocSize) == 0)
+            {
+                std::lock_guard<std::mutex> lock(lockedArraysMutex);
+                lockedArrays[ptr] = allocSize;
+            }
+            else
+            {
+                SPDLOG_ERROR("An array of {}MB could not be locked in memory, check the memlock limit", allocSize / 1048576.0f);
+            }
+        }
+    }
+
+    return ptr;
+#endif
+}
+
+void freeLargeArray(void* ptr, size_t numBytes)
+{
+    if(ptr == nullptr) return;
+
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    // Only the arrays bigger than a huge page can be locked
+    if(numBytes >= HUGE_PAGE_SIZE)
+    {
+        size_t lockedSize = 0;
+        {
+            std::lock_guard<std::mutex> lock(lockedArraysMutex);
+            auto it = lockedArrays.find(ptr);
+            if(it != lockedArrays.end())
+            {
+                lockedSize = it->second;
+                lockedArrays.erase(it);
+            }
+        }
+
+        if(lockedSize > 0) munlock(ptr, lockedSize);
+    }
+    std::free(ptr);
+#endif
+}
+}
+}
@@ -0,0 +1,90 @@
+#include "SdfLib/utils/QueryStats.h"
+
+namespace sdflib
+{
+namespace
+{
+    std::atomic<uint32_t> nextThreadSlot{0};
+}
+
+QueryStatsCounter::QueryStatsCounter() {}
+
+QueryStatsCounter::QueryStatsCounter(const QueryStatsCounter& other)
+{
+    setEnabled(other.isEnabled());
+}
+
+QueryStatsCounter& QueryStatsCounter::operator=(const QueryStatsCounter& other)
+{
+    setEnabled(other.isEnabled());
+    return *this;
+}
+
+QueryStatsCounter::~QueryStatsCounter()
+{
+    delete[] mThreadsCounters.load(std::memory_order_relaxed);
+}
+
+void QueryStatsCounter::setEnabled(bool enabled)
+{
+    if(enabled && mThreadsCounters.load(std::memory_order_acquire) == nullptr)
+    {
+        // Other thread can be enabling the counters at the same time, only one array is kept
+        ThreadCounters* counters = new ThreadCounters[NUM_THREAD_SLOTS];
+        ThreadCounters* expected = nullptr;
+        if(!mThreadsCounters.compare_exchange_strong(expected, counters, std::memory_order_acq_rel))
+        {
+            delete[] counters;
+        }
+    }
+
+    mEnabled.store(enabled, std::memory_order_release);
+}
+
+QueryStats QueryStatsCounter::getStats() const
+{
+    QueryStats stats;
+    const ThreadCounters* counters = mThreadsCounters.load(std::memory_order_acquire);
+    if(counters == nullptr) return stats;
+
+    for(uint32_t s=0; s < NUM_THREAD_SLOTS; s++)
+    {
+        const ThreadCounters& c = counters[s];
+        stats.numQueries += c.numQueries.load(std::memory_order_relaxed);
+        stats.numOutOfBoxQueries += c.numOutOfBoxQueries.load(std::memory_order_relaxed);
+        stats.nodesVisited += c.nodesVisited.load(std::memory_order_relaxed);
+        stats.trianglesEvaluated += c.trianglesEvaluated.load(std::memory_order_relaxed);
+        stats.maskBitsDecoded += c.maskBitsDecoded.load(std::memory_order_relaxed);
+        for(uint32_t d=0; d < QueryStats::MAX_DEPTH; d++)
+        {
+            stats.leafDepthHistogram[d] += c.leafDepthHistogram[d].load(std::memory_order_relaxed);
+        }
+    }
+    return stats;
+}
+
+void QueryStatsCounter::reset()
+{
+    ThreadCounters* counters = mThreadsCounters.load(std::memory_order_acquire);
+    if(counters == nullptr) return;
+
+    for(uint32_t s=0; s < NUM_THREAD_SLOTS; s++)
+    {
+        ThreadCounters& c = counters[s];
+        c.numQueries.store(0, std::memory_order_relaxed);
+        c.numOutOfBoxQueries.store(0, std::memory_order_relaxed);
+        c.nodesVisited.store(0, std::memory_order_relaxed);
+        c.trianglesEvaluated.store(0, std::memory_order_relaxed);
+        c.maskBitsDecoded.store(0, std::memory_order_relaxed);
+        for(std::atomic<uint64_t>& v : c.leafDepthHistogram) v.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t QueryStatsCounter::getThreadSlot()
+{
+    // All the threads, from OpenMP teams or thread pools, get consecutive slots in their creation order.
+    // They only keep their slot index, so there is nothing to release when they finish.
+    thread_local const uint32_t slot = nextThreadSlot.fetch_add(1, std::memory_order_relaxed) % NUM_THREAD_SLOTS;
+    return slot;
+}
+}
@@ -0,0 +1,127 @@
+#include "SdfLib/utils/ThreadPool.h"
+
+#include <algorithm>
+
+namespace sdflib
+{
+namespace
+{
+    thread_local const ThreadPool* tCurrentPool = nullptr;
+    thread_local uint32_t tWorkerIndex = 0;
+}
+
+ThreadPool::ThreadPool(uint32_t numThreads)
+{
+    if(numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    mQueues.resize(numThreads);
+    for(std::unique_ptr<WorkerQueue>& queue : mQueues)
+    {
+        queue = std::make_unique<WorkerQueue>();
+    }
+
+    mThreads.reserve(numThreads);
+    for(uint32_t i=0; i < numThreads; i++)
+    {
+        mThreads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStop = true;
+    }
+    mSleepCondition.notify_all();
+
+    for(std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::getGlobalPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    const uint32_t queueIndex = (tCurrentPool == this)
+                                    ? tWorkerIndex
+                                    : mNextQueue.fetch_add(1, std::memory_order_relaxed) % mQueues.size();
+
+    {
+        std::lock_guard<std::mutex> lock(mQueues[queueIndex]->mutex);
+        mQueues[queueIndex]->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mPendingTasks++;
+    }
+    mSleepCondition.notify_one();
+}
+
+bool ThreadPool::popTask(uint32_t workerIndex, std::function<void()>& outTask)
+{
+    // Take from the front of the own queue
+    {
+        WorkerQueue& queue = *mQueues[workerIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty())
+        {
+            outTask = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // Steal from the back of the other queues
+    for(uint32_t i=1; i < mQueues.size(); i++)
+    {
+        WorkerQueue& queue = *mQueues[(workerIndex + i) % mQueues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty())
+        {
+            outTask = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(uint32_t workerIndex)
+{
+    tCurrentPool = this;
+    tWorkerIndex = workerIndex;
+
+    std::function<void()> task;
+    while(true)
+    {
+        // Reserve one of the pending tasks
+        {
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mSleepCondition.wait(lock, [&] { return mStop || mPendingTasks > 0; });
+            if(mPendingTasks == 0) return;
+            mPendingTasks--;
+        }
+
+        // The reserved task is already in one of the queues
+        while(!popTask(workerIndex, task))
+        {
+            std::this_thread::yield();
+        }
+
+        task();
+        task = nullptr;
+    }
+}
+}